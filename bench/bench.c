@@ -0,0 +1,442 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "bench.h"
+#include "romcache.h"
+#include "profile.h"
+#include <argp.h>
+#include <time.h>
+#include <unistd.h>
+
+// Whole system throughput benchmarks
+//
+// Each workload boots a cartridge headlessly and times a fixed number of emulated frames,
+//  reporting wall time, emulated clocks per second and speed relative to real hardware.
+//  Results are written as JSON so they can be compared from build to build.
+//  --micro runs the per-subsystem micro benchmarks from micro.c instead.
+
+#define BENCH_MAX_WORKLOADS     (16)
+
+const char *argp_program_version = "gamegirl-bench 0.1.0";
+
+static char argp_doc[] = "GameGirl headless throughput benchmarks";
+static struct argp_option argp_options[] = {
+  {"frames",    'n', "N",    0,  "Measure N emulated frames per repetition (default 600)"},
+  {"warmup",    'w', "N",    0,  "Run N frames after boot before measuring (default 120)"},
+  {"reps",      'r', "N",    0,  "Repeat each measurement N times (default 5)"},
+  {"output",    'o', "FILE", 0,  "Write JSON results to FILE, - for stdout (default gamegirl-bench.json)"},
+  {"blargg",    'b', "FILE", 0,  "Blargg cpu_instrs ROM (default tmp/blargg/cpu_instrs.gb)"},
+  {"rom",       'a', "FILE", 0,  "Add FILE as an extra workload, may be repeated"},
+  {"select",    's', "NAME", 0,  "Only run workloads whose name contains NAME"},
+  {"micro",     'm', 0,      0,  "Run the per-subsystem micro benchmarks instead (default output gamegirl-micro.json)"},
+  {"lockstep",  'l', "CORES", OPTION_ARG_OPTIONAL, "Instead of timing, run two cpu cores side by side for N frames of every workload, "
+                                                   "stopping at the first mismatch.  CORES is A,B (default reference,reference)"},
+  {"golden",    'g', "FILE", 0,  "Instead of timing, hash the screen during N frames of every workload and compare against FILE"},
+  {"update-golden", 'u', 0,  0,  "Write the --golden hashes rather than comparing against them"},
+  {"hash-every",    'k', "K", 0, "Hash every K frames (default 60)"},
+  {"movie",     'i', "FILE", 0,  "Input movie to play back while hashing"},
+  { 0 }
+};
+
+typedef struct {
+    int frames;
+    int warmup;
+    int reps;
+    const char *output;
+    const char *blargg;
+    const char *extraRoms[BENCH_MAX_WORKLOADS];
+    int numExtraRoms;
+    const char *select;
+    bool micro;
+    const char *lockstep;
+    FrameHashArgs frameHash;
+} BenchArgs;
+
+typedef struct {
+    char name[32];
+    const char *description;
+    char romFilename[1024];
+    bool bootOnly;          // time the boot ROM itself rather than the cartridge
+    // results
+    double seconds[BENCH_MAX_REPS];
+    uint64_t clocks[BENCH_MAX_REPS];
+} Workload;
+
+static error_t argpParser(int key, char *arg, struct argp_state *state)
+{
+    BenchArgs *args = (BenchArgs *)state->input;
+
+    switch (key)
+      {
+      case 'n':
+        args->frames = MAX(1, atoi(arg));
+        break;
+      case 'w':
+        args->warmup = MAX(0, atoi(arg));
+        break;
+      case 'r':
+        args->reps = MIN(BENCH_MAX_REPS, MAX(1, atoi(arg)));
+        break;
+      case 'o':
+        args->output = arg;
+        break;
+      case 'b':
+        args->blargg = arg;
+        break;
+      case 'a':
+        if( args->numExtraRoms < BENCH_MAX_WORKLOADS ) {
+            args->extraRoms[args->numExtraRoms++] = arg;
+        }
+        break;
+      case 's':
+        args->select = arg;
+        break;
+      case 'm':
+        args->micro = true;
+        break;
+      case 'l':
+        args->lockstep = (NULL != arg)? arg : "reference,reference";
+        break;
+      case 'g':
+        args->frameHash.golden = arg;
+        break;
+      case 'u':
+        args->frameHash.update = true;
+        break;
+      case 'k':
+        args->frameHash.every = MAX(1, atoi(arg));
+        break;
+      case 'i':
+        args->frameHash.movie = arg;
+        break;
+      case ARGP_KEY_ARG:
+        argp_usage(state);
+        break;
+      default:
+        return ARGP_ERR_UNKNOWN;
+      }
+    return 0;
+}
+
+static struct argp argp_config = { argp_options, argpParser, NULL, argp_doc };
+
+static const struct {
+    const char *name;
+    const char *description;
+    SynthRomType type;
+} synthWorkloads[] = {
+    { "ppu-scroll",  "background and window split, scrolled every frame",   SYNTH_ROM_SCROLL },
+    { "ppu-sprites", "ten 8x16 objects per line, moved every frame",        SYNTH_ROM_SPRITES },
+    { "halt-idle",   "HALT waiting on the vblank interrupt",                SYNTH_ROM_HALT },
+    { "cpu-mix",     "ALU, memory, stack and call instruction mix",         SYNTH_ROM_CPU },
+};
+
+// the synthetic ROMs and their analysis caches
+static void removeSynthRoms(const char * const tempDir)
+{
+    char filename[1100];
+    for(int index = 0; index < NUM_ELEMENTS(synthWorkloads); index++) {
+        snprintf(filename, sizeof(filename), "%s/%s.gb", tempDir, synthWorkloads[index].name);
+        unlink(filename);
+        strcat(filename, ROMCACHE_EXTENSION);
+        unlink(filename);
+    }
+    snprintf(filename, sizeof(filename), "%s/halt.gb", tempDir);
+    unlink(filename);
+    strcat(filename, ROMCACHE_EXTENSION);
+    unlink(filename);
+    rmdir(tempDir);
+}
+
+double benchSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+// Runs the emulation for the given number of main clocks, or until the boot ROM exits
+static void runClocks(const uint64_t clocks, const bool bootOnly)
+{
+    const uint64_t target = mainClock + clocks;
+    while( (mainClock < target) && !(bootOnly && !bootRomActive) ) {
+        executeInstruction();
+    }
+}
+
+static void runWorkload(Workload * const workload, const BenchArgs * const args)
+{
+    const uint64_t frameClocks = (uint64_t)args->frames * LCD_FRAME_DOTS;
+    const uint64_t bootClocks = (uint64_t)BENCH_MAX_BOOT_FRAMES * LCD_FRAME_DOTS;
+
+    if( workload->bootOnly ) {
+        // one unmeasured boot to warm up, then a fresh boot for each repetition
+        for(int rep = -1; rep < args->reps; rep++) {
+            gbInit(workload->romFilename);
+            const double start = benchSeconds();
+            runClocks(bootClocks, true);
+            if( 0 <= rep ) {
+                workload->seconds[rep] = benchSeconds() - start;
+                workload->clocks[rep] = mainClock;
+            }
+            gbDeinit();
+        }
+        return;
+    }
+
+    gbInit(workload->romFilename);
+    runClocks(bootClocks, true);
+    runClocks((uint64_t)args->warmup * LCD_FRAME_DOTS, false);
+    profileReset();
+    for(int rep = 0; rep < args->reps; rep++) {
+        const uint64_t startClock = mainClock;
+        const double start = benchSeconds();
+        runClocks(frameClocks, false);
+        workload->seconds[rep] = benchSeconds() - start;
+        workload->clocks[rep] = mainClock - startClock;
+    }
+#ifdef GAMEGIRL_PROFILE
+    printf("\n%s ", workload->name);
+    profileDump(stdout);
+#endif
+    gbDeinit();
+}
+
+// Every workload from reset, so the boot ROM is covered too.  Returns the number that diverged
+static int lockstepWorkloads(const Workload * const workloads, const int numWorkloads, const BenchArgs * const args)
+{
+    char names[2][64] = {0};
+    sscanf(args->lockstep, "%63[^,],%63s", names[0], names[1]);
+    if( '\0' == names[1][0] ) {
+        // just one given, check it against the reference
+        snprintf(names[1], sizeof(names[1]), "%s", names[0]);
+        snprintf(names[0], sizeof(names[0]), "%s", cpuCores[0].name);
+    }
+    const CpuCore *cores[2];
+    for(int core = 0; core < 2; core++) {
+        if( NULL == (cores[core] = findCpuCore(names[core])) ) {
+            printf("Unknown cpu core '%s', available cores are:", names[core]);
+            for(int index = 0; index < numCpuCores; index++) {
+                printf(" %s", cpuCores[index].name);
+            }
+            printf("\n");
+            return numWorkloads;
+        }
+    }
+
+    int failures = 0, checked = 0;
+    printf("Lockstep '%s' against '%s' for %d frames\n", cores[0]->name, cores[1]->name, args->frames);
+    for(int index = 0; index < numWorkloads; index++) {
+        if( workloads[index].bootOnly ) {
+            continue;
+        }
+        printf("\n%s\n", workloads[index].name);
+        checked++;
+        uint64_t instructions = 0;
+        const double start = benchSeconds();
+        if( SUCCESS == runLockstep(workloads[index].romFilename, cores, args->frames, &instructions) ) {
+            printf("%s: %llu instructions match (%.2fs)\n", workloads[index].name, (unsigned long long)instructions, benchSeconds() - start);
+        } else {
+            failures++;
+        }
+    }
+    printf("\n%d of %d workloads diverged\n", failures, checked);
+    return failures;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    const double diff = *(const double *)a - *(const double *)b;
+    return (diff < 0)? -1 : (diff > 0)? 1 : 0;
+}
+
+double benchMedian(const double * const values, const int count)
+{
+    double sorted[BENCH_MAX_REPS];
+    memcpy(sorted, values, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compareDouble);
+    return sorted[count/2];
+}
+
+typedef struct {
+    double best;
+    double median;
+    uint64_t clocks;    // mean per repetition
+    double clocksPerSecond;
+} WorkloadStats;
+
+static WorkloadStats workloadStats(const Workload * const workload, const int reps)
+{
+    WorkloadStats stats = {0};
+    stats.best = workload->seconds[0];
+    for(int rep = 0; rep < reps; rep++) {
+        stats.clocks += workload->clocks[rep];
+        stats.best = MIN(stats.best, workload->seconds[rep]);
+    }
+    stats.clocks /= reps;
+    stats.median = benchMedian(workload->seconds, reps);
+    stats.clocksPerSecond = stats.clocks / stats.median;
+    return stats;
+}
+
+static void writeResults(FILE *file, const Workload * const workloads, const int numWorkloads, const BenchArgs * const args)
+{
+    fprintf(file, "{\n");
+    fprintf(file, "  \"benchmark\": \"%s\",\n", argp_program_version);
+    fprintf(file, "  \"frames\": %d,\n  \"warmupFrames\": %d,\n  \"repetitions\": %d,\n", args->frames, args->warmup, args->reps);
+    fprintf(file, "  \"workloads\": [\n");
+    for(int index = 0; index < numWorkloads; index++) {
+        const Workload *workload = &workloads[index];
+        const WorkloadStats stats = workloadStats(workload, args->reps);
+
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": \"%s\",\n", workload->name);
+        fprintf(file, "      \"description\": \"%s\",\n", workload->description);
+        fprintf(file, "      \"frames\": %.1f,\n", (double)stats.clocks / LCD_FRAME_DOTS);
+        fprintf(file, "      \"clocks\": %llu,\n", (unsigned long long)stats.clocks);
+        fprintf(file, "      \"seconds\": [");
+        for(int rep = 0; rep < args->reps; rep++) {
+            fprintf(file, "%s%.6f", (rep)? ", " : "", workload->seconds[rep]);
+        }
+        fprintf(file, "],\n");
+        fprintf(file, "      \"bestSeconds\": %.6f,\n", stats.best);
+        fprintf(file, "      \"medianSeconds\": %.6f,\n", stats.median);
+        fprintf(file, "      \"clocksPerSecond\": %.0f,\n", stats.clocksPerSecond);
+        fprintf(file, "      \"realtimeMultiple\": %.3f\n", stats.clocksPerSecond / MAIN_CLOCK_HZ);
+        fprintf(file, "    }%s\n", (index < (numWorkloads-1))? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+int main(int argc, char **argv)
+{
+    BenchArgs args = {
+        .frames = 600,
+        .warmup = 120,
+        .reps = 5,
+        .blargg = "tmp/blargg/cpu_instrs.gb",
+        .frameHash.every = 60,
+    };
+    argp_parse(&argp_config, argc, argv, 0, 0, &args);
+
+    SetTraceLogLevel(LOG_WARNING);
+    headless = true;
+    fastBoot = true;
+
+    char tempDir[] = "/tmp/gamegirl-bench-XXXXXX";
+    if( NULL == mkdtemp(tempDir) ) {
+        printf("Unable to create a temporary directory\n");
+        return 1;
+    }
+
+    if( args.micro ) {
+        const Status status = runMicroBenchmarks(tempDir, args.reps, args.select,
+                                                 (NULL != args.output)? args.output : "gamegirl-micro.json");
+        rmdir(tempDir);
+        return (SUCCESS == status)? 0 : 1;
+    }
+    if( NULL == args.output ) {
+        args.output = "gamegirl-bench.json";
+    }
+
+    static Workload workloads[BENCH_MAX_WORKLOADS];
+    int numWorkloads = 0;
+    Workload *workload;
+
+    workload = &workloads[numWorkloads++];
+    snprintf(workload->name, sizeof(workload->name), "bootrom");
+    workload->description = "DMG boot ROM from reset until it hands over to the cartridge";
+    snprintf(workload->romFilename, sizeof(workload->romFilename), "%s/halt.gb", tempDir);
+    workload->bootOnly = true;
+    if( SUCCESS != writeSynthRom(SYNTH_ROM_HALT, workload->romFilename) ) {
+        return 1;
+    }
+
+    for(int index = 0; index < NUM_ELEMENTS(synthWorkloads); index++) {
+        workload = &workloads[numWorkloads++];
+        snprintf(workload->name, sizeof(workload->name), "%s", synthWorkloads[index].name);
+        workload->description = synthWorkloads[index].description;
+        snprintf(workload->romFilename, sizeof(workload->romFilename), "%s/%s.gb", tempDir, synthWorkloads[index].name);
+        if( SUCCESS != writeSynthRom(synthWorkloads[index].type, workload->romFilename) ) {
+            return 1;
+        }
+    }
+
+    if( 0 == access(args.blargg, R_OK) ) {
+        workload = &workloads[numWorkloads++];
+        snprintf(workload->name, sizeof(workload->name), "blargg-cpu");
+        workload->description = "Blargg cpu_instrs test ROM";
+        snprintf(workload->romFilename, sizeof(workload->romFilename), "%s", args.blargg);
+    } else {
+        printf("Skipping blargg-cpu, '%s' not found (see --blargg)\n", args.blargg);
+    }
+
+    for(int index = 0; (index < args.numExtraRoms) && (numWorkloads < BENCH_MAX_WORKLOADS); index++) {
+        if( 0 != access(args.extraRoms[index], R_OK) ) {
+            printf("Skipping '%s', not found\n", args.extraRoms[index]);
+            continue;
+        }
+        workload = &workloads[numWorkloads++];
+        const char *basename = strrchr(args.extraRoms[index], '/');
+        snprintf(workload->name, sizeof(workload->name), "%s", (NULL != basename)? basename+1 : args.extraRoms[index]);
+        workload->description = "user supplied ROM";
+        snprintf(workload->romFilename, sizeof(workload->romFilename), "%s", args.extraRoms[index]);
+    }
+
+    // drop anything not selected
+    int numSelected = 0;
+    for(int index = 0; index < numWorkloads; index++) {
+        if( (NULL == args.select) || (NULL != strstr(workloads[index].name, args.select)) ) {
+            workloads[numSelected++] = workloads[index];
+        }
+    }
+    numWorkloads = numSelected;
+
+    if( NULL != args.lockstep ) {
+        const int failures = lockstepWorkloads(workloads, numWorkloads, &args);
+        removeSynthRoms(tempDir);
+        return (0 == failures)? 0 : 1;
+    }
+    if( NULL != args.frameHash.golden ) {
+        const char *names[BENCH_MAX_WORKLOADS], *romFilenames[BENCH_MAX_WORKLOADS];
+        int numHashed = 0;
+        for(int index = 0; index < numWorkloads; index++) {
+            if( !workloads[index].bootOnly ) {
+                names[numHashed] = workloads[index].name;
+                romFilenames[numHashed++] = workloads[index].romFilename;
+            }
+        }
+        args.frameHash.frames = args.frames;
+        const Status status = runFrameHashes(names, romFilenames, numHashed, &args.frameHash);
+        removeSynthRoms(tempDir);
+        return (SUCCESS == status)? 0 : 1;
+    }
+
+    for(int index = 0; index < numWorkloads; index++) {
+        runWorkload(&workloads[index], &args);
+    }
+
+    printf("\n%-16s %12s %14s %10s\n", "workload", "median (s)", "clocks/s", "x realtime");
+    for(int index = 0; index < numWorkloads; index++) {
+        const WorkloadStats stats = workloadStats(&workloads[index], args.reps);
+        printf("%-16s %12.4f %14.0f %10.2f\n", workloads[index].name, stats.median,
+            stats.clocksPerSecond, stats.clocksPerSecond / MAIN_CLOCK_HZ);
+    }
+
+    FILE *file = (0 == strcmp("-", args.output))? stdout : fopen(args.output, "w");
+    if( NULL == file ) {
+        printf("Unable to write '%s'\n", args.output);
+        return 1;
+    }
+    writeResults(file, workloads, numWorkloads, &args);
+    if( stdout != file ) {
+        fclose(file);
+        printf("Results written to '%s'\n", args.output);
+    }
+
+    removeSynthRoms(tempDir);
+    return 0;
+}
@@ -0,0 +1,48 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "gb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    SYNTH_ROM_SCROLL,       // background + window split, scrolling every frame
+    SYNTH_ROM_SPRITES,      // 10 sprites on as many lines as possible, moving every frame
+    SYNTH_ROM_HALT,         // HALT waiting on vblank interrupts
+    SYNTH_ROM_CPU,          // mixed ALU, memory, stack and call instructions
+    SYNTH_ROM_ALU,          // register only ALU and CB prefixed instructions, LCD off
+    SYNTH_ROM_LOADSTORE,    // loads, stores and stack traffic, LCD off
+    NUM_SYNTH_ROMS
+} SynthRomType;
+
+#define BENCH_MAX_REPS          (32)
+#define BENCH_MAX_BOOT_FRAMES   (1000)  // boot ROM hangs on a bad header, don't wait forever
+
+typedef struct {
+    const char *golden;     // golden hash file
+    bool update;            // write it rather than compare against it
+    const char *movie;      // optional input movie
+    int frames;
+    int every;              // hash every this many frames
+} FrameHashArgs;
+
+double benchSeconds(void);
+double benchMedian(const double * const values, const int count);
+Status writeSynthRom(const SynthRomType type, const char * const filename);
+Status runMicroBenchmarks(const char * const tempDir, const int reps, const char * const select, const char * const output);
+Status runFrameHashes(const char * const names[], const char * const romFilenames[], const int count, const FrameHashArgs * const args);
+Status runLockstep(const char * const romFilename, const CpuCore * const cores[2], const int frames, uint64_t * const instructions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__BENCH_H__
@@ -0,0 +1,245 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "bench.h"
+#include <strings.h>
+
+// Frame hash regression tests
+//
+// Each workload boots headlessly and runs for a fixed number of frames, optionally driven by
+//  an input movie, hashing the screen every few frames.  The hashes are compared against a
+//  golden file (or written to it with --update-golden), so a PPU or timing change that
+//  alters any pixel shows up as the exact frames it changed.
+//
+// Golden files are text, one "workload frame hash" per line.  Movies are text too, one
+//  "frame buttons" per line where buttons are any of A B SELECT START RIGHT LEFT UP DOWN
+//  (or - for none) and are held from that frame until the next line.  Frames are counted
+//  from when the boot ROM hands over to the cartridge, '#' starts a comment in either.
+
+#define FRAMEHASH_MAX_GOLDEN    (64*1024)
+#define FRAMEHASH_MAX_MOVIE     (16*1024)
+#define FRAMEHASH_MAX_REPORTED  (10)    // mismatches listed per workload
+
+typedef struct {
+    char name[32];
+    int frame;
+    uint64_t hash;
+    bool checked;
+} GoldenHash;
+
+typedef struct {
+    int frame;
+    ControlState controls;
+} MovieEvent;
+
+static GoldenHash golden[FRAMEHASH_MAX_GOLDEN];
+static int numGolden;
+static MovieEvent movie[FRAMEHASH_MAX_MOVIE];
+static int numMovie;
+
+static int compareGolden(const void *a, const void *b)
+{
+    const GoldenHash *goldenA = (const GoldenHash *)a;
+    const GoldenHash *goldenB = (const GoldenHash *)b;
+    const int byName = strcmp(goldenA->name, goldenB->name);
+    return (0 != byName)? byName : (goldenA->frame - goldenB->frame);
+}
+
+// Sorted by workload and frame, for findGolden
+static Status loadGolden(const char * const filename)
+{
+    FILE *file = fopen(filename, "r");
+    if( NULL == file ) {
+        printf("Unable to read golden hashes '%s' (create it with --update-golden)\n", filename);
+        return FAILURE;
+    }
+    char line[256];
+    numGolden = 0;
+    while( (NULL != fgets(line, sizeof(line), file)) && (numGolden < FRAMEHASH_MAX_GOLDEN) ) {
+        GoldenHash *entry = &golden[numGolden];
+        unsigned long long hash;
+        if( ('#' != line[0]) && (3 == sscanf(line, "%31s %d %llx", entry->name, &entry->frame, &hash)) ) {
+            entry->hash = hash;
+            entry->checked = false;
+            numGolden++;
+        }
+    }
+    fclose(file);
+    qsort(golden, numGolden, sizeof(GoldenHash), compareGolden);
+    return SUCCESS;
+}
+
+static GoldenHash *findGolden(const char * const name, const int frame)
+{
+    GoldenHash key;
+    snprintf(key.name, sizeof(key.name), "%s", name);
+    key.frame = frame;
+    return (GoldenHash *)bsearch(&key, golden, numGolden, sizeof(GoldenHash), compareGolden);
+}
+
+static Status loadMovie(const char * const filename)
+{
+    static const char * const buttonNames[] = { "A", "B", "SELECT", "START", "RIGHT", "LEFT", "UP", "DOWN" };
+    FILE *file = fopen(filename, "r");
+    if( NULL == file ) {
+        printf("Unable to read movie '%s'\n", filename);
+        return FAILURE;
+    }
+    char line[256];
+    int lineNumber = 0;
+    Status status = SUCCESS;
+    numMovie = 0;
+    while( (NULL != fgets(line, sizeof(line), file)) && (SUCCESS == status) ) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if( NULL != comment ) {
+            *comment = '\0';
+        }
+        char *token = strtok(line, " ,\t\r\n");
+        if( NULL == token ) {
+            continue;
+        }
+        if( FRAMEHASH_MAX_MOVIE <= numMovie ) {
+            printf("%s:%d: too many movie events\n", filename, lineNumber);
+            status = FAILURE;
+            break;
+        }
+        MovieEvent *event = &movie[numMovie++];
+        event->frame = atoi(token);
+        event->controls.val = 0;
+        while( NULL != (token = strtok(NULL, " ,\t\r\n")) ) {
+            int button;
+            for(button = 0; button < NUM_ELEMENTS(buttonNames); button++) {
+                if( 0 == strcasecmp(token, buttonNames[button]) ) {
+                    event->controls.val |= (1 << button);
+                    break;
+                }
+            }
+            if( (NUM_ELEMENTS(buttonNames) == button) && (0 != strcmp("-", token)) ) {
+                printf("%s:%d: unknown button '%s'\n", filename, lineNumber, token);
+                status = FAILURE;
+            }
+        }
+    }
+    fclose(file);
+    return status;
+}
+
+// Runs until the PPU finishes the next frame (or the LCD off equivalent)
+static void runFrame(void)
+{
+    const uint64_t limit = mainClock + 2*LCD_FRAME_DOTS;
+    guiUpdateScreen = false;
+    while( !guiUpdateScreen && (mainClock < limit) ) {
+        executeInstruction();
+    }
+    guiUpdateScreen = false;
+}
+
+// Returns the number of hashes that didn't match, or -1 if the workload couldn't be run
+static int hashWorkload(const char * const name, const char * const romFilename, const FrameHashArgs * const args, FILE * const output)
+{
+    gbInit(romFilename);
+    const uint64_t bootClocks = (uint64_t)BENCH_MAX_BOOT_FRAMES * LCD_FRAME_DOTS;
+    while( bootRomActive && (mainClock < bootClocks) ) {
+        executeInstruction();
+    }
+    if( bootRomActive ) {
+        printf("%s: boot ROM never finished\n", name);
+        gbDeinit();
+        return -1;
+    }
+
+    int mismatches = 0, hashes = 0;
+    int nextEvent = 0;
+    for(int frame = 1; frame <= args->frames; frame++) {
+        while( (nextEvent < numMovie) && (movie[nextEvent].frame <= frame) ) {
+            updateControls(movie[nextEvent++].controls);
+        }
+        runFrame();
+        if( 0 != (frame % args->every) ) {
+            continue;
+        }
+
+        const uint64_t hash = displayScreenHash();
+        hashes++;
+        if( NULL != output ) {
+            fprintf(output, "%s %d %016llx\n", name, frame, (unsigned long long)hash);
+            continue;
+        }
+        GoldenHash *entry = findGolden(name, frame);
+        if( NULL == entry ) {
+            if( FRAMEHASH_MAX_REPORTED > mismatches ) {
+                printf("  frame %6d: no golden hash, got %016llx\n", frame, (unsigned long long)hash);
+            }
+            mismatches++;
+        } else {
+            entry->checked = true;
+            if( hash != entry->hash ) {
+                if( FRAMEHASH_MAX_REPORTED > mismatches ) {
+                    printf("  frame %6d: expected %016llx, got %016llx\n", frame,
+                        (unsigned long long)entry->hash, (unsigned long long)hash);
+                }
+                mismatches++;
+            }
+        }
+    }
+    gbDeinit();
+    updateControls((ControlState){ .val = 0 });
+
+    if( FRAMEHASH_MAX_REPORTED < mismatches ) {
+        printf("  ...\n");
+    }
+    printf("%s: %d hashes%s", name, hashes, (NULL != output)? " recorded\n" : "");
+    if( NULL == output ) {
+        printf(", %d mismatched\n", mismatches);
+    }
+    return mismatches;
+}
+
+Status runFrameHashes(const char * const names[], const char * const romFilenames[], const int count, const FrameHashArgs * const args)
+{
+    if( (NULL != args->movie) && (SUCCESS != loadMovie(args->movie)) ) {
+        return FAILURE;
+    }
+    FILE *output = NULL;
+    if( args->update ) {
+        if( NULL == (output = fopen(args->golden, "w")) ) {
+            printf("Unable to write golden hashes '%s'\n", args->golden);
+            return FAILURE;
+        }
+        fprintf(output, "# gamegirl frame hashes: workload frame hash, %d frames every %d%s%s\n",
+            args->frames, args->every, (NULL != args->movie)? " with movie " : "", (NULL != args->movie)? args->movie : "");
+    } else if( SUCCESS != loadGolden(args->golden) ) {
+        return FAILURE;
+    }
+
+    int failures = 0;
+    for(int index = 0; index < count; index++) {
+        if( 0 != hashWorkload(names[index], romFilenames[index], args, output) ) {
+            failures++;
+        }
+    }
+
+    if( NULL != output ) {
+        fclose(output);
+        printf("\nGolden hashes written to '%s'\n", args->golden);
+        return (0 == failures)? SUCCESS : FAILURE;
+    }
+
+    // anything expected for the workloads that ran but never produced
+    int missing = 0;
+    for(int index = 0; index < numGolden; index++) {
+        for(int workload = 0; workload < count; workload++) {
+            if( !golden[index].checked && (0 == strcmp(names[workload], golden[index].name)) ) {
+                printf("%s: frame %d is in the golden file but wasn't hashed\n", golden[index].name, golden[index].frame);
+                missing++;
+            }
+        }
+    }
+    printf("\n%d of %d workloads mismatched\n", failures, count);
+    return ((0 == failures) && (0 == missing))? SUCCESS : FAILURE;
+}
@@ -0,0 +1,219 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "bench.h"
+#ifndef _WIN32
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Lockstep differential execution of two cpu cores
+//
+// All of the machine state is spread across file statics, so rather than cloning it the
+//  whole process is: each core runs in its own forked child on an identical machine.
+//  After every instruction a child publishes its register file, mainClock and the CPU
+//  writes that instruction made into a shared memory ring, and the parent compares the
+//  two streams record by record, stopping both at the first mismatch.
+// That needs fork and shared memory, so there's no lockstep mode on Windows.
+
+#ifndef _WIN32
+
+#define LOCKSTEP_RING_SIZE      (1 << 16)
+#define LOCKSTEP_RING_MASK      (LOCKSTEP_RING_SIZE - 1)
+#define LOCKSTEP_MAX_WRITES     (4)     // interrupt dispatch plus a push
+
+typedef struct {
+    uint64_t clock;                         // mainClock once the instruction is done
+    CpuState cpu;
+    uint8_t numWrites;                      // may be more than were kept
+    uint32_t writes[LOCKSTEP_MAX_WRITES];   // (addr << 8) | val8
+} LockstepRecord;
+
+typedef struct {
+    uint64_t head;          // written by the core's child
+    uint64_t tail;          // written by the parent
+    bool finished;
+    LockstepRecord ring[LOCKSTEP_RING_SIZE];
+} LockstepChannel;
+
+typedef struct {
+    bool stop;
+    LockstepChannel channels[2];
+} LockstepShared;
+
+static LockstepRecord *currentRecord;
+
+static void recordWrite(const uint16_t addr, const uint8_t val8)
+{
+    if( LOCKSTEP_MAX_WRITES > currentRecord->numWrites ) {
+        currentRecord->writes[currentRecord->numWrites] = ((uint32_t)addr << 8) | val8;
+    }
+    currentRecord->numWrites++;
+}
+
+static bool lockstepStopped(LockstepShared * const shared)
+{
+    return __atomic_load_n(&shared->stop, __ATOMIC_ACQUIRE);
+}
+
+// Runs in the child, never returns
+static void runCore(LockstepShared * const shared, LockstepChannel * const channel, const CpuCore * const core,
+                    const char * const romFilename, const int frames)
+{
+    gbInit(romFilename);
+    busWriteHook = recordWrite;
+
+    LockstepRecord record;
+    currentRecord = &record;
+    const uint64_t bootClocks = (uint64_t)BENCH_MAX_BOOT_FRAMES * LCD_FRAME_DOTS;
+    uint64_t target = bootClocks;
+    bool booting = true;
+    while( !lockstepStopped(shared) ) {
+        if( booting && (!bootRomActive || (mainClock >= bootClocks)) ) {
+            booting = false;
+            target = mainClock + (uint64_t)frames * LCD_FRAME_DOTS;
+        }
+        if( mainClock >= target ) {
+            break;
+        }
+
+        memset(&record, 0, sizeof(record));     // the parent compares the padding too
+        core->execute();
+        record.clock = mainClock;
+        getCpuState(&record.cpu);
+
+        while( (channel->head - __atomic_load_n(&channel->tail, __ATOMIC_ACQUIRE)) >= LOCKSTEP_RING_SIZE ) {
+            if( lockstepStopped(shared) ) {
+                _exit(0);
+            }
+            sched_yield();
+        }
+        channel->ring[channel->head & LOCKSTEP_RING_MASK] = record;
+        __atomic_store_n(&channel->head, channel->head + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&channel->finished, true, __ATOMIC_RELEASE);
+    _exit(0);
+}
+
+static void printRecord(const char * const name, const LockstepRecord * const record)
+{
+    const CpuState *cpu = &record->cpu;
+    printf("  %-12s A:%02X F:%02X B:%02X C:%02X D:%02X E:%02X H:%02X L:%02X SP:%04X PC:%04X IE:%02X IF:%02X IME:%d HALT:%d clock:%llu\n",
+        name, cpu->A, cpu->F, cpu->B, cpu->C, cpu->D, cpu->E, cpu->H, cpu->L, cpu->SP, cpu->PC,
+        cpu->IE, cpu->IF, cpu->interruptsEnabled, cpu->halted, (unsigned long long)record->clock);
+    printf("  %-12s %d write%s", "", record->numWrites, (1 == record->numWrites)? "" : "s");
+    for(int index = 0; index < MIN(record->numWrites, LOCKSTEP_MAX_WRITES); index++) {
+        printf(" [%04X]=%02X", record->writes[index] >> 8, record->writes[index] & 0xFF);
+    }
+    printf("\n");
+}
+
+Status runLockstep(const char * const romFilename, const CpuCore * const cores[2], const int frames, uint64_t * const instructions)
+{
+    LockstepShared *shared = (LockstepShared *)mmap(NULL, sizeof(LockstepShared), PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if( MAP_FAILED == shared ) {
+        printf("Unable to allocate the lockstep rings\n");
+        return FAILURE;
+    }
+    memset(shared, 0, sizeof(*shared));
+
+    pid_t pids[2];
+    fflush(stdout);
+    for(int core = 0; core < 2; core++) {
+        pids[core] = fork();
+        if( 0 == pids[core] ) {
+            if( 1 == core ) {
+                // both would print the same loading messages
+                freopen("/dev/null", "w", stdout);
+            }
+            runCore(shared, &shared->channels[core], cores[core], romFilename, frames);
+        } else if( 0 > pids[core] ) {
+            printf("Unable to start '%s'\n", cores[core]->name);
+            __atomic_store_n(&shared->stop, true, __ATOMIC_RELEASE);
+            if( 1 == core ) {
+                waitpid(pids[0], NULL, 0);
+            }
+            munmap(shared, sizeof(*shared));
+            return FAILURE;
+        }
+    }
+
+    LockstepChannel * const a = &shared->channels[0];
+    LockstepChannel * const b = &shared->channels[1];
+    Status status = SUCCESS;
+    uint64_t index = 0;
+    while( true ) {
+        const bool finished = __atomic_load_n(&a->finished, __ATOMIC_ACQUIRE) && __atomic_load_n(&b->finished, __ATOMIC_ACQUIRE);
+        const uint64_t headA = __atomic_load_n(&a->head, __ATOMIC_ACQUIRE);
+        const uint64_t headB = __atomic_load_n(&b->head, __ATOMIC_ACQUIRE);
+        const uint64_t available = MIN(headA, headB);
+
+        for(; index < available; index++) {
+            const LockstepRecord *recordA = &a->ring[index & LOCKSTEP_RING_MASK];
+            const LockstepRecord *recordB = &b->ring[index & LOCKSTEP_RING_MASK];
+            if( 0 != memcmp(recordA, recordB, sizeof(*recordA)) ) {
+                printf("Cores diverge at instruction %llu, opcode at %04X\n", (unsigned long long)index, (uint16_t)(recordA->cpu.PC - 1));
+                printRecord(cores[0]->name, recordA);
+                printRecord(cores[1]->name, recordB);
+                status = FAILURE;
+                break;
+            }
+        }
+        __atomic_store_n(&a->tail, index, __ATOMIC_RELEASE);
+        __atomic_store_n(&b->tail, index, __ATOMIC_RELEASE);
+
+        if( (SUCCESS != status) || finished ) {
+            if( (SUCCESS == status) && (headA != headB) ) {
+                printf("'%s' stopped after %llu instructions but '%s' ran %llu\n", cores[0]->name, (unsigned long long)headA,
+                    cores[1]->name, (unsigned long long)headB);
+                status = FAILURE;
+            }
+            break;
+        }
+        if( index == available ) {
+            // nothing new, make sure neither has died
+            for(int core = 0; core < 2; core++) {
+                if( (0 < pids[core]) && (0 != waitpid(pids[core], NULL, WNOHANG)) ) {
+                    pids[core] = 0;
+                    if( !__atomic_load_n(&shared->channels[core].finished, __ATOMIC_ACQUIRE) ) {
+                        printf("'%s' exited after %llu instructions without finishing\n", cores[core]->name, (unsigned long long)index);
+                        status = FAILURE;
+                    }
+                }
+            }
+            if( SUCCESS != status ) {
+                break;
+            }
+            sched_yield();
+        }
+    }
+
+    __atomic_store_n(&shared->stop, true, __ATOMIC_RELEASE);
+    for(int core = 0; core < 2; core++) {
+        if( 0 < pids[core] ) {
+            kill(pids[core], SIGKILL);
+            waitpid(pids[core], NULL, 0);
+        }
+    }
+    *instructions = index;
+    munmap(shared, sizeof(*shared));
+    return status;
+}
+
+#else
+
+Status runLockstep(const char * const romFilename, const CpuCore * const cores[2], const int frames, uint64_t * const instructions)
+{
+    printf("Lockstep needs fork, it isn't available on Windows\n");
+    *instructions = 0;
+    return FAILURE;
+}
+
+#endif
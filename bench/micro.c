@@ -0,0 +1,301 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "bench.h"
+#include "romcache.h"
+#include "breakpoints.h"
+#include "history.h"
+#include <unistd.h>
+
+// Per-subsystem micro benchmarks
+//
+// Each one drives a single hot path directly (executeInstruction, ppuCycles, timerTick or the
+//  raw bus accessors) so a change to cpu.cpp, display.cpp, timer.c or gb.c can be measured
+//  without the rest of the system diluting it.  State is prepared by booting one of the
+//  synthetic ROMs and letting it set up VRAM, OAM and registers, then the clock is stopped
+//  and only the subsystem under test is run.
+
+#define MICRO_CPU_INSTRUCTIONS  (2000000)
+#define MICRO_PPU_FRAMES        (60)
+#define MICRO_TIMER_TICKS       (20000000)
+#define MICRO_BUS_SWEEPS        (200)
+#define MICRO_SETUP_FRAMES      (10)
+
+typedef enum {
+    MICRO_CPU,
+    MICRO_CPU_WATCHED,
+    MICRO_CPU_HISTORY,
+    MICRO_PPU,
+    MICRO_TIMER,
+    MICRO_BUS_READ,
+    MICRO_BUS_WRITE,
+    MICRO_ROM_BANKED,
+    MICRO_ROM_MAPPER,
+} MicroKind;
+
+typedef struct {
+    const char *name;
+    const char *description;
+    MicroKind kind;
+    SynthRomType rom;
+    // results
+    uint64_t ops;           // per repetition
+    double seconds[BENCH_MAX_REPS];
+} MicroBench;
+
+static const char * const opNames[] = {
+    [MICRO_CPU]       = "instruction",
+    [MICRO_CPU_WATCHED] = "instruction",
+    [MICRO_CPU_HISTORY] = "instruction",
+    [MICRO_PPU]       = "dot",
+    [MICRO_TIMER]     = "tick",
+    [MICRO_BUS_READ]  = "read",
+    [MICRO_BUS_WRITE] = "write",
+    [MICRO_ROM_BANKED] = "read",
+    [MICRO_ROM_MAPPER] = "read",
+};
+
+// volatile so the bus sweeps can't be optimized away
+static volatile uint8_t sink;
+
+static void bootSynthRom(const char * const filename)
+{
+    gbInit(filename);
+    while( bootRomActive ) {
+        executeInstruction();
+    }
+    // give the ROM time to finish its own setup
+    const uint64_t target = mainClock + (uint64_t)MICRO_SETUP_FRAMES * LCD_FRAME_DOTS;
+    while( mainClock < target ) {
+        executeInstruction();
+    }
+}
+
+static uint64_t microCpu(void)
+{
+    // the PPU still gets clocked from the bus, keep it on its cheapest path
+    setGfxReg8(REG_LCDC_ADDR, 0x00);
+    for(int count = 0; count < MICRO_CPU_INSTRUCTIONS; count++) {
+        executeInstruction();
+    }
+    return MICRO_CPU_INSTRUCTIONS;
+}
+
+// The same with breakpoints on the pages being run and accessed, none of which ever fire,
+//  for comparing against the unwatched run
+static uint64_t microCpuWatched(void)
+{
+    breakpointAdd(BREAK_EXEC, "0100");
+    breakpointAdd(BREAK_READ | BREAK_WRITE, "C000-DFFF,VAL>FF");
+    breakpointAdd(BREAK_READ | BREAK_WRITE, "FF80-FFFE,VAL>FF");
+    const uint64_t ops = microCpu();
+    breakpointClearAll();
+    return ops;
+}
+
+// The same again recording the instruction history, which headless runs leave off
+static uint64_t microCpuHistory(void)
+{
+    if( SUCCESS != historyStart() ) {
+        return microCpu();
+    }
+    const uint64_t ops = microCpu();
+    historyStop();
+    return ops;
+}
+
+static uint64_t microPpu(void)
+{
+    for(int frame = 0; frame < MICRO_PPU_FRAMES; frame++) {
+        ppuCycles(LCD_FRAME_DOTS);
+    }
+    return (uint64_t)MICRO_PPU_FRAMES * LCD_FRAME_DOTS;
+}
+
+static uint64_t microTimer(void)
+{
+    setTimerReg8(REG_TAC_ADDR, 0x05);   // enabled, fastest rate so TIMA overflows often
+    for(int tick = 0; tick < MICRO_TIMER_TICKS; tick++) {
+        timerTick();
+    }
+    return MICRO_TIMER_TICKS;
+}
+
+static uint64_t microBusRead(void)
+{
+    uint8_t value = 0;
+    for(int sweep = 0; sweep < MICRO_BUS_SWEEPS; sweep++) {
+        for(int addr = 0; addr <= 0xFFFF; addr++) {
+            value += getRawMem8(addr);
+        }
+    }
+    sink = value;
+    return (uint64_t)MICRO_BUS_SWEEPS * 0x10000;
+}
+
+static uint64_t microBusWrite(void)
+{
+    // only the RAM regions, a sweep over the IO registers would reconfigure the system
+    static const struct { uint16_t start; uint16_t end; } regions[] = {
+        { 0x8000, 0x9FFF }, // VRAM
+        { 0xC000, 0xFDFF }, // WRAM and echo
+        { 0xFE00, 0xFE9F }, // OAM
+        { 0xFF80, 0xFFFE }, // HRAM
+    };
+    uint64_t ops = 0;
+    for(int sweep = 0; sweep < MICRO_BUS_SWEEPS; sweep++) {
+        for(int index = 0; index < NUM_ELEMENTS(regions); index++) {
+            for(int addr = regions[index].start; addr <= regions[index].end; addr++) {
+                setRawMem8(addr, (uint8_t)(addr + sweep));
+            }
+            ops += regions[index].end - regions[index].start + 1;
+        }
+    }
+    return ops;
+}
+
+// Cartridge ROM reads the way the bus does them, through the bank pointers the mapper publishes
+static uint64_t microRomBanked(void)
+{
+    uint8_t value = 0;
+    for(int sweep = 0; sweep < MICRO_BUS_SWEEPS; sweep++) {
+        for(int addr = 0; addr <= 0x7FFF; addr++) {
+            value += cartRomBank[addr >> 14][addr & 0x3FFF];
+        }
+    }
+    sink = value;
+    return (uint64_t)MICRO_BUS_SWEEPS * 0x8000;
+}
+
+// The same reads through the virtual mapper call the bus used to make, for comparison
+static uint64_t microRomMapper(void)
+{
+    uint8_t value = 0;
+    for(int sweep = 0; sweep < MICRO_BUS_SWEEPS; sweep++) {
+        for(int addr = 0; addr <= 0x7FFF; addr++) {
+            value += getCartRom8(addr);
+        }
+    }
+    sink = value;
+    return (uint64_t)MICRO_BUS_SWEEPS * 0x8000;
+}
+
+static void runMicroBench(MicroBench * const bench, const char * const romFilename, const int reps)
+{
+    bootSynthRom(romFilename);
+    for(int rep = 0; rep < reps; rep++) {
+        const double start = benchSeconds();
+        switch( bench->kind ) {
+            case MICRO_CPU:         bench->ops = microCpu();        break;
+            case MICRO_CPU_WATCHED: bench->ops = microCpuWatched(); break;
+            case MICRO_CPU_HISTORY: bench->ops = microCpuHistory(); break;
+            case MICRO_PPU:         bench->ops = microPpu();        break;
+            case MICRO_TIMER:       bench->ops = microTimer();      break;
+            case MICRO_BUS_READ:    bench->ops = microBusRead();    break;
+            case MICRO_BUS_WRITE:   bench->ops = microBusWrite();   break;
+            case MICRO_ROM_BANKED:  bench->ops = microRomBanked();  break;
+            case MICRO_ROM_MAPPER:  bench->ops = microRomMapper();  break;
+        }
+        bench->seconds[rep] = benchSeconds() - start;
+    }
+    gbDeinit();
+}
+
+static double nsPerOp(const MicroBench * const bench, const int reps)
+{
+    return benchMedian(bench->seconds, reps) * 1e9 / bench->ops;
+}
+
+static void writeMicroResults(FILE *file, const MicroBench * const benches, const int numBenches, const int reps)
+{
+    fprintf(file, "{\n");
+    fprintf(file, "  \"repetitions\": %d,\n", reps);
+    fprintf(file, "  \"micro\": [\n");
+    for(int index = 0; index < numBenches; index++) {
+        const MicroBench *bench = &benches[index];
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": \"%s\",\n", bench->name);
+        fprintf(file, "      \"description\": \"%s\",\n", bench->description);
+        fprintf(file, "      \"op\": \"%s\",\n", opNames[bench->kind]);
+        fprintf(file, "      \"ops\": %llu,\n", (unsigned long long)bench->ops);
+        fprintf(file, "      \"seconds\": [");
+        for(int rep = 0; rep < reps; rep++) {
+            fprintf(file, "%s%.6f", (rep)? ", " : "", bench->seconds[rep]);
+        }
+        fprintf(file, "],\n");
+        fprintf(file, "      \"nsPerOp\": %.3f\n", nsPerOp(bench, reps));
+        fprintf(file, "    }%s\n", (index < (numBenches-1))? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+Status runMicroBenchmarks(const char * const tempDir, const int reps, const char * const select, const char * const output)
+{
+    static MicroBench benches[] = {
+        { "cpu-alu",       "register ALU and CB prefixed instructions",        MICRO_CPU,       SYNTH_ROM_ALU },
+        { "cpu-loadstore", "loads, stores and stack traffic to WRAM and HRAM", MICRO_CPU,       SYNTH_ROM_LOADSTORE },
+        { "cpu-mix",       "ALU, memory, stack and call instruction mix",      MICRO_CPU,       SYNTH_ROM_CPU },
+        { "cpu-watched",   "cpu-loadstore with watchpoints that never fire",   MICRO_CPU_WATCHED, SYNTH_ROM_LOADSTORE },
+        { "cpu-history",   "cpu-mix recording the instruction history",        MICRO_CPU_HISTORY, SYNTH_ROM_CPU },
+        { "ppu-background","background only",                                  MICRO_PPU,       SYNTH_ROM_HALT },
+        { "ppu-window",    "background and window split",                      MICRO_PPU,       SYNTH_ROM_SCROLL },
+        { "ppu-sprites",   "ten 8x16 objects per line",                        MICRO_PPU,       SYNTH_ROM_SPRITES },
+        { "timer",         "timerTick with TIMA counting at 262kHz",           MICRO_TIMER,     SYNTH_ROM_HALT },
+        { "bus-read",      "getRawMem8 sweep over the whole address space",    MICRO_BUS_READ,  SYNTH_ROM_HALT },
+        { "bus-write",     "setRawMem8 sweep over VRAM, WRAM, OAM and HRAM",   MICRO_BUS_WRITE, SYNTH_ROM_HALT },
+        { "rom-banked",    "cartridge ROM reads through the bank pointers",    MICRO_ROM_BANKED, SYNTH_ROM_HALT },
+        { "rom-mapper",    "cartridge ROM reads through the virtual mapper",   MICRO_ROM_MAPPER, SYNTH_ROM_HALT },
+    };
+
+    char filenames[NUM_SYNTH_ROMS][1024] = {0};
+    Status status = SUCCESS;
+    int numBenches = 0;
+
+    for(int index = 0; index < NUM_ELEMENTS(benches); index++) {
+        MicroBench *bench = &benches[index];
+        if( (NULL != select) && (NULL == strstr(bench->name, select)) ) {
+            continue;
+        }
+        if( '\0' == filenames[bench->rom][0] ) {
+            snprintf(filenames[bench->rom], sizeof(filenames[bench->rom]), "%s/micro%d.gb", tempDir, bench->rom);
+            if( SUCCESS != writeSynthRom(bench->rom, filenames[bench->rom]) ) {
+                status = FAILURE;
+                break;
+            }
+        }
+        runMicroBench(bench, filenames[bench->rom], reps);
+        benches[numBenches++] = *bench;
+    }
+
+    if( SUCCESS == status ) {
+        printf("\n%-16s %-12s %12s\n", "micro", "op", "ns/op");
+        for(int index = 0; index < numBenches; index++) {
+            printf("%-16s %-12s %12.3f\n", benches[index].name, opNames[benches[index].kind], nsPerOp(&benches[index], reps));
+        }
+
+        FILE *file = (0 == strcmp("-", output))? stdout : fopen(output, "w");
+        if( NULL == file ) {
+            printf("Unable to write '%s'\n", output);
+            status = FAILURE;
+        } else {
+            writeMicroResults(file, benches, numBenches, reps);
+            if( stdout != file ) {
+                fclose(file);
+                printf("Results written to '%s'\n", output);
+            }
+        }
+    }
+
+    char filename[1100];
+    for(int rom = 0; rom < NUM_SYNTH_ROMS; rom++) {
+        if( '\0' != filenames[rom][0] ) {
+            unlink(filenames[rom]);
+            snprintf(filename, sizeof(filename), "%s%s", filenames[rom], ROMCACHE_EXTENSION);
+            unlink(filename);
+        }
+    }
+    return status;
+}
@@ -0,0 +1,206 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "bench.h"
+
+// Synthetic benchmark ROMs
+//
+// Small hand assembled 32K ROMs that each stress one part of the system.  They carry a valid
+//  header (logo taken from the boot ROM) so they boot exactly like a real cartridge.
+
+#define SYNTH_OAM_TABLE     (0x1000)
+#define BOOTROM_LOGO_OFFSET (0xA8)
+
+typedef struct {
+    uint8_t image[0x8000];
+    int pc;
+} SynthRom;
+
+#define EMIT(rom, ...)  synthEmit(rom, (const uint8_t[]){ __VA_ARGS__ }, sizeof((const uint8_t[]){ __VA_ARGS__ }))
+
+static void synthEmit(SynthRom * const rom, const uint8_t * const bytes, const size_t length)
+{
+    memcpy(&rom->image[rom->pc], bytes, length);
+    rom->pc += length;
+}
+
+// relative branch back to label
+static void synthJr(SynthRom * const rom, const uint8_t opcode, const int label)
+{
+    EMIT(rom, opcode, (uint8_t)(label - (rom->pc + 2)));
+}
+
+// spin until LY is (or is no longer) line
+static void synthWaitLy(SynthRom * const rom, const uint8_t line, const bool equal)
+{
+    const int label = rom->pc;
+    EMIT(rom, 0xF0, 0x44, 0xFE, line);          // ldh a,[LY]; cp line
+    synthJr(rom, (equal)? 0x20 : 0x28, label);  // jr nz / jr z
+}
+
+static void synthInit(SynthRom * const rom)
+{
+    rom->pc = 0x150;
+    EMIT(rom, 0xF3, 0x31, 0xFE, 0xFF);              // di; ld sp,$FFFE
+    synthWaitLy(rom, 144, true);
+    EMIT(rom, 0xAF, 0xE0, 0x40);                    // xor a; ldh [LCDC],a
+
+    // tile data and both maps filled with the low address byte
+    EMIT(rom, 0x21, 0x00, 0x80, 0x01, 0x00, 0x20);  // ld hl,$8000; ld bc,$2000
+    const int fill = rom->pc;
+    EMIT(rom, 0x7D, 0x22, 0x0B, 0x78, 0xB1);        // ld a,l; ld [hl+],a; dec bc; ld a,b; or c
+    synthJr(rom, 0x20, fill);
+
+    EMIT(rom, 0x3E, 0xE4, 0xE0, 0x47, 0xE0, 0x48, 0xE0, 0x49);  // BGP = OBP0 = OBP1 = $E4
+
+    EMIT(rom, 0x21, 0x00, 0xFE, 0x06, 0xA0, 0xAF);  // ld hl,$FE00; ld b,160; xor a
+    const int clear = rom->pc;
+    EMIT(rom, 0x22, 0x05);                          // ld [hl+],a; dec b
+    synthJr(rom, 0x20, clear);
+}
+
+static void synthScroll(SynthRom * const rom)
+{
+    EMIT(rom, 0x3E, 72, 0xE0, 0x4A);                // WY = 72
+    EMIT(rom, 0x3E, 87, 0xE0, 0x4B);                // WX = 87
+    EMIT(rom, 0x3E, 0xF1, 0xE0, 0x40);              // LCD, window on $9C00, BG tiles $8000, BG on
+    const int loop = rom->pc;
+    synthWaitLy(rom, 144, true);
+    EMIT(rom, 0xF0, 0x43, 0x3C, 0xE0, 0x43);        // SCX++
+    EMIT(rom, 0xF0, 0x42, 0x3C, 0xE0, 0x42);        // SCY++
+    synthWaitLy(rom, 144, false);
+    synthJr(rom, 0x18, loop);
+}
+
+static void synthSprites(SynthRom * const rom)
+{
+    // 4 rows of 10 8x16 objects, every covered line has the maximum 10 objects
+    for(int index = 0; index < 40; index++) {
+        uint8_t *entry = &rom->image[SYNTH_OAM_TABLE + index*4];
+        entry[0] = 16 + (index / 10) * 36;
+        entry[1] = 8 + (index % 10) * 16;
+        entry[2] = index * 2;
+        entry[3] = (index & 1)? 0x30 : 0x00;       // alternate palettes & flips
+    }
+    EMIT(rom, 0x21, 0x00, 0xFE, 0x11, SYNTH_OAM_TABLE & 0xFF, SYNTH_OAM_TABLE >> 8, 0x06, 0xA0);
+    const int copy = rom->pc;
+    EMIT(rom, 0x1A, 0x13, 0x22, 0x05);              // ld a,[de]; inc de; ld [hl+],a; dec b
+    synthJr(rom, 0x20, copy);
+    EMIT(rom, 0x3E, 0x97, 0xE0, 0x40);              // LCD, BG tiles $8000, 8x16 objects, objects, BG on
+
+    const int loop = rom->pc;
+    synthWaitLy(rom, 144, true);
+    EMIT(rom, 0x21, 0x00, 0xFE, 0x06, 40);          // ld hl,$FE00; ld b,40
+    const int move = rom->pc;
+    EMIT(rom, 0x7E, 0x3C, 0x77, 0x2C, 0x2C, 0x2C, 0x2C, 0x05);  // y++ for each object
+    synthJr(rom, 0x20, move);
+    synthWaitLy(rom, 144, false);
+    synthJr(rom, 0x18, loop);
+}
+
+static void synthHalt(SynthRom * const rom)
+{
+    rom->image[0x40] = 0xD9;                        // vblank: reti
+    EMIT(rom, 0x3E, 0x91, 0xE0, 0x40);              // LCD, BG tiles $8000, BG on
+    EMIT(rom, 0x3E, 0x01, 0xE0, 0xFF);              // IE = vblank
+    EMIT(rom, 0xAF, 0xE0, 0x0F, 0xFB);              // IF = 0; ei
+    const int loop = rom->pc;
+    EMIT(rom, 0x76);                                // halt
+    synthJr(rom, 0x18, loop);
+}
+
+static void synthCpu(SynthRom * const rom)
+{
+    EMIT(rom, 0x3E, 0x91, 0xE0, 0x40);              // LCD, BG tiles $8000, BG on
+    const int loop = rom->pc;
+    EMIT(rom, 0x21, 0x00, 0xC0, 0x06, 0x00);        // ld hl,$C000; ld b,0
+    const int inner = rom->pc;
+    EMIT(rom, 0x78, 0xCB, 0x37, 0x80, 0x22, 0xC5);  // ld a,b; swap a; add a,b; ld [hl+],a; push bc
+    const int call = rom->pc;
+    EMIT(rom, 0xCD, 0x00, 0x00);                    // call sub (patched below)
+    EMIT(rom, 0xC1, 0x05);                          // pop bc; dec b
+    synthJr(rom, 0x20, inner);
+    synthJr(rom, 0x18, loop);
+
+    rom->image[call+1] = rom->pc & 0xFF;
+    rom->image[call+2] = rom->pc >> 8;
+    EMIT(rom, 0x2B, 0xAE, 0x2F, 0xCB, 0x00, 0x23, 0xC9);  // dec hl; xor [hl]; cpl; rlc b; inc hl; ret
+}
+
+// register only ALU, rotate and bit operations, LCD left off
+static void synthAlu(SynthRom * const rom)
+{
+    EMIT(rom, 0x01, 0x34, 0x12, 0x11, 0x78, 0x56);  // ld bc,$1234; ld de,$5678
+    const int loop = rom->pc;
+    EMIT(rom, 0x80, 0x89, 0x92, 0xA3, 0xB4, 0xAD);  // add a,b; adc a,c; sub d; and e; or h; xor l
+    EMIT(rom, 0xB8, 0x0C, 0x15, 0x07, 0x1F, 0x27);  // cp b; inc c; dec d; rlca; rra; daa
+    EMIT(rom, 0xCB, 0x37, 0xCB, 0x5F, 0xCB, 0x11);  // swap a; bit 3,a; rl c
+    EMIT(rom, 0xCB, 0xCA, 0xCB, 0x93, 0x09, 0x13);  // set 1,d; res 2,e; add hl,bc; inc de
+    EMIT(rom, 0x05);                                // dec b
+    synthJr(rom, 0x20, loop);
+    synthJr(rom, 0x18, loop);
+}
+
+// loads, stores and stack traffic to WRAM and HRAM, LCD left off
+static void synthLoadStore(SynthRom * const rom)
+{
+    const int loop = rom->pc;
+    EMIT(rom, 0x21, 0x00, 0xC0, 0x11, 0x00, 0xD0, 0x06, 0x00);  // ld hl,$C000; ld de,$D000; ld b,0
+    const int inner = rom->pc;
+    EMIT(rom, 0x2A, 0x12, 0x13, 0xE0, 0x80, 0xF0, 0x81);        // ld a,[hl+]; ld [de],a; inc de; ldh [$80],a; ldh a,[$81]
+    EMIT(rom, 0xE5, 0xD5, 0xD1, 0xE1, 0x77, 0x4E);              // push hl; push de; pop de; pop hl; ld [hl],a; ld c,[hl]
+    EMIT(rom, 0xEA, 0x00, 0xC8, 0xFA, 0x01, 0xC8, 0x05);        // ld [$C800],a; ld a,[$C801]; dec b
+    synthJr(rom, 0x20, inner);
+    synthJr(rom, 0x18, loop);
+}
+
+Status writeSynthRom(const SynthRomType type, const char * const filename)
+{
+    static const char * const titles[NUM_SYNTH_ROMS] = {
+        "BENCH SCROLL", "BENCH SPRITES", "BENCH HALT", "BENCH CPU", "BENCH ALU", "BENCH LOADSTORE"
+    };
+    static SynthRom rom;
+    memset(&rom, 0, sizeof(rom));
+
+    // cartridge header: nop; jp $0150, then the logo the boot ROM checks against
+    memcpy(&rom.image[CART_HEADER_OFFSET], (const uint8_t[]){ 0x00, 0xC3, 0x50, 0x01 }, 4);
+    FILE *bootrom = fopen("resources/ROMs/DMG_ROM.bin", "rb");
+    if( NULL == bootrom ) {
+        printf("Synthetic ROMs need resources/ROMs/DMG_ROM.bin, run from the repository root\n");
+        return FAILURE;
+    }
+    fseek(bootrom, BOOTROM_LOGO_OFFSET, SEEK_SET);
+    size_t logoLength = fread(&rom.image[CART_HEADER_OFFSET + 4], 1, 48, bootrom);
+    fclose(bootrom);
+    if( 48 != logoLength ) {
+        return FAILURE;
+    }
+    strncpy((char *)&rom.image[CART_HEADER_CHECK_START], titles[type], 15);
+
+    synthInit(&rom);
+    switch( type ) {
+        case SYNTH_ROM_SCROLL:      synthScroll(&rom);      break;
+        case SYNTH_ROM_SPRITES:     synthSprites(&rom);     break;
+        case SYNTH_ROM_HALT:        synthHalt(&rom);        break;
+        case SYNTH_ROM_CPU:         synthCpu(&rom);         break;
+        case SYNTH_ROM_ALU:         synthAlu(&rom);         break;
+        case SYNTH_ROM_LOADSTORE:   synthLoadStore(&rom);   break;
+        default: return FAILURE;
+    }
+
+    CartridgeHeader *header = (CartridgeHeader *)&rom.image[CART_HEADER_OFFSET];
+    header->headerChecksum = cartHeaderChecksum(rom.image);
+    uint16_t globalChecksum = cartGlobalChecksum(rom.image, sizeof(rom.image));
+    header->globalChecksum = (globalChecksum >> 8) | (globalChecksum << 8);
+
+    FILE *file = fopen(filename, "wb");
+    if( NULL == file ) {
+        return FAILURE;
+    }
+    size_t written = fwrite(rom.image, 1, sizeof(rom.image), file);
+    fclose(file);
+    return (sizeof(rom.image) == written)? SUCCESS : FAILURE;
+}
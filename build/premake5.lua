@@ -14,6 +14,24 @@ newoption
 	default = "opengl33"
 }
 
+newoption
+{
+	trigger = "zstd",
+	description = "support zstd compressed ROMs (requires libzstd)"
+}
+
+newoption
+{
+	trigger = "profile",
+	description = "count executions and cycles per opcode, dumped on exit (F9 while running)"
+}
+
+newoption
+{
+	trigger = "nohistory",
+	description = "leave out the debugger's instruction history entirely"
+}
+
 function download_progress(total, current)
     local ratio = current / total;
     ratio = math.min(math.max(ratio, 0), 1);
@@ -89,6 +107,59 @@ function platform_defines()
     filter{}
 end
 
+-- compiler and link settings shared by every project built from the emulator sources
+function emulator_settings()
+    includedirs { "../src" }
+    includedirs { "../include" }
+
+    links {"raylib"}
+
+    cdialect "C17"
+    cppdialect "C++17"
+
+    includedirs {raylib_dir .. "/src" }
+    includedirs {raylib_dir .."/src/external" }
+    includedirs {raylib_dir .."/src/external/glfw/include" }
+    includedirs {raygui_dir .. "/src" }
+    flags { "ShadowedVariables"}
+    platform_defines()
+
+    filter "action:vs*"
+        defines{"_WINSOCK_DEPRECATED_NO_WARNINGS", "_CRT_SECURE_NO_WARNINGS"}
+        dependson {"raylib"}
+        links {"raylib.lib"}
+        characterset ("Unicode")
+        buildoptions { "/Zc:__cplusplus" }
+
+    filter "system:windows"
+        defines{"_WIN32"}
+        -- pthread is MinGW's winpthreads, which also provides clock_gettime, nanosleep and sched_yield
+        links {"winmm", "gdi32", "opengl32", "pthread"}
+        libdirs {"../bin/%{cfg.buildcfg}"}
+
+    filter "system:linux"
+        links {"pthread", "m", "dl", "rt", "X11", "z"}
+        defines {"GAMEGIRL_ZLIB"}
+
+    filter "system:macosx"
+        links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework", "argp", "z"}
+        defines {"GAMEGIRL_ZLIB"}
+        libdirs {"/opt/homebrew/Cellar/argp-standalone/1.5.0/lib/"}
+        includedirs {"/opt/homebrew/Cellar/argp-standalone/1.5.0/include/"}
+
+    filter "options:zstd"
+        links {"zstd"}
+        defines {"GAMEGIRL_ZSTD"}
+
+    filter "options:profile"
+        defines {"GAMEGIRL_PROFILE"}
+
+    filter "options:nohistory"
+        defines {"GAMEGIRL_NO_HISTORY"}
+
+    filter{}
+end
+
 -- if you don't want to download raylib, then set this to false, and set the raylib dir to where you want raylib to be pulled from, must be full sources.
 downloadRaylib = true
 raylib_version = "5.5"
@@ -170,46 +241,65 @@ workspace (workspaceName)
             ["Source Files/*"] = {"../src/**.c", "src/**.cpp"},
         }
         files {"../src/**.c", "../src/**.cpp", "../src/**.h", "../src/**.hpp", "../include/**.h", "../include/**.hpp"}
-        removefiles {"../src/cpu_dis.c"}
 
-        includedirs { "../src" }
-        includedirs { "../include" }
+        emulator_settings()
+
+    -- headless throughput benchmarks, run from the repository root: bin/Release/gamegirl-bench
+    project "gamegirl-bench"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
 
-        links {"raylib"}
+        filter "action:vs*"
+            debugdir "$(SolutionDir)"
 
-        cdialect "C17"
-        cppdialect "C++17"
+        filter{}
 
-        includedirs {raylib_dir .. "/src" }
-        includedirs {raylib_dir .."/src/external" }
-        includedirs {raylib_dir .."/src/external/glfw/include" }
-        includedirs {raygui_dir .. "/src" }
-        flags { "ShadowedVariables"}
-        platform_defines()
+        vpaths
+        {
+            ["Header Files/*"] = { "../src/**.h", "../bench/**.h"},
+            ["Source Files/*"] = {"../src/**.c", "../src/**.cpp", "../bench/**.c"},
+        }
+        files {"../src/**.c", "../src/**.cpp", "../src/**.h", "../bench/**.c", "../bench/**.h", "../include/**.h"}
+        removefiles {"../src/main.c"}
+        defines {"GAMEGIRL_BENCH"}
+
+        emulator_settings()
+
+    -- finds the first divergence between two doctor logs, text or binary
+    project "tracediff"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+        files {"../tools/tracediff.c", "../src/doctorlog_format.h"}
+        includedirs { "../src" }
+        cdialect "C17"
 
         filter "action:vs*"
-            defines{"_WINSOCK_DEPRECATED_NO_WARNINGS", "_CRT_SECURE_NO_WARNINGS"}
-            dependson {"raylib"}
-            links {"raylib.lib"}
-            characterset ("Unicode")
-            buildoptions { "/Zc:__cplusplus" }
+            defines{"_CRT_SECURE_NO_WARNINGS"}
+
+        filter{}
 
-        filter "system:windows"
-            defines{"_WIN32"}
-            links {"winmm", "gdi32", "opengl32"}
-            libdirs {"../bin/%{cfg.buildcfg}"}
+    -- converts binary doctor logs (gamegirl --binaryLog) to Gameboy-Doctor text
+    project "doctorlog"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+        files {"../tools/doctorlog.c", "../src/doctorlog_format.h"}
+        includedirs { "../src" }
+        cdialect "C17"
 
-        filter "system:linux"
-            links {"pthread", "m", "dl", "rt", "X11"}
+        filter "action:vs*"
+            defines{"_CRT_SECURE_NO_WARNINGS"}
 
-        filter "system:macosx"
-            links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework", "argp"}
-            libdirs {"/opt/homebrew/Cellar/argp-standalone/1.5.0/lib/"}
-            includedirs {"/opt/homebrew/Cellar/argp-standalone/1.5.0/include/"}
+        filter "options:zstd"
+            links {"zstd"}
+            defines {"GAMEGIRL_ZSTD"}
 
         filter{}
 
 
+
     project "raylib"
         kind "StaticLib"
 
@@ -0,0 +1,23 @@
+#version 330
+
+// Applies a palette to tiles drawn from the tile atlas, see guiDrawTile2()
+//  The atlas holds raw 2-bit color indexes stored as (3-index)*85, and the red channel of
+//  the vertex color picks the palette, so tiles with different palettes share one batch.
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D texture0;     // tile atlas
+uniform vec4 palettes[3*4];     // BGP, OBP0 and OBP1 applied
+
+out vec4 finalColor;
+
+void main()
+{
+    int colorIndex = 3 - int(texture(texture0, fragTexCoord).r * 3.0 + 0.5);
+    int palette = int(fragColor.r * 255.0 + 0.5);
+    if( (0 != palette) && (0 == colorIndex) ) {
+        discard;    // object color 0 is transparent
+    }
+    finalColor = palettes[palette*4 + colorIndex];
+}
@@ -0,0 +1,25 @@
+#version 330
+
+// Draws a whole 32x32 background tile map in one quad, see guiDrawDisplayTileMap()
+//  texture0 holds the tile references for both maps stacked vertically (32x64), the quad
+//  samples one half of it.  The tiles come from the atlas as raw 2-bit color indexes.
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D texture0;     // tile maps, one byte per tile reference
+uniform sampler2D tileAtlas;    // 384 tiles, 16 across, (3-index)*85 per pixel
+uniform int signedTileData;     // LCDC.4 clear: references are signed, from tile 256
+uniform vec4 palette[4];        // BGP applied
+
+out vec4 finalColor;
+
+void main()
+{
+    ivec2 pixel = ivec2(floor(fragTexCoord * vec2(32.0*8.0, 64.0*8.0)));
+    int tileRef = int(texelFetch(texture0, pixel / 8, 0).r * 255.0 + 0.5);
+    int tile = ((1 == signedTileData) && (128 > tileRef))? tileRef + 256 : tileRef;
+    ivec2 atlasPixel = ivec2((tile % 16) * 8, (tile / 16) * 8) + (pixel % 8);
+    int colorIndex = 3 - int(texelFetch(tileAtlas, atlasPixel, 0).r * 3.0 + 0.5);
+    finalColor = palette[colorIndex];
+}
@@ -6,6 +6,7 @@
 
 #include "gb.h"
 #include "gui.h"
+#include "rewind.h"
 
 struct {
     union {
@@ -451,6 +452,12 @@ void guiDrawAudio(void)
 void audioInit(void)
 {
     addRegView(&audioRegView, "AUDIO");
+
+    ADD_REWIND_STATE(regs);
+    ADD_REWIND_STATE(ch1);
+    ADD_REWIND_STATE(ch2);
+    ADD_REWIND_STATE(ch3);
+    ADD_REWIND_STATE(ch4);
 }
 
 void audioDeinit(void)
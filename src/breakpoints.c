@@ -0,0 +1,274 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "breakpoints.h"
+#include "rewind.h"
+#include <strings.h>
+
+// Breakpoints and watchpoints
+//
+// Each one covers an address range for any of BREAK_EXEC, BREAK_READ and BREAK_WRITE, with an
+//  optional condition.  breakPages flags the pages anything is set on and breakBits the exact
+//  addresses, so the cpu and the bus only leave their fast path for a page that has one, and
+//  conditions are only evaluated for an address that does.  Watchpoints fire in the middle of
+//  an instruction, so they're held in breakPending until it finishes.
+
+typedef enum {
+    OPERAND_NONE = 0,
+    OPERAND_A, OPERAND_F, OPERAND_B, OPERAND_C, OPERAND_D, OPERAND_E, OPERAND_H, OPERAND_L,
+    OPERAND_AF, OPERAND_BC, OPERAND_DE, OPERAND_HL, OPERAND_SP, OPERAND_PC,
+    OPERAND_MEM,    // [ADDR]
+    OPERAND_VAL,    // the byte being read or written
+} ConditionOperand;
+
+typedef enum {
+    COND_EQ, COND_NE, COND_LT, COND_GT, COND_LE, COND_GE,
+} ConditionOperator;
+
+typedef struct {
+    ConditionOperand operand;
+    ConditionOperator op;
+    uint16_t addr;      // OPERAND_MEM
+    uint16_t value;
+} BreakCondition;
+
+typedef struct {
+    uint8_t kinds;
+    uint16_t start;
+    uint16_t end;       // inclusive
+    BreakCondition condition;
+    uint32_t hits;
+    char spec[48];
+} Breakpoint;
+
+uint8_t breakPages[256];
+bool breakPending = false;
+
+static uint8_t breakBits[65536];    // BREAK_* set on each address
+static Breakpoint breakpoints[BREAKPOINT_MAX];
+static int numBreakpoints = 0;
+
+static const char * const operandNames[] = {
+    [OPERAND_A] = "A",   [OPERAND_F] = "F",   [OPERAND_B] = "B",   [OPERAND_C] = "C",
+    [OPERAND_D] = "D",   [OPERAND_E] = "E",   [OPERAND_H] = "H",   [OPERAND_L] = "L",
+    [OPERAND_AF] = "AF", [OPERAND_BC] = "BC", [OPERAND_DE] = "DE", [OPERAND_HL] = "HL",
+    [OPERAND_SP] = "SP", [OPERAND_PC] = "PC", [OPERAND_VAL] = "VAL",
+};
+
+static Status parseHex16(const char * const text, const char ** const end, uint16_t * const value)
+{
+    char *parsed;
+    const long number = strtol(text, &parsed, 16);
+    if( (parsed == text) || (0 > number) || (0xFFFF < number) ) {
+        return FAILURE;
+    }
+    *value = (uint16_t)number;
+    *end = parsed;
+    return SUCCESS;
+}
+
+static Status parseCondition(const char * const text, BreakCondition * const condition)
+{
+    static const struct { const char *name; ConditionOperator op; } operators[] = {
+        { "==", COND_EQ }, { "!=", COND_NE }, { "<=", COND_LE }, { ">=", COND_GE }, { "<", COND_LT }, { ">", COND_GT },
+    };
+
+    // operand
+    const char *opText = strpbrk(text, "=!<>");
+    const int length = (NULL != opText)? (opText - text) : 0;
+    if( 0 == length ) {
+        return FAILURE;
+    }
+    condition->operand = OPERAND_NONE;
+    if( '[' == text[0] ) {
+        const char *end;
+        if( (SUCCESS != parseHex16(text+1, &end, &condition->addr)) || (']' != *end) || ((end+1) != opText) ) {
+            return FAILURE;
+        }
+        condition->operand = OPERAND_MEM;
+    } else {
+        for(int operand = 0; operand < NUM_ELEMENTS(operandNames); operand++) {
+            if( (NULL != operandNames[operand]) && (length == (int)strlen(operandNames[operand]))
+             && (0 == strncasecmp(operandNames[operand], text, length)) ) {
+                condition->operand = (ConditionOperand)operand;
+                break;
+            }
+        }
+        if( OPERAND_NONE == condition->operand ) {
+            return FAILURE;
+        }
+    }
+
+    // operator
+    int index;
+    for(index = 0; index < NUM_ELEMENTS(operators); index++) {
+        const int opLength = strlen(operators[index].name);
+        if( 0 == strncmp(operators[index].name, opText, opLength) ) {
+            condition->op = operators[index].op;
+            opText += opLength;
+            break;
+        }
+    }
+    if( NUM_ELEMENTS(operators) == index ) {
+        return FAILURE;
+    }
+
+    // value
+    const char *end;
+    if( (SUCCESS != parseHex16(opText, &end, &condition->value)) || ('\0' != *end) ) {
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+Status breakpointAdd(const uint8_t kinds, const char * const spec)
+{
+    if( BREAKPOINT_MAX <= numBreakpoints ) {
+        printf("Too many breakpoints, only %d can be set\n", BREAKPOINT_MAX);
+        return FAILURE;
+    }
+    Breakpoint * const breakpoint = &breakpoints[numBreakpoints];
+    memset(breakpoint, 0, sizeof(*breakpoint));
+    breakpoint->kinds = kinds;
+    snprintf(breakpoint->spec, sizeof(breakpoint->spec), "%s", spec);
+
+    const char *text = spec;
+    if( (BREAK_EXEC != kinds) && (0 == strncasecmp("io", text, 2)) ) {
+        breakpoint->start = 0xFF00;
+        breakpoint->end = 0xFF7F;
+        text += 2;
+    } else {
+        if( SUCCESS != parseHex16(text, &text, &breakpoint->start) ) {
+            printf("Bad breakpoint address in '%s'\n", spec);
+            return FAILURE;
+        }
+        breakpoint->end = breakpoint->start;
+        if( ('-' == *text)
+         && ((SUCCESS != parseHex16(text+1, &text, &breakpoint->end)) || (breakpoint->end < breakpoint->start)) ) {
+            printf("Bad breakpoint address range in '%s'\n", spec);
+            return FAILURE;
+        }
+    }
+    if( ',' == *text ) {
+        if( SUCCESS != parseCondition(text+1, &breakpoint->condition) ) {
+            printf("Bad breakpoint condition in '%s'\n", spec);
+            return FAILURE;
+        }
+    } else if( '\0' != *text ) {
+        printf("Unexpected '%s' in breakpoint '%s'\n", text, spec);
+        return FAILURE;
+    }
+
+    for(int addr = breakpoint->start; addr <= breakpoint->end; addr++) {
+        breakBits[addr] |= kinds;
+        breakPages[addr >> 8] |= kinds;
+    }
+    numBreakpoints++;
+    return SUCCESS;
+}
+
+void breakpointClearAll(void)
+{
+    memset(breakBits, 0, sizeof(breakBits));
+    memset(breakPages, 0, sizeof(breakPages));
+    memset(breakpoints, 0, sizeof(breakpoints));
+    numBreakpoints = 0;
+    breakPending = false;
+}
+
+static uint16_t operandValue(const BreakCondition * const condition, const uint8_t val8)
+{
+    if( OPERAND_VAL == condition->operand ) {
+        return val8;
+    } else if( OPERAND_MEM == condition->operand ) {
+        return getMem8(condition->addr);
+    }
+    CpuState cpu;
+    getCpuState(&cpu);
+    switch( condition->operand ) {
+        case OPERAND_A:     return cpu.A;
+        case OPERAND_F:     return cpu.F;
+        case OPERAND_B:     return cpu.B;
+        case OPERAND_C:     return cpu.C;
+        case OPERAND_D:     return cpu.D;
+        case OPERAND_E:     return cpu.E;
+        case OPERAND_H:     return cpu.H;
+        case OPERAND_L:     return cpu.L;
+        case OPERAND_AF:    return (cpu.A << 8) | cpu.F;
+        case OPERAND_BC:    return (cpu.B << 8) | cpu.C;
+        case OPERAND_DE:    return (cpu.D << 8) | cpu.E;
+        case OPERAND_HL:    return (cpu.H << 8) | cpu.L;
+        case OPERAND_SP:    return cpu.SP;
+        case OPERAND_PC:    return cpu.PC - 1;  // the next opcode has already been fetched
+        default:            return 0;
+    }
+}
+
+static bool conditionTrue(const BreakCondition * const condition, const uint8_t val8)
+{
+    if( OPERAND_NONE == condition->operand ) {
+        return true;
+    }
+    const uint16_t value = operandValue(condition, val8);
+    switch( condition->op ) {
+        case COND_EQ:   return (value == condition->value);
+        case COND_NE:   return (value != condition->value);
+        case COND_LT:   return (value <  condition->value);
+        case COND_GT:   return (value >  condition->value);
+        case COND_LE:   return (value <= condition->value);
+        case COND_GE:   return (value >= condition->value);
+        default:        return false;
+    }
+}
+
+// Returns true if any breakpoint of the kind on addr fires
+static bool breakpointCheck(const uint16_t addr, const uint8_t val8, const uint8_t kind)
+{
+    bool hit = false;
+    for(int index = 0; index < numBreakpoints; index++) {
+        Breakpoint * const breakpoint = &breakpoints[index];
+        if( (0 == (breakpoint->kinds & kind)) || (addr < breakpoint->start) || (addr > breakpoint->end)
+         || !conditionTrue(&breakpoint->condition, val8) ) {
+            continue;
+        }
+        hit = true;
+        if( rewindReplaying ) {
+            // already reported the first time through
+            continue;
+        }
+        breakpoint->hits++;
+        if( BREAK_EXEC == kind ) {
+            printf("Breakpoint %d '%s' hit at %04X\n", index, breakpoint->spec, addr);
+        } else {
+            printf("Watchpoint %d '%s' hit, %s %02X at %04X\n", index, breakpoint->spec,
+                (BREAK_READ == kind)? "read" : "wrote", val8, addr);
+        }
+    }
+    return hit;
+}
+
+bool breakpointCheckExec(const uint16_t pc)
+{
+    if( 0 == (breakBits[pc] & BREAK_EXEC) ) {
+        return false;
+    }
+    return breakpointCheck(pc, 0, BREAK_EXEC);
+}
+
+void breakpointCheckAccess(const uint16_t addr, const uint8_t val8, const uint8_t kind)
+{
+    if( (0 != (breakBits[addr] & kind)) && breakpointCheck(addr, val8, kind) ) {
+        breakPending = true;
+    }
+}
+
+bool breakpointTakePending(void)
+{
+    const bool pending = breakPending;
+    breakPending = false;
+    return pending;
+}
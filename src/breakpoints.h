@@ -0,0 +1,49 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __BREAKPOINTS_H__
+#define __BREAKPOINTS_H__
+
+#include "gb_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BREAKPOINT_MAX      (32)
+
+// What a breakpoint stops on, also the flags in breakPages
+#define BREAK_EXEC          (0x01)
+#define BREAK_READ          (0x02)
+#define BREAK_WRITE         (0x04)
+
+// The only thing the hot paths look at: which kinds of breakpoint are set anywhere in each
+//  256 byte page.  With none set every check is a single load that's never taken.
+extern uint8_t breakPages[256];
+// A watchpoint was hit during the current instruction
+extern bool breakPending;
+
+#define BREAK_EXEC_HIT(pc)  (((0 != (breakPages[(uint16_t)(pc) >> 8] & BREAK_EXEC)) && breakpointCheckExec(pc)) || (breakPending && breakpointTakePending()))
+#define BREAK_ACCESS(addr, val8, kind) \
+    do { if( 0 != (breakPages[(uint16_t)(addr) >> 8] & (kind)) ) { breakpointCheckAccess((addr), (val8), (kind)); } } while(0)
+
+// SPEC is ADDR[-END][,CONDITION], all in hex.  For watchpoints ADDR may also be "io" for
+//  FF00-FF7F.  CONDITION is OPERAND OP VALUE, with OP one of == != < > <= >= and OPERAND a
+//  register (A F B C D E H L AF BC DE HL SP PC), a byte of memory [ADDR], or VAL, the byte
+//  being read or written.  e.g. "0150,A==3F" or "C000-C0FF,VAL!=0"
+Status breakpointAdd(const uint8_t kinds, const char * const spec);
+void breakpointClearAll(void);
+
+// The slow paths behind the macros above
+bool breakpointCheckExec(const uint16_t pc);
+void breakpointCheckAccess(const uint16_t addr, const uint8_t val8, const uint8_t kind);
+bool breakpointTakePending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__BREAKPOINTS_H__
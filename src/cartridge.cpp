@@ -5,6 +5,8 @@
 // Copyright (c) 2025 Haley Taylor (@truehaley)
 
 #include "gb.h"
+#include "romcache.h"
+#include "rewind.h"
 
 const OldLicenseeDecoder oldLicensees[] = {
     {0x00,    "None"},
@@ -223,16 +225,42 @@ const NewLicenseeDecoder newLicensees[] = {
     { .code.ascii = {'D', 'K'},    .name = "Kodansha " },
 };
 
+// Reads from an empty cartridge slot float high
+static uint8_t openBusRom[0x4000];
+
+// The 16K ROM banks currently visible at 0x0000-0x3FFF and 0x4000-0x7FFF.
+// The bus reads ROM straight out of these, so the mapper only has to be consulted
+//  when a write changes the banking (or for cartridge RAM).
+const uint8_t *cartRomBank[2] = { openBusRom, openBusRom };
+uint16_t cartRomBankNumber[2] = { 0, 0 };
+
+static void mapOpenBus(void)
+{
+    memset(openBusRom, 0xFF, sizeof(openBusRom));
+    cartRomBank[0] = openBusRom;
+    cartRomBank[1] = openBusRom;
+    cartRomBankNumber[0] = 0;
+    cartRomBankNumber[1] = 0;
+}
+
 class CartridgeMapper {
     protected:
         const Cartridge *cart;
         const uint32_t romAddrMask;
         const uint32_t ramAddrMask;
+
+        void mapRomBanks(uint32_t lowerAddr, uint32_t upperAddr) {
+            cartRomBank[0] = &cart->rom.contents[lowerAddr];
+            cartRomBank[1] = &cart->rom.contents[upperAddr];
+            cartRomBankNumber[0] = lowerAddr >> 14;
+            cartRomBankNumber[1] = upperAddr >> 14;
+        }
     public:
         CartridgeMapper(Cartridge *cart)
         : cart(cart),
           romAddrMask{((uint32_t)(cart->romSize))-1},
           ramAddrMask{((uint32_t)(cart->ramSize))-1} {};
+        virtual ~CartridgeMapper() {};
         virtual uint8_t getRom8(uint16_t addr) = 0;
         virtual void setRom8(uint16_t addr, uint8_t val8) = 0;
         virtual uint8_t getRam8(uint16_t addr) = 0;
@@ -241,7 +269,9 @@ class CartridgeMapper {
 
 class NoCart : public CartridgeMapper {
     public:
-        NoCart(Cartridge *cart) : CartridgeMapper(cart) {};
+        NoCart(Cartridge *cart) : CartridgeMapper(cart) {
+            mapOpenBus();
+        };
         uint8_t getRom8(uint16_t addr) { return 0xFF; }
         void setRom8(uint16_t addr, uint8_t val8) { return; }
         uint8_t getRam8(uint16_t addr) { return 0xFF; }
@@ -250,7 +280,9 @@ class NoCart : public CartridgeMapper {
 
 class NoMapper : public CartridgeMapper {
     public:
-        NoMapper(Cartridge *cart) : CartridgeMapper(cart) {};
+        NoMapper(Cartridge *cart) : CartridgeMapper(cart) {
+            mapRomBanks(0x0000, 0x4000);
+        };
         uint8_t getRom8(uint16_t addr) {
             return cart->rom.contents[(addr & 0x7FFF)];
         }
@@ -296,6 +328,15 @@ class Mbc1Mapper : public CartridgeMapper {
     public:
         Mbc1Mapper(Cartridge *cart) : CartridgeMapper(cart) {
             configMappedAddrs();
+            mapRomBanks(lowerRomMappedAddr, upperRomMappedAddr);
+
+            ADD_REWIND_STATE(ramEnabled);
+            ADD_REWIND_STATE(romBankReg);
+            ADD_REWIND_STATE(lowerRomMappedAddr);
+            ADD_REWIND_STATE(upperRomMappedAddr);
+            ADD_REWIND_STATE(ramBankReg);
+            ADD_REWIND_STATE(ramMappedAddr);
+            ADD_REWIND_STATE(advancedBanking);
         }
 
         uint8_t getRom8(uint16_t addr) {
@@ -330,6 +371,7 @@ class Mbc1Mapper : public CartridgeMapper {
 
             }
             configMappedAddrs();
+            mapRomBanks(lowerRomMappedAddr, upperRomMappedAddr);
         }
 
         uint8_t getRam8(uint16_t addr) {
@@ -381,6 +423,56 @@ bool isMbc1MultiCart(Cartridge *cart)
 }
 
 
+// Header checksum over 0x134-0x14C, image must hold at least the full header
+uint8_t cartHeaderChecksum(const uint8_t * const image)
+{
+    uint8_t checksum = 0;
+    for (uint16_t address = CART_HEADER_CHECK_START; address <= CART_HEADER_CHECK_END; address++) {
+        checksum = checksum - image[address] - 1;
+    }
+    return checksum;
+}
+
+// Global checksum is the 16 bit sum of every byte in the image except the checksum itself
+uint16_t cartGlobalChecksum(const uint8_t * const image, const int size)
+{
+    uint16_t checksum = 0;
+    for(int offset = 0; offset < size; offset++) {
+        if( (offset != CART_GLOBAL_CHECKSUM_OFFSET) && (offset != CART_GLOBAL_CHECKSUM_OFFSET+1) ) {
+            checksum += image[offset];
+        }
+    }
+    return checksum;
+}
+
+const char *cartLicenseeName(const CartridgeHeader * const header)
+{
+    if( CART_LICENSEE_NEW == header->oldLicensee ) {
+        for(int index=0; index < NUM_ELEMENTS(newLicensees); index++) {
+            if( newLicensees[index].code.val == header->newLicensee ) {
+                return newLicensees[index].name;
+            }
+        }
+    } else {
+        for(int index=0; index < NUM_ELEMENTS(oldLicensees); index++) {
+            if( oldLicensees[index].code == header->oldLicensee ) {
+                return oldLicensees[index].name;
+            }
+        }
+    }
+    return NULL;
+}
+
+// returns 0 for unknown sizes
+uint32_t cartRomBytes(const CartridgeHeader * const header)
+{
+    if( CART_ROM_8M >= header->romSize ) {
+        return (1<<header->romSize)*32768;
+    }
+    return 0;
+}
+
+
 Cartridge cartridge = {0};
 CartridgeMapper *mapper = nullptr;
 bool cartridgeInserted = false;
@@ -388,7 +480,6 @@ bool cartridgeInserted = false;
 Status loadCartridge(const char * const filename)
 {
     RomImage *rom;
-    uint8_t checksum = 0;
     Cartridge *cart = &cartridge;
 
     memset(cart, 0, sizeof(Cartridge));
@@ -408,15 +499,24 @@ Status loadCartridge(const char * const filename)
     cart->header = (CartridgeHeader *) &(rom->contents[CART_HEADER_OFFSET]);
 
     printf("    checksum...");
-    for (uint16_t address = CART_HEADER_CHECK_START; address <= CART_HEADER_CHECK_END; address++) {
-        checksum = checksum - rom->contents[address] - 1;
-    }
-    if( checksum != cart->header->headerChecksum ) {
+    if( cartHeaderChecksum(rom->contents) != cart->header->headerChecksum ) {
         printf("FAIL\n");
         goto failure;
     }
     printf("PASS\n");
 
+    if( verifyRomChecksum ) {
+        // hardware never checks this, so a mismatch is only reported
+        uint16_t expected = (cart->header->globalChecksum >> 8) | ((cart->header->globalChecksum & 0xFF) << 8);
+        uint16_t computed = cartGlobalChecksum(rom->contents, rom->size);
+        printf("    global checksum...");
+        if( expected == computed ) {
+            printf("PASS\n");
+        } else {
+            printf("MISMATCH (%04X, expected %04X)\n", computed, expected);
+        }
+    }
+
     printf("    title...\"");
     if(CART_CGB_SUPPORTS_COLOR_MASK == (cart->header->title.v2.cgbMode & CART_CGB_SUPPORTS_COLOR_MASK)) {
         cart->cgbMode = cart->header->title.v2.cgbMode;
@@ -432,21 +532,7 @@ Status loadCartridge(const char * const filename)
     }
 
     printf("    licensee...");
-    if( CART_LICENSEE_NEW == cart->header->oldLicensee ) {
-        for(int index=0; index < NUM_ELEMENTS(newLicensees); index++) {
-            if( newLicensees[index].code.val == cart->header->newLicensee ) {
-                cart->licensee = newLicensees[index].name;
-                break;
-            }
-        }
-    } else {
-        for(int index=0; index < NUM_ELEMENTS(oldLicensees); index++) {
-            if( oldLicensees[index].code == cart->header->oldLicensee ) {
-                cart->licensee = oldLicensees[index].name;
-                break;
-            }
-        }
-    }
+    cart->licensee = cartLicenseeName(cart->header);
     if( NULL == cart->licensee ) {
         printf("NOT FOUND\n");
     } else {
@@ -454,12 +540,11 @@ Status loadCartridge(const char * const filename)
     }
 
     printf("    rom size...");
+    cart->romSize = cartRomBytes(cart->header);
     if( CART_ROM_512K >= cart->header->romSize ) {
         printf("%dK (%d banks)\n", (1<<cart->header->romSize)*32, (2<<cart->header->romSize));
-        cart->romSize = (1<<cart->header->romSize)*32768;
     } else if( CART_ROM_8M >= cart->header->romSize) {
         printf("%dM (%d banks)\n", (1<<cart->header->romSize), (2<<cart->header->romSize));
-        cart->romSize = (1<<cart->header->romSize)*32768;
     } else {
         printf("UNKNOWN\n");
     }
@@ -491,6 +576,7 @@ Status loadCartridge(const char * const filename)
     if( 0 < cart->ramSize ) {
         allocateRam(&cart->ram, cart->ramSize);
         addRamView(&cart->ram, "CRAM", 0xA000);
+        addRewindState(cart->ram.contents, cart->ram.size);
     }
 
     printf("    mapper...");
@@ -515,8 +601,14 @@ Status loadCartridge(const char * const filename)
             break;
     }
 
-    //preprocessRom(rom, CARTRIDGE_ENTRY);
+    if( romCacheAttach(rom, filename) ) {
+        markRomAnalyzed(rom);
+    } else {
+        analyzeRomAsync(rom);
+    }
     addRomView(&cartridge.rom, "CART", 0x0000);
+    ADD_REWIND_STATE(cartRomBank);
+    ADD_REWIND_STATE(cartRomBankNumber);
     cartridgeInserted = true;
 
     printf("...Success\n");
@@ -529,6 +621,7 @@ failure:
 void unloadCartridge()
 {
     if(cartridgeInserted) {
+        romCacheDetach(&cartridge.rom);
         unloadRom(&cartridge.rom);
         if( 0 < cartridge.ramSize ) {
             deallocateRam(&cartridge.ram);
@@ -536,8 +629,46 @@ void unloadCartridge()
         memset(&cartridge, 0, sizeof(Cartridge));
         cartridgeInserted = false;
     }
+    delete mapper;
+    mapper = nullptr;
+    mapOpenBus();
+}
+
+// The cartridge rom image, NULL if there isn't one
+RomImage *cartRomImage(void)
+{
+    return (cartridgeInserted)? &cartridge.rom : NULL;
+}
+
+// Offset into the cartridge rom of whatever is currently mapped at a cpu address,
+//  -1 if that address isn't cartridge rom right now
+int cartRomOffset(const uint16_t addr)
+{
+    if( (addr > 0x7FFF) || !cartridgeInserted || (bootRomActive && (addr < 0x100)) ) {
+        return -1;
+    }
+    const uint8_t * const bank = cartRomBank[addr >> 14];
+    if( openBusRom == bank ) {
+        return -1;
+    }
+    return (bank - cartridge.rom.contents) + (addr & 0x3FFF);
+}
+
+// Called for every executed instruction so code that is only reachable at runtime gets classified too
+void markCartCode(const uint16_t addr)
+{
+    const int offset = cartRomOffset(addr);
+    if( 0 > offset ) {
+        return;
+    }
+    RomImage * const rom = &cartridge.rom;
+    if( !ROM_IS_CODE(rom, offset) && romAnalysisDone(rom) ) {
+        analyzeRomFrom(rom, offset);
+    }
 }
 
+// Goes through the mapper itself, the bus reads ROM via cartRomBank instead.  Kept so
+//  gamegirl-bench --micro can compare the two (rom-mapper against rom-banked).
 uint8_t getCartRom8(uint16_t addr)
 {
     return mapper->getRom8(addr);
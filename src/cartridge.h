@@ -16,6 +16,8 @@ extern "C" {
 #define CART_HEADER_OFFSET      (0x0100)
 #define CART_HEADER_CHECK_START (0x0134)
 #define CART_HEADER_CHECK_END   (0x014c)
+#define CART_GLOBAL_CHECKSUM_OFFSET (0x014e)
+#define CART_HEADER_END         (0x0150)
 
 typedef struct __attribute__((packed)) {
     // 0x0100
@@ -174,8 +176,19 @@ typedef struct {
 } Cartridge;
 
 
+extern const uint8_t *cartRomBank[2];
+extern uint16_t cartRomBankNumber[2];   // which banks those are
+
+uint8_t cartHeaderChecksum(const uint8_t * const image);
+uint16_t cartGlobalChecksum(const uint8_t * const image, const int size);
+const char *cartLicenseeName(const CartridgeHeader * const header);
+uint32_t cartRomBytes(const CartridgeHeader * const header);
+
 Status loadCartridge(const char * const filename);
 void unloadCartridge();
+void markCartCode(const uint16_t addr);
+RomImage *cartRomImage(void);
+int cartRomOffset(const uint16_t addr);
 
 uint8_t getCartRom8(uint16_t addr);
 void setCartRom8(uint16_t addr, uint8_t val8);
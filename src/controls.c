@@ -6,6 +6,7 @@
 
 #include "gb.h"
 #include "gui.h"
+#include "rewind.h"
 
 typedef struct __attribute__((packed)) {
     union {
@@ -29,12 +30,13 @@ typedef struct __attribute__((packed)) {
     };
 } JOYPReg;
 
-struct {
+static struct {
     JOYPReg JOYP;
 } regs;
 
 ControlState rawControls;
 ControlState activeControls;
+static ControlState guiControls;    // activeControls as of the last guiSnapshotControls
 
 uint8_t getControlsReg8(uint16_t addr)
 {
@@ -70,6 +72,9 @@ void updateControls(ControlState newControls)
     ControlState changed;
     // which controls have changed since last time?
     changed.val = newControls.val ^ rawControls.val;
+    if( 0 != changed.val ) {
+        rewindRecordControls(newControls);
+    }
     // If the action buttons are selcted, one of them changed, and it was pressed, trigger interrupt
     if( (0 == regs.JOYP.poll_action) && (0 != changed.action) && (0 != (changed.action & newControls.action)) ) {
         setIntFlag(INT_JOYPAD);
@@ -89,6 +94,12 @@ void updateControls(ControlState newControls)
     activeControls = newControls;
 }
 
+// With the emulation lock held
+void guiSnapshotControls(void)
+{
+    guiControls = activeControls;
+}
+
 Vector2 guiDrawControls(const Vector2 viewAnchor)
 {
     // Top left corner of the controls interface
@@ -96,43 +107,43 @@ Vector2 guiDrawControls(const Vector2 viewAnchor)
 
     // D-pad horiz
     DrawRectangle(viewAnchor.x+30, viewAnchor.y+10 + 30, 90, 30, DARKGRAY);
-    if( 1 == activeControls.dpadLeft ) {
+    if( 1 == guiControls.dpadLeft ) {
         DrawRectangle(viewAnchor.x+30 +2, viewAnchor.y+10 + 32, 30-4, 30-4, LIGHTGRAY);
     }
-    if( 1 == activeControls.dpadRight ) {
+    if( 1 == guiControls.dpadRight ) {
         DrawRectangle(viewAnchor.x+30 +62, viewAnchor.y+10 + 32, 30-4, 30-4, LIGHTGRAY);
     }
 
     // D-pad vert
     DrawRectangle(viewAnchor.x+30 + 30, viewAnchor.y+10, 30, 90, DARKGRAY);
-    if( 1 == activeControls.dpadUp ) {
+    if( 1 == guiControls.dpadUp ) {
         DrawRectangle(viewAnchor.x+30 + 32, viewAnchor.y+10 +2, 30-4, 30-4, LIGHTGRAY);
     }
-    if( 1 == activeControls.dpadDown ) {
+    if( 1 == guiControls.dpadDown ) {
         DrawRectangle(viewAnchor.x+30 + 32, viewAnchor.y+10 +62, 30-4, 30-4, LIGHTGRAY);
     }
 
     // B
     DrawCircle(viewAnchor.x + 370, viewAnchor.y + 70, 22, MAROON);
-    if( 1 == activeControls.buttonB ) {
+    if( 1 == guiControls.buttonB ) {
         DrawCircle(viewAnchor.x + 370, viewAnchor.y + 70, 22-3, RED);
     }
 
     // A
     DrawCircle(viewAnchor.x + 430, viewAnchor.y + 45, 22, MAROON);
-    if( 1 == activeControls.buttonA ) {
+    if( 1 == guiControls.buttonA ) {
         DrawCircle(viewAnchor.x + 430, viewAnchor.y + 45, 22-3, RED);
     }
 
     // Select
     DrawRectangle(viewAnchor.x + 170, viewAnchor.y + 100, 50, 15, GRAY);
-    if( 1 == activeControls.select ) {
+    if( 1 == guiControls.select ) {
         DrawRectangle(viewAnchor.x + 170 +2, viewAnchor.y + 100 +2, 50-4, 15-4, LIGHTGRAY);
     }
 
     // Start
     DrawRectangle(viewAnchor.x + 250, viewAnchor.y + 100, 50, 15, GRAY);
-    if( 1 == activeControls.start ) {
+    if( 1 == guiControls.start ) {
         DrawRectangle(viewAnchor.x + 250 +2, viewAnchor.y + 100 +2, 50-4, 15-4, LIGHTGRAY);
     }
 
@@ -142,4 +153,8 @@ Vector2 guiDrawControls(const Vector2 viewAnchor)
 void controlsInit(void)
 {
     regs.JOYP.val = 0xCF;   // reset val
+
+    ADD_REWIND_STATE(regs);
+    ADD_REWIND_STATE(rawControls);
+    ADD_REWIND_STATE(activeControls);
 }
@@ -6,6 +6,13 @@
 
 #include "gb.h"
 #include "gui.h"
+#include "profile.h"
+#include "instrument.h"
+#include "trace.h"
+#include "doctorlog.h"
+#include "breakpoints.h"
+#include "rewind.h"
+#include "history.h"
 
 static struct __attribute__((packed)) {
     union {
@@ -71,26 +78,57 @@ InterruptRegister ifReg = {0};
 bool interruptsEnabled = false;
 bool interruptsPendingEnable = false;
 bool cpuHalted = false;
+bool cpuHung = false;   // the last instruction was invalid, breakpoints weren't checked
 
 typedef struct {
     uint16_t addr;
     uint8_t code[3];
 } InstructionDetail;
-InstructionDetail instructionHistory[8];
-int historyHead = 0;
+uint64_t instructionCount = 0;
+
+// Disassembled lines for the debugger, kept until the memory they came from is written or
+//  banked out.  Direct mapped on the address, which is plenty for the handful shown at once.
+#define DISASM_CACHE_SIZE   (256)
+#define DISASM_BOOTROM      (-2)    // romOffset while the boot ROM is mapped in
+#define DISASM_RECORDED     (-3)    // romOffset of a history entry, where the bytes came from is unknown
+#define DISASM_LINE_HEIGHT  (FONTSIZE+2)    // raylib's default line spacing
+
+typedef struct {
+    bool valid;
+    InstructionDetail id;
+    int romOffset;          // cartRomOffset(), DISASM_BOOTROM/RECORDED, or -1 if writable
+    uint32_t generation;    // memPageGeneration of the instruction's pages, when writable
+    char text[64];
+} DisasmLine;
+static DisasmLine disasmCache[DISASM_CACHE_SIZE];
 
 static Instruction nextInstruction = {.val = 0};
 
 void resetCpu(void)
 {
     memset(&regs, 0, sizeof(regs));
-    memset(instructionHistory, 0, sizeof(instructionHistory));
+    memset(disasmCache, 0, sizeof(disasmCache));
+    historyReset();
     ieReg.val = 0;
     ifReg.val = 0;
     interruptsEnabled = false;
     interruptsPendingEnable = false;
     cpuHalted = false;
+    cpuHung = false;
+    instructionCount = 0;
     nextInstruction.val = getMem8(regs.PC++);
+
+    ADD_REWIND_STATE(regs);
+    ADD_REWIND_STATE(ieReg);
+    ADD_REWIND_STATE(ifReg);
+    ADD_REWIND_STATE(interruptsEnabled);
+    ADD_REWIND_STATE(interruptsPendingEnable);
+    ADD_REWIND_STATE(cpuHalted);
+    ADD_REWIND_STATE(nextInstruction);
+    ADD_REWIND_STATE(instructionCount);
+    ADD_REWIND_STATE(historyCount);
+    ADD_REWIND_STATE(historyRecent);
+    ADD_REWIND_STATE(historyRecentCount);
 }
 
 void setIntReg8(uint16_t addr, uint8_t val8)
@@ -115,6 +153,11 @@ uint8_t getIntReg8(uint16_t addr)
 
 void setIntFlag(InterruptFlag interrupt)
 {
+    static const char * const interruptNames[] = { "VBLANK", "STAT", "TIMER", "SERIAL", "JOYPAD" };
+    TRACE_INSTANT(TRACE_TRACK_INTERRUPTS, interruptNames[interrupt]);
+    if( cpuHalted ) {
+        TRACE_END(TRACE_TRACK_HALT);
+    }
     ifReg.flags |= (0x01 << interrupt);
     cpuHalted = false;
 }
@@ -160,67 +203,153 @@ int guiDisassembleDetail(char * const buffer, InstructionDetail *id)
     }
     buff = buff + sprintf(buff, "|  ");
     buff = buff + disassemble2(buff, id->code, id->addr);
-    buff = buff + sprintf(buff, "\n");
     return buff - buffer;
 }
 
+static int disasmRomOffset(const uint16_t addr)
+{
+    if( bootRomActive && (0x0100 > addr) ) {
+        return DISASM_BOOTROM;
+    }
+    return cartRomOffset(addr);
+}
+
+// Changes whenever the memory an instruction at addr could come from is written
+static uint32_t disasmGeneration(const uint16_t addr)
+{
+    const uint8_t firstPage = addr >> 8;
+    const uint8_t lastPage = (uint16_t)(addr + 2) >> 8;
+    uint32_t generation = memPageGeneration[firstPage];
+    if( lastPage != firstPage ) {
+        generation += memPageGeneration[lastPage];
+    }
+    if( (0xA000 <= addr) && (0xBFFF >= addr) ) {
+        generation += memMapGeneration;     // cartridge RAM banks
+    }
+    return generation;
+}
+
+static void disasmFill(DisasmLine * const line, const InstructionDetail * const id, const int romOffset, const uint32_t generation)
+{
+    line->valid = true;
+    line->id = *id;
+    line->romOffset = romOffset;
+    line->generation = generation;
+    guiDisassembleDetail(line->text, &line->id);
+}
+
+// An instruction from the history, whose bytes are already known
+static const char *guiDisasmRecorded(const InstructionDetail * const id)
+{
+    DisasmLine * const line = &disasmCache[id->addr % DISASM_CACHE_SIZE];
+    if( !line->valid || (line->id.addr != id->addr)
+     || (0 != memcmp(line->id.code, id->code, instructionSize(id->code[0]))) ) {
+        disasmFill(line, id, DISASM_RECORDED, 0);
+    }
+    return line->text;
+}
+
+// The instruction at addr as memory is now, only read again if it may have changed.  ROM is
+//  keyed by its offset in the image, so switching banks back and forth keeps its lines.
+static const DisasmLine *guiDisasmAt(const uint16_t addr)
+{
+    DisasmLine * const line = &disasmCache[addr % DISASM_CACHE_SIZE];
+    const int romOffset = disasmRomOffset(addr);
+    const uint32_t generation = (-1 == romOffset)? disasmGeneration(addr) : 0;
+    if( !line->valid || (line->id.addr != addr) || (line->romOffset != romOffset) || (line->generation != generation) ) {
+        InstructionDetail id;
+        id.addr = addr;
+        id.code[0] = getMem8(addr);
+        id.code[1] = getMem8(addr+1);
+        id.code[2] = getMem8(addr+2);
+        disasmFill(line, &id, romOffset, generation);
+    }
+    return line;
+}
+
+#define GUI_CPU_HISTORY_LINES   (7)
+#define GUI_CPU_UPCOMING_LINES  (4)
+
+// What the cpu panel shows, copied by guiSnapshotCpuState with the emulation lock held
+static struct {
+    decltype(::regs) regs;
+    char history[GUI_CPU_HISTORY_LINES][64];    // the newest last, empty where there's none
+    char upcoming[GUI_CPU_UPCOMING_LINES][64];
+} guiCpu;
+
+void guiSnapshotCpuState(void)
+{
+    guiCpu.regs = regs;
+
+    // Instruction history, the newest last
+    for( int age = GUI_CPU_HISTORY_LINES-1; age >= 0; age-- ) {
+        char * const text = guiCpu.history[GUI_CPU_HISTORY_LINES-1 - age];
+        const HistoryRecord * const record = historyRecentAt(age);
+        if( NULL != record ) {
+            InstructionDetail id = { record->pc, { record->code[0], record->code[1], record->code[2] } };
+            strcpy(text, guiDisasmRecorded(&id));
+        } else {
+            text[0] = '\0';
+        }
+    }
+
+    // Upcoming instructions, the lines are copied since they can share a cache entry
+    uint16_t nextPC = regs.PC-1;
+    for( int lines = 0; lines < GUI_CPU_UPCOMING_LINES; lines++ ) {
+        const DisasmLine * const line = guiDisasmAt(nextPC);
+        strcpy(guiCpu.upcoming[lines], line->text);
+        nextPC += instructionSize(line->id.code[0]);
+    }
+}
+
 Vector2 guiDrawCpuState(const Vector2 viewAnchor)
 {
     // Top left corner of the cpu display
 
     Vector2 regAnchor1 = { viewAnchor.x, viewAnchor.y };
     Vector2 regAnchor2 = { regAnchor1.x + FONTWIDTH*4, regAnchor1.y };
-    guiDrawCpuReg8(regAnchor1, regs.A, "A");
-    guiDrawCpuReg8(regAnchor2, regs.F, "F");
+    guiDrawCpuReg8(regAnchor1, guiCpu.regs.A, "A");
+    guiDrawCpuReg8(regAnchor2, guiCpu.regs.F, "F");
     regAnchor1.y += FONTSIZE*2;
     regAnchor2.y += FONTSIZE*2;
-    guiDrawCpuReg8(regAnchor1, regs.B, "B");
-    guiDrawCpuReg8(regAnchor2, regs.C, "C");
+    guiDrawCpuReg8(regAnchor1, guiCpu.regs.B, "B");
+    guiDrawCpuReg8(regAnchor2, guiCpu.regs.C, "C");
     regAnchor1.y += FONTSIZE*2;
     regAnchor2.y += FONTSIZE*2;
-    guiDrawCpuReg8(regAnchor1, regs.D, "D");
-    guiDrawCpuReg8(regAnchor2, regs.E, "E");
+    guiDrawCpuReg8(regAnchor1, guiCpu.regs.D, "D");
+    guiDrawCpuReg8(regAnchor2, guiCpu.regs.E, "E");
     regAnchor1.y += FONTSIZE*2;
     regAnchor2.y += FONTSIZE*2;
-    guiDrawCpuReg8(regAnchor1, regs.H, "H");
-    guiDrawCpuReg8(regAnchor2, regs.L, "L");
+    guiDrawCpuReg8(regAnchor1, guiCpu.regs.H, "H");
+    guiDrawCpuReg8(regAnchor2, guiCpu.regs.L, "L");
     regAnchor1.y += FONTSIZE*2;
-    guiDrawCpuReg16(regAnchor1, regs.SP, "SP");
+    guiDrawCpuReg16(regAnchor1, guiCpu.regs.SP, "SP");
     regAnchor1.y += FONTSIZE*2;
-    guiDrawCpuReg16(regAnchor1, regs.PC, "PC");
+    guiDrawCpuReg16(regAnchor1, guiCpu.regs.PC, "PC");
     regAnchor1.y += FONTSIZE*2;
-    uint16_t flags = regs.flags.zero << 12 | regs.flags.sub << 8 | regs.flags.halfCarry << 4 | regs.flags.carry << 0;
+    uint16_t flags = guiCpu.regs.flags.zero << 12 | guiCpu.regs.flags.sub << 8 | guiCpu.regs.flags.halfCarry << 4 | guiCpu.regs.flags.carry << 0;
     guiDrawCpuReg16(regAnchor1, flags, "Z N H C");
     regAnchor1.y += FONTSIZE*2;
 
-    static char buffer[2048];
-    char *buff = buffer;
-    int nextPC = regs.PC-1;
-    int lines=0;
-
-    // Instruction history
-    int historyOffset = (historyHead + 8 - 7) & 0x7;
-    do {
-        buff = buff + guiDisassembleDetail(buff, &instructionHistory[historyOffset]);
-        historyOffset = (historyOffset + 1) & 0x7;
-    } while( ++lines < 7 );
-    buff = buff + sprintf(buff, "\n");
+    Vector2 lineAnchor = { viewAnchor.x + 95, viewAnchor.y };
 
-    // Upcoming instructions
-    do {
-        InstructionDetail id;
-        id.addr = nextPC;
-        id.code[0] = getMem8(nextPC);
-        id.code[1] = getMem8(nextPC+1);
-        id.code[2] = getMem8(nextPC+2);
-        buff = buff + guiDisassembleDetail(buff, &id);
-        nextPC += instructionSize(id.code[0]);
-    } while( ++lines < 11 );
+    // Instruction history, the newest last
+    for( int lines = 0; lines < GUI_CPU_HISTORY_LINES; lines++ ) {
+        if( '\0' != guiCpu.history[lines][0] ) {
+            DrawTextEx(firaFont, guiCpu.history[lines], lineAnchor, FONTSIZE, 0, BLACK);
+        }
+        lineAnchor.y += DISASM_LINE_HEIGHT;
+    }
+    lineAnchor.y += DISASM_LINE_HEIGHT;
 
     // Background highlight of the next instruction to be run
     DrawRectangle(viewAnchor.x+90, viewAnchor.y+FONTSIZE*9, 350, FONTSIZE, ColorAlpha(GOLD, 0.3));
-    // Disssassembly view
-    DrawTextEx(firaFont, buffer, (Vector2){viewAnchor.x + 95, viewAnchor.y}, FONTSIZE, 0, BLACK);
+
+    // Upcoming instructions
+    for( int lines = 0; lines < GUI_CPU_UPCOMING_LINES; lines++ ) {
+        DrawTextEx(firaFont, guiCpu.upcoming[lines], lineAnchor, FONTSIZE, 0, BLACK);
+        lineAnchor.y += DISASM_LINE_HEIGHT;
+    }
 
     return {90+350, regAnchor1.y-viewAnchor.y};
 }
@@ -341,13 +470,17 @@ static void writeMem8R16(uint8_t r16, uint16_t val8)
 
 static uint8_t readImm8(void)
 {
-    return readMem8(regs.PC++);
+    const uint8_t val8 = readMem8(regs.PC++);
+    HISTORY_OPERAND(val8);
+    return val8;
 }
 
 static uint16_t readImm16(void)
 {
     uint16_t val16 = readMem16(regs.PC);
     regs.PC += 2;
+    HISTORY_OPERAND(LSB(val16));
+    HISTORY_OPERAND(MSB(val16));
     return val16;
 }
 
@@ -726,6 +859,7 @@ static bool halt(const Instruction instruction)
     if( 0 == (ifReg.flags & ieReg.flags) ) {
         // only halt if nothing is pending
         cpuHalted = true;
+        TRACE_BEGIN(TRACE_TRACK_HALT, "HALT", -1);
     }
     return false;
 }
@@ -1092,7 +1226,7 @@ static bool prefix(const Instruction instruction)
         rlc_r8,         rrc_r8,         rl_r8,          rr_r8,      sla_r8,         sra_r8,     swap_r8,    srl_r8
     };
 
-    const Instruction pfx_inst = {.val = readMem8(regs.PC++)};
+    const Instruction pfx_inst = {.val = readImm8()};
     switch( pfx_inst.block ) {
         case 0:
             return prefixBlock0Decode[pfx_inst.op](pfx_inst);
@@ -1106,9 +1240,21 @@ static bool prefix(const Instruction instruction)
     return false;  // impossible, but silence warning
 }
 
-bool executeInstruction(const uint16_t breakpoint)
+// The ROM bank an instruction at addr is running from, for the history
+static inline uint16_t historyBankAt(const uint16_t addr)
+{
+    if( 0x8000 <= addr ) {
+        return HISTORY_BANK_NONE;
+    } else if( bootRomActive && (0x0100 > addr) ) {
+        return HISTORY_BANK_BOOT;
+    }
+    return cartRomBankNumber[addr >> 14];
+}
+
+bool executeInstruction(void)
 {
     Instruction instruction = nextInstruction;
+    instructionCount++;
 
     static doOp * const block0decode[64] = {
         nop,            ld_r16_i16,     ld_mr16_a,      inc_r16,    inc_r8,         dec_r8,     ld_r8_i8,   rlc_a,
@@ -1140,6 +1286,8 @@ bool executeInstruction(const uint16_t breakpoint)
 
     if( cpuHalted ) {
         cpuCycle();
+        profileHalted();
+        profileSample(regs.PC-1);
         return false;
     }
 
@@ -1180,12 +1328,15 @@ bool executeInstruction(const uint16_t breakpoint)
         interruptsEnabled = interruptsPendingEnable;
     }
 
-    // keep a record of the executed instructions for the disassembly view
-    instructionHistory[historyHead].addr = regs.PC-1;
-    instructionHistory[historyHead].code[0] = getMem8(regs.PC-1);
-    instructionHistory[historyHead].code[1] = getMem8(regs.PC);
-    instructionHistory[historyHead].code[2] = getMem8(regs.PC+1);
-    historyHead = (historyHead+1) & 0x7;
+    // keep a record of the executed instructions for the debugger, the operands are added as they're read
+    HISTORY_BEGIN(regs.PC-1, historyBankAt(regs.PC-1), instruction.val, mainClock);
+    markCartCode(regs.PC-1);
+    profileSample(regs.PC-1);
+#ifdef GAMEGIRL_PROFILE
+    // interrupt dispatch above isn't charged to the instruction
+    const uint64_t profileStart = mainClock;
+    const uint8_t profileCbOpcode = getMem8(regs.PC);
+#endif
 
     bool hung;
     switch( instruction.block ) {
@@ -1209,21 +1360,59 @@ bool executeInstruction(const uint16_t breakpoint)
             break;
     }
 
-    if( NULL != doctorLogFile ) {
+    if( doctorLogEnabled ) {
         extern bool bootRomActive;
         if(!bootRomActive) {
-            // A:00 F:11 B:22 C:33 D:44 E:55 H:66 L:77 SP:8888 PC:9999 PCMEM:AA,BB,CC,DD
-            fprintf(doctorLogFile,
-                "A:%02X F:%02X B:%02X C:%02X D:%02X E:%02X H:%02X L:%02X SP:%04X PC:%04X PCMEM:%02X,%02X,%02X,%02X\n",
-                regs.A, regs.F, regs.B, regs.C, regs.D, regs.E, regs.H, regs.L, regs.SP, regs.PC,
-                getMem8(regs.PC), getMem8(regs.PC+1), getMem8(regs.PC+2), getMem8(regs.PC+3)
-            );
+            const DoctorLogRecord record = {
+                regs.A, regs.F, regs.B, regs.C, regs.D, regs.E, regs.H, regs.L,
+                { (uint8_t)regs.SP, (uint8_t)(regs.SP >> 8) }, { (uint8_t)regs.PC, (uint8_t)(regs.PC >> 8) },
+                { getMem8(regs.PC), getMem8(regs.PC+1), getMem8(regs.PC+2), getMem8(regs.PC+3) }
+            };
+            doctorLogWrite(&record);
         }
     }
 
     nextInstruction.val = readMem8(regs.PC++);
+    profileOpcode(instruction.val, profileCbOpcode, mainClock - profileStart);
+    INSTRUMENT_COUNT(INSTR_COUNT_INSTRUCTIONS, 1);
 
-    return (breakpoint == (regs.PC-1)) || hung;
+    cpuHung = hung;
+    return hung || BREAK_EXEC_HIT(regs.PC-1);
+}
+
+// the first entry is the reference everything else is checked against
+const CpuCore cpuCores[] = {
+    { "reference", executeInstruction },
+};
+const int numCpuCores = NUM_ELEMENTS(cpuCores);
+
+const CpuCore *findCpuCore(const char * const name)
+{
+    for(int index = 0; index < numCpuCores; index++) {
+        if( 0 == strcmp(name, cpuCores[index].name) ) {
+            return &cpuCores[index];
+        }
+    }
+    return NULL;
+}
+
+void getCpuState(CpuState * const state)
+{
+    memset(state, 0, sizeof(*state));   // no stray padding, states are compared with memcmp
+    state->A = regs.A;
+    state->F = regs.F;
+    state->B = regs.B;
+    state->C = regs.C;
+    state->D = regs.D;
+    state->E = regs.E;
+    state->H = regs.H;
+    state->L = regs.L;
+    state->SP = regs.SP;
+    state->PC = regs.PC;
+    state->IE = ieReg.val;
+    state->IF = ifReg.val;
+    state->interruptsEnabled = interruptsEnabled;
+    state->halted = cpuHalted;
 }
 
 // verification test the mooneye test suite uses to indicate a test has passed
@@ -76,6 +76,13 @@ typedef union {
 #define INST_HALT       (0x76)
 
 
+#define INST_BLOCK_EXTRACT(inst)    (((inst) >> 6) & 0x3)
+#define INST_R8_A_EXTRACT(inst)     (((inst) >> 3) & 0x7)
+#define INST_R8_B_EXTRACT(inst)     ((inst) & 0x7)
+#define INST_R16_EXTRACT(inst)      (((inst) >> 4) & 0x3)
+#define INST_COND_EXTRACT(inst)     (((inst) >> 3) & 0x3)
+#define INST_RST_TGT3_EXTRACT(inst) (((inst) >> 3) & 0x7)
+
 #define INST_BLOCK0     (0x00)
 #define INST_BLOCK1     (0x01)
 #define INST_BLOCK2     (0x02)
@@ -106,15 +113,49 @@ void setIntReg8(uint16_t addr, uint8_t val8);
 uint8_t getIntReg8(uint16_t addr);
 void setIntFlag(InterruptFlag interrupt);
 
+void guiSnapshotCpuState(void);
 Vector2 guiDrawCpuState(const Vector2 viewAnchor);
 void resetCpu(void);
 bool cpuStopped(void);
-bool executeInstruction(const uint16_t breakpoint);
+// True when stopped by a breakpoint, or when the instruction hung the cpu (cpuHung)
+bool executeInstruction(void);
+extern bool cpuHung;
+// executeInstruction calls since reset, the timeline rewind.c moves along
+extern uint64_t instructionCount;
+
+// Interchangeable implementations of executeInstruction, gamegirl-bench --lockstep runs two
+//  of them side by side and stops at the first instruction where they disagree
+typedef bool (CpuExecuteFunc)(void);
+typedef struct {
+    const char *name;
+    CpuExecuteFunc *execute;
+} CpuCore;
+
+extern const CpuCore cpuCores[];
+extern const int numCpuCores;
+const CpuCore *findCpuCore(const char * const name);
+
+typedef struct {
+    uint8_t A, F, B, C, D, E, H, L;
+    uint16_t SP;
+    uint16_t PC;
+    uint8_t IE;
+    uint8_t IF;
+    bool interruptsEnabled;
+    bool halted;
+} CpuState;
+
+void getCpuState(CpuState * const state);
 
 int disassemble2(char *buff, const uint8_t code[3], const int16_t addr);
 int instructionSize(const uint8_t instruction);
 
-void preprocessRom(RomImage * const rom, int offset);
+void analyzeRom(RomImage * const rom);
+void analyzeRomFrom(RomImage * const rom, const int offset);
+void analyzeRomAsync(RomImage * const rom);
+void markRomAnalyzed(RomImage * const rom);
+bool romAnalysisDone(const RomImage * const rom);
+bool romAnalysisWait(RomImage * const rom);
 void disassembleRom(RomImage * const rom);
 int disassembleInstruction(RomImage * const rom, const int offset, char **buffer, int *jumpDest);
 
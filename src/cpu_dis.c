@@ -5,33 +5,168 @@
 // Copyright (c) 2025 Haley Taylor (@truehaley)
 
 #include "gb.h"
+#include "romcache.h"
+#include <pthread.h>
 
-void preprocessRom(RomImage * const rom, int offset)
+// Static code/data classification
+//
+// Walks the ROM from its entrypoint (plus the interrupt vectors for cartridges), marking every
+//  reachable instruction in contentFlags.  Branch destinations go on a worklist instead of being
+//  followed recursively, and a linear run stops as soon as it reaches an instruction that was
+//  already decoded, so every byte is decoded at most once.
+//
+// Jumps into 0x4000-0x7FFF from a switchable bank stay in that bank.  From bank 0 the destination
+//  depends on the mapper state at runtime, so those are only followed on unbanked ROMs.
+
+struct RomAnalysis {
+    pthread_t thread;
+    RomImage *rom;
+    bool done;      // set with release semantics once contentFlags are final
+};
+
+// cpu address that a rom offset appears at while its bank is mapped
+static uint16_t romAddrForOffset(const int offset)
+{
+    return (offset < 0x4000)? offset : (0x4000 | (offset & 0x3FFF));
+}
+
+// rom offset referenced by addr from the code at offset, -1 if it can't be known statically
+static int romOffsetForAddr(const RomImage * const rom, const int offset, const uint16_t addr)
+{
+    int dest;
+    if( addr < 0x4000 ) {
+        dest = addr;
+    } else if( addr < 0x8000 ) {
+        if( offset >= 0x4000 ) {
+            dest = (offset & ~0x3FFF) | (addr & 0x3FFF);  // same bank
+        } else if( rom->size <= 0x8000 ) {
+            dest = addr;  // no banking
+        } else {
+            return -1;
+        }
+    } else {
+        return -1;  // not in rom
+    }
+    return (dest < rom->size)? dest : -1;
+}
+
+static void analyzeFrom(RomImage * const rom, const int * const entries, const int numEntries)
 {
     char buffer[32];
     char *buff;
-    int bytesPerInst;
-    int destination=0;
+    int destination;
+
+    int worklistSize = 0;
+    int worklistCapacity = MAX(256, numEntries);
+    int *worklist = (int *)MemAlloc(worklistCapacity * sizeof(int));
 
-    //printf("preprocess: %04x\n", offset);
-    if( ROM_IS_CODE(rom, offset) || ROM_IS_INVALID(rom, offset) ) {
-        return;  // we've already processed this destination
+    for(int index = 0; index < numEntries; index++) {
+        worklist[worklistSize++] = entries[index];
     }
 
-    while( offset < rom-> size ) {
-        buff = buffer;
-        bytesPerInst = disassembleInstruction(rom, offset, &buff, &destination);
-        if( destination ) {
-            // recurse to follow all jump destinations
-            preprocessRom(rom, destination);
-        }
-        if( ROM_IS_ENDCODE(rom, offset) ) {
-            break;
+    while( 0 < worklistSize ) {
+        int offset = worklist[--worklistSize];
+
+        while( offset < rom->size ) {
+            if( ROM_IS_CODE(rom, offset) || ROM_IS_INVALID(rom, offset) ) {
+                break;  // already walked from here
+            }
+            const int bytesPerInst = instructionSize(rom->contents[offset]);
+            if( (offset + bytesPerInst) > rom->size ) {
+                break;
+            }
+
+            buff = buffer;
+            destination = -1;
+            disassembleInstruction(rom, offset, &buff, &destination);
+            if( ROM_IS_INVALID(rom, offset) ) {
+                break;
+            }
+            if( (0 <= destination) && !ROM_IS_CODE(rom, destination) ) {
+                if( worklistSize == worklistCapacity ) {
+                    worklistCapacity *= 2;
+                    worklist = (int *)MemRealloc(worklist, worklistCapacity * sizeof(int));
+                }
+                worklist[worklistSize++] = destination;
+            }
+            // unconditional control transfers mark their last byte
+            if( ROM_IS_ENDCODE(rom, offset + bytesPerInst - 1) ) {
+                break;
+            }
+            offset += bytesPerInst;
         }
-        offset += bytesPerInst;
+    }
+
+    MemFree(worklist);
+}
+
+void analyzeRom(RomImage * const rom)
+{
+    const int entries[] = { rom->entrypoint, 0x40, 0x48, 0x50, 0x58, 0x60 };
+    // only cartridges have interrupt vectors worth following
+    analyzeFrom(rom, entries, (CARTRIDGE_ENTRY == rom->entrypoint)? NUM_ELEMENTS(entries) : 1);
+}
+
+// Picks up code that static analysis couldn't reach, such as banked code called from bank 0
+//  or the target of a JP HL, once the cpu actually executes it
+void analyzeRomFrom(RomImage * const rom, const int offset)
+{
+    if( !ROM_IS_CODE(rom, offset) ) {
+        ROM_SET_JUMPDEST(rom, offset);
+        analyzeFrom(rom, &offset, 1);
+        rom->flagsGeneration++;
+    }
+}
+
+static void *analyzeRomThread(void *arg)
+{
+    RomAnalysis *analysis = (RomAnalysis *)arg;
+    analyzeRom(analysis->rom);
+    romCacheAnalyzed(analysis->rom);
+    __atomic_store_n(&analysis->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Classifies the rom on a background thread, contentFlags must not be used until romAnalysisDone()
+void analyzeRomAsync(RomImage * const rom)
+{
+    RomAnalysis *analysis = (RomAnalysis *)MemAlloc(sizeof(RomAnalysis));
+    analysis->rom = rom;
+    rom->analysis = analysis;
+    if( 0 != pthread_create(&analysis->thread, NULL, analyzeRomThread, analysis) ) {
+        // no thread available, just do it now
+        analyzeRomThread(analysis);
+        analysis->rom = NULL;
     }
 }
 
+bool romAnalysisDone(const RomImage * const rom)
+{
+    return (NULL != rom->analysis) && __atomic_load_n(&rom->analysis->done, __ATOMIC_ACQUIRE);
+}
+
+// For contentFlags that are already classified, e.g. loaded from the analysis cache
+void markRomAnalyzed(RomImage * const rom)
+{
+    RomAnalysis *analysis = (RomAnalysis *)MemAlloc(sizeof(RomAnalysis));
+    analysis->done = true;
+    rom->analysis = analysis;
+}
+
+// Returns true if there had been an analysis, which is always complete by the time this returns
+bool romAnalysisWait(RomImage * const rom)
+{
+    if( NULL == rom->analysis ) {
+        return false;
+    }
+    if( NULL != rom->analysis->rom ) {
+        pthread_join(rom->analysis->thread, NULL);
+    }
+    MemFree(rom->analysis);
+    rom->analysis = NULL;
+    return true;
+}
+
 void disassembleRom(RomImage * const rom)
 {
     char buffer[32];
@@ -55,7 +190,7 @@ void disassembleRom(RomImage * const rom)
             offset += index;
         } else if( ROM_IS_CODE(rom, offset) || ROM_IS_INVALID(rom, offset) ) {
             if( ROM_IS_JUMPDEST(rom, offset) ) {
-                printf("LABEL_%04X:\n", offset);
+                printf("LABEL_%04X:\n", romAddrForOffset(offset));
             }
             printf("        %04X | ", offset);
             buff = buffer;
@@ -147,7 +282,18 @@ static const char * const condDecode[] = {
 };
 
 
+// Records a branch from the instruction at offset to cpu address addr
+static void jumpTo(RomImage * const rom, const int offset, const uint16_t addr, int *jumpDest)
+{
+    const int dest = romOffsetForAddr(rom, offset, addr);
+    if( 0 <= dest ) {
+        ROM_SET_JUMPDEST(rom, dest);
+    }
+    *jumpDest = dest;
+}
+
 // buffer parameter must be large enough!!!
+// jumpDest is set to the rom offset of any branch destination, -1 if unknown
 // returns number of bytes consumed
 int disassembleInstruction(RomImage * const rom, const int offset, char ** buffer, int *jumpDest)
 {
@@ -188,10 +334,9 @@ int disassembleInstruction(RomImage * const rom, const int offset, char ** buffe
                 buff = buff + sprintf(buff, "STOP");
                 break;
             case 3:
-                addr = MEM_IMM8_OFFSET_TO_ADDR(memory,offset);
+                addr = romAddrForOffset(offset) + (int8_t)memory[offset+1] + 2;
                 buff = buff + sprintf(buff, "JR   LABEL_%04X", addr);
-                ROM_SET_JUMPDEST(rom, addr);
-                *jumpDest = addr;
+                jumpTo(rom, offset, addr, jumpDest);
                 ROM_SET_ENDCODE(rom, offset+1);
                 consumed = 2;
                 break;
@@ -199,10 +344,9 @@ int disassembleInstruction(RomImage * const rom, const int offset, char ** buffe
             case 5:
             case 6:
             case 7:
-                addr = MEM_IMM8_OFFSET_TO_ADDR(memory,offset);
+                addr = romAddrForOffset(offset) + (int8_t)memory[offset+1] + 2;
                 buff = buff + sprintf(buff, "JR   %s, LABEL_%04X", condDecode[cond], addr);
-                ROM_SET_JUMPDEST(rom, addr);
-                *jumpDest = addr;
+                jumpTo(rom, offset, addr, jumpDest);
                 consumed = 2;
             }
             break;
@@ -348,8 +492,7 @@ int disassembleInstruction(RomImage * const rom, const int offset, char ** buffe
                 case 3:
                     addr = MEM_IMM16_EXTRACT(memory, offset);
                     buff = buff + sprintf(buff, "JP   %s, LABEL_%04X", condDecode[cond], addr);
-                    ROM_SET_JUMPDEST(rom, addr);
-                    *jumpDest = addr;
+                    jumpTo(rom, offset, addr, jumpDest);
                     consumed = 3;
                     break;
                 case 4:
@@ -373,8 +516,7 @@ int disassembleInstruction(RomImage * const rom, const int offset, char ** buffe
                 case 0:
                     addr = MEM_IMM16_EXTRACT(memory, offset);
                     buff = buff + sprintf(buff, "JP   LABEL_%04X", addr);
-                    ROM_SET_JUMPDEST(rom, addr);
-                    *jumpDest = addr;
+                    jumpTo(rom, offset, addr, jumpDest);
                     ROM_SET_ENDCODE(rom, offset+2);
                     consumed = 3;
                     break;
@@ -398,8 +540,7 @@ int disassembleInstruction(RomImage * const rom, const int offset, char ** buffe
                 if( op_a <= 3 ) {
                     addr = MEM_IMM16_EXTRACT(memory, offset);
                     buff = buff + sprintf(buff, "CALL %s, LABEL_%04X", condDecode[cond], addr);
-                    ROM_SET_JUMPDEST(rom, addr);
-                    *jumpDest = addr;
+                    jumpTo(rom, offset, addr, jumpDest);
                     consumed = 3;
                 } else {
                     buff = buff + sprintf(buff, "INVALID");
@@ -417,8 +558,7 @@ int disassembleInstruction(RomImage * const rom, const int offset, char ** buffe
                 case 1:
                     addr = MEM_IMM16_EXTRACT(memory, offset);
                     buff = buff + sprintf(buff, "CALL LABEL_%04X", addr);
-                    ROM_SET_JUMPDEST(rom, addr);
-                    *jumpDest = addr;
+                    jumpTo(rom, offset, addr, jumpDest);
                     consumed = 3;
                     break;
                 case 3:
@@ -437,8 +577,7 @@ int disassembleInstruction(RomImage * const rom, const int offset, char ** buffe
             case 7:
                 addr = INST_RST_TGT3_EXTRACT(instruction) * 8;
                 buff = buff + sprintf(buff, "RST 0x%02X (LABEL_%04X)", addr, addr);
-                ROM_SET_JUMPDEST(rom, addr);
-                *jumpDest = addr;
+                jumpTo(rom, offset, addr, jumpDest);
                 break;
             }
         }
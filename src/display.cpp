@@ -6,10 +6,15 @@
 
 #include "gb.h"
 #include "gui.h"
+#include "trace.h"
+#include "doctorlog.h"
+#include "rewind.h"
+#include "rlgl.h"
 
-// Setting this will cause the execution loop to redraw the gui & screen
+// Set when a frame is finished, the emulation thread publishes it to the gui and clears this
 // Most often set at the beginning of vblank
 bool guiUpdateScreen = false;
+bool displaySkipFrame = false;
 
 typedef struct {
     struct {
@@ -30,11 +35,37 @@ struct {
     };
 } vram;
 
-struct {
-    Image image;
-    Texture2D tex;
-    bool dirty;
-} tileTextures[384];
+// Tiles are kept on the GPU as raw 2-bit color indexes, 16 tiles across, and the palettes are
+//  applied by the shaders in resources/Shaders, so palette writes never touch a texture.
+//  Indexes are stored inverted and scaled, (3-index)*85, so the atlas reads as the default
+//  greyscale palette.  Without the shaders the palettes are applied here instead, into an
+//  RGBA atlas per palette that's redone when the tiles or that palette change.
+#define TILE_ATLAS_WIDTH    (16*8)
+#define TILE_ATLAS_HEIGHT   (24*8)
+#define TILEMAP_SHADER      "resources/Shaders/tilemap.fs"
+#define PALETTE_SHADER      "resources/Shaders/palette.fs"
+
+static bool tileDirty[384];             // set by VRAM writes, cleared once copied for the panels
+static uint32_t tileGeneration = 0;     // bumped whenever a tile is decoded again
+
+static struct {
+    bool loaded;        // attempted, the shaders may still have failed
+    bool shadersValid;
+    uint8_t atlas[TILE_ATLAS_HEIGHT][TILE_ATLAS_WIDTH];
+    Texture2D atlasTex;
+    Texture2D mapTex;   // both maps' tile references, stacked
+    Shader mapShader;
+    int mapAtlasLoc;
+    int mapSignedLoc;
+    int mapPaletteLoc;
+    Shader paletteShader;
+    int palettesLoc;
+    // only without the shaders, for BGP, OBP0 and OBP1
+    Color paletteAtlas[3][TILE_ATLAS_HEIGHT][TILE_ATLAS_WIDTH];
+    Texture2D paletteAtlasTex[3];
+    uint32_t paletteAtlasGeneration[3];     // tileGeneration they were applied to
+    int paletteAtlasReg[3];                 // palette register value applied, -1 for none yet
+} tileGpu;
 
 static RamImage vramImage;
 
@@ -118,6 +149,21 @@ struct {
 // The actual contents of the screen
 int screenData[SCREEN_HEIGHT][SCREEN_WIDTH];
 
+// Finished frames are handed to the GUI through a triple buffer: the emulation thread fills
+//  one slot, the GUI draws from another, and the third holds the newest finished frame.
+//  Publishing and acquiring just swap a slot index, so neither side ever waits on the other.
+typedef struct {
+    bool displayEnabled;
+    uint8_t pixels[SCREEN_HEIGHT][SCREEN_WIDTH];
+} ScreenFrame;
+
+#define FRAME_FRESH (0x4)   // set in latestFrame when it hasn't been acquired yet
+
+static ScreenFrame screenFrames[3];
+static int writeFrame = 0;      // emulation thread only
+static int readFrame = 1;       // GUI thread only
+static int latestFrame = 2;     // swapped between them
+
 #define INT_STAT_HBLANK (0x08)
 #define INT_STAT_VBLANK (0x10)
 #define INT_STAT_OAM    (0x20)
@@ -138,6 +184,7 @@ uint8_t activeStatFlags = 0;
 #define SCANLINE_CYCLES     (OAM_CYCLES + DRAW_MIN_CYCLES + HBLANK_MAX_CYCLES)  // 456 cycles
 #define VBLANK_CYCLES       (SCANLINE_CYCLES * 10)  // VBLANK 4560 cycles
 #define FRAME_CYCLES        (SCANLINE_CYCLES * 144 + VBLANK_CYCLES)  // 70224 cycles
+static_assert(LCD_FRAME_DOTS == FRAME_CYCLES, "LCD_FRAME_DOTS out of sync");
 
 #define LCD_VBLANK_LINES    (10)
 #define LCD_TOTAL_SCANLINES (SCREEN_HEIGHT + LCD_VBLANK_LINES)
@@ -153,7 +200,7 @@ void setVram8(uint16_t addr, uint8_t val8)
 {
     vram.contents[addr&0x1FFF] = val8;
     if( sizeof(vram.tiles) > addr ) {
-        tileTextures[addr/sizeof(Tile)].dirty = true;
+        tileDirty[addr/sizeof(Tile)] = true;
     }
 }
 
@@ -215,12 +262,16 @@ void oamDmaCycle(void)
     if( OAM_SIZE > oamDmaOffset ) {
         oamRam.contents[oamDmaOffset] = getRawMem8((regs.OAM.val << 8) + oamDmaOffset);
         oamDmaOffset++;
+        if( OAM_SIZE == oamDmaOffset ) {
+            TRACE_END(TRACE_TRACK_OAM_DMA);
+        }
     }
     if( START == oamDmaStart ) {
         oamDmaStart = DELAY;
     } else if( DELAY == oamDmaStart ) {
         oamDmaStart = IDLE;
         oamDmaOffset = 0;
+        TRACE_BEGIN(TRACE_TRACK_OAM_DMA, "OAM DMA", -1);
     }
 }
 
@@ -279,6 +330,7 @@ void setGfxReg8(uint16_t addr, const uint8_t val8)
                 frameCounter = SCANLINE_CYCLES*regs.LY.val + scanlineCounter;
                 regs.LY.val = 0;
                 regs.STAT.ppuMode = 0;
+                TRACE_END(TRACE_TRACK_PPU);
                 scanlineCounter=0;
                 activeStatFlags=0;
             } else {
@@ -315,30 +367,12 @@ void setGfxReg8(uint16_t addr, const uint8_t val8)
             oamDmaStart = START;
             return;
         case REG_BGP_ADDR:
-            if( val8 != regs.BGP.val ) {
-                // Palette update, mark all tiles as dirty
-                for(int i=0; i<384; i++) {
-                    tileTextures[i].dirty = true;
-                }
-            }
             regs.BGP.val = val8;
             return;
         case REG_OBP0_ADDR:
-            if( val8 != regs.BGP.val ) {
-                // Palette update, mark all tiles as dirty
-                for(int i=0; i<384; i++) {
-                    tileTextures[i].dirty = true;
-                }
-            }
             regs.OBP0.val = val8;
             return;
         case REG_OBP1_ADDR:
-            if( val8 != regs.BGP.val ) {
-                // Palette update, mark all tiles as dirty
-                for(int i=0; i<384; i++) {
-                    tileTextures[i].dirty = true;
-                }
-            }
             regs.OBP1.val = val8;
             return;
         case REG_WY_ADDR:
@@ -363,7 +397,7 @@ uint8_t getGfxReg8(uint16_t addr)
         case REG_SCX_ADDR:
             return regs.SCX.val;
         case REG_LY_ADDR:
-            if( NULL != doctorLogFile ) {
+            if( doctorLogEnabled ) {
                 // special case when running tests
                 return 0x90;
             } else {
@@ -658,14 +692,18 @@ struct {
     OamEntry object;
 } scanlineObjects[MAX_OBJECTS_PER_LINE];
 
+// Where ppuCycles is in the current scanline
+static struct {
+    uint8_t xSkip;
+    uint8_t xCoordinate;
+    bool windowActive;
+    uint8_t windowLine;
+    int foundObjects;
+    OamEntry *objInProcess;
+} ppu;
+
 void ppuCycles(int cycles)
 {
-    static uint8_t xSkip = 0;
-    static uint8_t xCoordinate = 0;
-    static bool windowActive = false;
-    static uint8_t windowLine = 0;
-    static int foundObjects = 0;
-    static OamEntry *objInProcess = nullptr;
 
     while(cycles--) {
         if(0 == regs.LCDC.displayEnable) {
@@ -693,103 +731,109 @@ void ppuCycles(int cycles)
                             LY+ 16 < oam.y+h    */
                         if( ((regs.LY.val + 16) >= object->yPos)
                         &&  ((regs.LY.val + 16) < (object->yPos + ((0 == regs.LCDC.objSize)? 8 : 16)))
-                        &&  (MAX_OBJECTS_PER_LINE > foundObjects) ) {
-                            scanlineObjects[foundObjects].object = *object;
-                            scanlineObjects[foundObjects].oamIndex = (scanlineCounter >> 1);
-                            foundObjects++;
+                        &&  (MAX_OBJECTS_PER_LINE > ppu.foundObjects) ) {
+                            scanlineObjects[ppu.foundObjects].object = *object;
+                            scanlineObjects[ppu.foundObjects].oamIndex = (scanlineCounter >> 1);
+                            ppu.foundObjects++;
                         }
                     }
 
                     if( OAM_CYCLES <= scanlineCounter ) {
                         // advance to DRAW
-                        xCoordinate = 0;
-                        windowActive = false;
+                        ppu.xCoordinate = 0;
+                        ppu.windowActive = false;
                         regs.STAT.ppuMode = MODE_DRAW;
+                        TRACE_BEGIN(TRACE_TRACK_PPU, "draw", regs.LY.val);
                         activeStatFlags &= ~INT_STAT_OAM;
                         bgFetch.reset(true, false);
-                        xSkip = regs.SCX.val & 0x7;
-                        objInProcess = nullptr;
+                        ppu.xSkip = regs.SCX.val & 0x7;
+                        ppu.objInProcess = nullptr;
                     }
                     break;
 
                 case MODE_DRAW:
 
-                    if( nullptr == objInProcess ) {
+                    if( nullptr == ppu.objInProcess ) {
                         // check if we've reached the location of an object
                         // This search loop ensures the object found first in OAM memory always wins
                         //  even if a later object would have a matching x value
-                        for(int i=0; i<foundObjects; i++) {
-                            if( xCoordinate + 8 >= scanlineObjects[i].object.xPos ) {
-                                objInProcess = &scanlineObjects[i].object;
+                        for(int i=0; i<ppu.foundObjects; i++) {
+                            if( ppu.xCoordinate + 8 >= scanlineObjects[i].object.xPos ) {
+                                ppu.objInProcess = &scanlineObjects[i].object;
                                 // some references suggest resetting the background fetcher here,
                                 //   but that then exceeds proper line timing
                                 objFetch.reset(false);
-                                objFetch.cycle(objInProcess);
+                                objFetch.cycle(ppu.objInProcess);
                                 break;
                             }
                         }
                     } else {
                         // object fetching takes precedence over everything else
-                        if( true == objFetch.cycle(objInProcess) ) {
+                        if( true == objFetch.cycle(ppu.objInProcess) ) {
                             // this object fetch is complete
                             // set the x val really high so it isn't processed again
-                            objInProcess->xPos = 0xFF;
-                            objInProcess = nullptr;
+                            ppu.objInProcess->xPos = 0xFF;
+                            ppu.objInProcess = nullptr;
                             break;
                         }
                     }
-                    if(nullptr != objInProcess) {
+                    if(nullptr != ppu.objInProcess) {
                         // if we're still working on fetching an object, skip everything else
                         break;
                     }
 
 
-                    bgFetch.cycle(xCoordinate, windowActive, windowLine);
+                    bgFetch.cycle(ppu.xCoordinate, ppu.windowActive, ppu.windowLine);
                     if(!bgFetch.empty()) {
                         int bgPalRef = bgFetch.pop();
 
-                        if(0 == xCoordinate && 0 < xSkip) {
-                            xSkip--;
+                        if(0 == ppu.xCoordinate && 0 < ppu.xSkip) {
+                            ppu.xSkip--;
                         } else {
                             assert(regs.LY.val < SCREEN_HEIGHT);
-                            assert(xCoordinate < SCREEN_WIDTH);
+                            assert(ppu.xCoordinate < SCREEN_WIDTH);
 
-                            if(!objFetch.empty()) {
+                            if( displaySkipFrame ) {
+                                // nobody will see this frame, keep the object FIFO moving but skip the mixing
+                                if(!objFetch.empty()) {
+                                    objFetch.pop();
+                                }
+                            } else if(!objFetch.empty()) {
                                 ObjPixel objPix = objFetch.pop();
                                 uint8_t palette = (0==objPix.pal)? regs.OBP0.val : regs.OBP1.val;
                                 if(0 == objPix.pri) {
                                     // object takes priority
                                     if( (1 == regs.LCDC.objEnable) && (0 != objPix.palRef) ) {
-                                        screenData[regs.LY.val][xCoordinate] = PALETTE_COLOR(palette, objPix.palRef);
+                                        screenData[regs.LY.val][ppu.xCoordinate] = PALETTE_COLOR(palette, objPix.palRef);
                                     } else if( 1 == regs.LCDC.bgWinEnable ) {
-                                        screenData[regs.LY.val][xCoordinate] = PALETTE_COLOR(regs.BGP.val, bgPalRef);
+                                        screenData[regs.LY.val][ppu.xCoordinate] = PALETTE_COLOR(regs.BGP.val, bgPalRef);
                                     } else {
-                                        screenData[regs.LY.val][xCoordinate] = 0;
+                                        screenData[regs.LY.val][ppu.xCoordinate] = 0;
                                     }
                                 } else {
                                     // background takes priority
                                     if( (1 == regs.LCDC.objEnable) && (0 == bgPalRef) && (0 != objPix.palRef) ) {
-                                        screenData[regs.LY.val][xCoordinate] = PALETTE_COLOR(palette, objPix.palRef);
+                                        screenData[regs.LY.val][ppu.xCoordinate] = PALETTE_COLOR(palette, objPix.palRef);
                                     } else if( 1 == regs.LCDC.bgWinEnable ) {
-                                        screenData[regs.LY.val][xCoordinate] = PALETTE_COLOR(regs.BGP.val, bgPalRef);
+                                        screenData[regs.LY.val][ppu.xCoordinate] = PALETTE_COLOR(regs.BGP.val, bgPalRef);
                                     } else {
-                                        screenData[regs.LY.val][xCoordinate] = 0;
+                                        screenData[regs.LY.val][ppu.xCoordinate] = 0;
                                     }
                                 }
 
                             } else {
                                 if(regs.LCDC.bgWinEnable) {
-                                    screenData[regs.LY.val][xCoordinate] = PALETTE_COLOR(regs.BGP.val, bgPalRef);
+                                    screenData[regs.LY.val][ppu.xCoordinate] = PALETTE_COLOR(regs.BGP.val, bgPalRef);
                                 } else {
-                                    screenData[regs.LY.val][xCoordinate] = 0;
+                                    screenData[regs.LY.val][ppu.xCoordinate] = 0;
                                 }
                             }
-                            xCoordinate++;
+                            ppu.xCoordinate++;
 
                             if(true == regs.LCDC.windowEnable) {
-                                if( (0 < windowLine) || (regs.WY.val == regs.LY.val) ) {
-                                    if( !windowActive && (regs.WX.val - 7) <= xCoordinate ) {
-                                        windowActive = true;
+                                if( (0 < ppu.windowLine) || (regs.WY.val == regs.LY.val) ) {
+                                    if( !ppu.windowActive && (regs.WX.val - 7) <= ppu.xCoordinate ) {
+                                        ppu.windowActive = true;
                                         bgFetch.reset(false, true);
                                     }
                                 }
@@ -797,10 +841,11 @@ void ppuCycles(int cycles)
                         }
                     }
 
-                    if( SCREEN_WIDTH <= xCoordinate  ) {
+                    if( SCREEN_WIDTH <= ppu.xCoordinate  ) {
                         assert((OAM_CYCLES + DRAW_MAX_CYCLES) >= scanlineCounter);
                         // advance to HBLANK
                         regs.STAT.ppuMode = MODE_HBLANK;
+                        TRACE_BEGIN(TRACE_TRACK_PPU, "hblank", regs.LY.val);
                         maybeTriggerStatInterrupt(INT_STAT_HBLANK);
                         objFetch.reset(true);
                     }
@@ -815,9 +860,10 @@ void ppuCycles(int cycles)
 
                         if( SCREEN_HEIGHT <= regs.LY.val ) {
                             regs.STAT.ppuMode = MODE_VBLANK;
+                            TRACE_BEGIN(TRACE_TRACK_PPU, "vblank", regs.LY.val);
                             maybeTriggerStatInterrupt(INT_STAT_VBLANK);
                             setIntFlag(INT_VBLANK);  // always triggered
-                            windowLine = 0;
+                            ppu.windowLine = 0;
                             if(true == bootRomActive) {
                                 if( false == fastBoot ) {
                                     // Even if we're not in fastboot mode, we refresh the gui 10 times less
@@ -829,12 +875,13 @@ void ppuCycles(int cycles)
                             }
                         } else {
                             regs.STAT.ppuMode = MODE_OAM;
+                            TRACE_BEGIN(TRACE_TRACK_PPU, "oam scan", regs.LY.val);
                             maybeTriggerStatInterrupt(INT_STAT_OAM);
-                            if(true == windowActive) {
-                                windowLine++;
+                            if(true == ppu.windowActive) {
+                                ppu.windowLine++;
                             }
                             memset(scanlineObjects, 0xFF, sizeof(scanlineObjects));
-                            foundObjects = 0;
+                            ppu.foundObjects = 0;
                         }
                         activeStatFlags &= ~INT_STAT_HBLANK;
                     }
@@ -855,10 +902,12 @@ void ppuCycles(int cycles)
                             frameCounter = 0;
 
                             regs.STAT.ppuMode = MODE_OAM;
+                            TRACE_BEGIN(TRACE_TRACK_PPU, "oam scan", regs.LY.val);
                             maybeTriggerStatInterrupt(INT_STAT_OAM);
                             activeStatFlags &= ~INT_STAT_VBLANK;
                         } else {
                             regs.LY.val++;
+                            TRACE_BEGIN(TRACE_TRACK_PPU, "vblank", regs.LY.val);
                         }
                         checkLYC();
                     }
@@ -891,48 +940,170 @@ static const Color screenPaletteColor[4] = {
     (Color){ 8,   41,  85,  255 }
 };
 
-static void guiRegenTileTex(int index, Tile *tile)
+// What the tile, map and object panels show, copied by guiSnapshotDisplay with the emulation
+//  lock held so they can be drawn without it.  Only the tiles written since are copied again.
+static struct {
+    decltype(::regs) regs;
+    decltype(::vram) vram;
+    decltype(oamRam) oam;
+    decltype(::scanlineObjects) scanlineObjects;
+    bool tileDirty[384];    // copied but not yet decoded into the atlas
+} guiDisplay;
+
+void guiSnapshotDisplay(void)
+{
+    guiDisplay.regs = regs;
+    memcpy(guiDisplay.vram.tileMap, vram.tileMap, sizeof(vram.tileMap));
+    for( int i=0; i<384; i++ ) {
+        if( tileDirty[i] ) {
+            guiDisplay.vram.tiles[i] = vram.tiles[i];
+            guiDisplay.tileDirty[i] = true;
+            tileDirty[i] = false;
+        }
+    }
+    guiDisplay.oam = oamRam;
+    memcpy(guiDisplay.scanlineObjects, scanlineObjects, sizeof(scanlineObjects));
+}
+
+static void guiDecodeAtlasTile(int index, const Tile * const tile)
 {
-    // Rendering tile with all three palettes to the same texture
-    // Then when drawing the tile, the appropriate portion of the texture can be selected
-    //  based on the desired palette in use.
-    ImageClearBackground(&tileTextures[index].image, BLANK);
     for( int y = 0; y < 8; y++ ) {
+        uint8_t * const row = &tileGpu.atlas[(index/16)*8 + y][(index%16)*8];
         for( int x = 0; x < 8; x++ ) {
-            int pixelPalIdx = (BIT(tile->line[y].hBits, 7-x) << 1) | BIT(tile->line[y].lBits, 7-x);
-            int palColor = PALETTE_COLOR(regs.BGP.val, pixelPalIdx);
-            ImageDrawPixel(&tileTextures[index].image, x, y, paletteColor[palColor]);
-            if( 0 != pixelPalIdx ) {
-                palColor = PALETTE_COLOR(regs.OBP0.val, pixelPalIdx);
-                ImageDrawPixel(&tileTextures[index].image, x+8, y, paletteColor[palColor]);
-                palColor = PALETTE_COLOR(regs.OBP1.val, pixelPalIdx);
-                ImageDrawPixel(&tileTextures[index].image, x+16, y, paletteColor[palColor]);
-            }
+            const int pixelPalIdx = (BIT(tile->line[y].hBits, 7-x) << 1) | BIT(tile->line[y].lBits, 7-x);
+            row[x] = (3 - pixelPalIdx) * 85;
+        }
+    }
+}
+
+// Loaded the first time a tile panel is drawn, on the GUI thread
+static void guiLoadTileGpu(void)
+{
+    tileGpu.loaded = true;
+    memset(guiDisplay.tileDirty, true, sizeof(guiDisplay.tileDirty));
+    Image atlas = { tileGpu.atlas, TILE_ATLAS_WIDTH, TILE_ATLAS_HEIGHT, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE };
+    tileGpu.atlasTex = LoadTextureFromImage(atlas);
+    Image maps = { guiDisplay.vram.tileMap, 32, 2*32, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE };
+    tileGpu.mapTex = LoadTextureFromImage(maps);
+
+    tileGpu.mapShader = LoadShader(NULL, TILEMAP_SHADER);
+    tileGpu.paletteShader = LoadShader(NULL, PALETTE_SHADER);
+    tileGpu.shadersValid = (rlGetShaderIdDefault() != tileGpu.mapShader.id) && (rlGetShaderIdDefault() != tileGpu.paletteShader.id);
+    if( tileGpu.shadersValid ) {
+        tileGpu.mapAtlasLoc = GetShaderLocation(tileGpu.mapShader, "tileAtlas");
+        tileGpu.mapSignedLoc = GetShaderLocation(tileGpu.mapShader, "signedTileData");
+        tileGpu.mapPaletteLoc = GetShaderLocation(tileGpu.mapShader, "palette");
+        tileGpu.palettesLoc = GetShaderLocation(tileGpu.paletteShader, "palettes");
+    } else {
+        printf("Unable to load the tile shaders, palettes will be applied without them\n");
+        for( int palette = 0; palette < 3; palette++ ) {
+            Image image = { tileGpu.paletteAtlas[palette], TILE_ATLAS_WIDTH, TILE_ATLAS_HEIGHT, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+            tileGpu.paletteAtlasTex[palette] = LoadTextureFromImage(image);
+            tileGpu.paletteAtlasReg[palette] = -1;
         }
     }
-    UnloadTexture(tileTextures[index].tex);
-    tileTextures[index].tex = LoadTextureFromImage(tileTextures[index].image);
+}
 
+// What the palette shader does, for when it isn't there
+static void guiApplyAtlasPalettes(void)
+{
+    const uint8_t paletteRegs[3] = { guiDisplay.regs.BGP.val, guiDisplay.regs.OBP0.val, guiDisplay.regs.OBP1.val };
+    for( int palette = 0; palette < 3; palette++ ) {
+        if( (tileGpu.paletteAtlasReg[palette] == paletteRegs[palette])
+         && (tileGpu.paletteAtlasGeneration[palette] == tileGeneration) ) {
+            continue;
+        }
+        for( int y = 0; y < TILE_ATLAS_HEIGHT; y++ ) {
+            for( int x = 0; x < TILE_ATLAS_WIDTH; x++ ) {
+                const int colorIndex = 3 - (tileGpu.atlas[y][x] / 85);
+                // object color 0 is transparent
+                tileGpu.paletteAtlas[palette][y][x] = ((0 != palette) && (0 == colorIndex))?
+                    BLANK : paletteColor[PALETTE_COLOR(paletteRegs[palette], colorIndex)];
+            }
+        }
+        UpdateTexture(tileGpu.paletteAtlasTex[palette], tileGpu.paletteAtlas[palette]);
+        tileGpu.paletteAtlasReg[palette] = paletteRegs[palette];
+        tileGpu.paletteAtlasGeneration[palette] = tileGeneration;
+    }
 }
 
 static void guiRegenDirtyTiles(void)
 {
+    if( !tileGpu.loaded ) {
+        guiLoadTileGpu();
+    }
+    bool changed = false;
     for(int i=0; i<384; i++) {
-        if(true == tileTextures[i].dirty) {
-            guiRegenTileTex(i, (Tile *)&vram.tiles[i]);
-            tileTextures[i].dirty = false;
+        if(true == guiDisplay.tileDirty[i]) {
+            guiDecodeAtlasTile(i, &guiDisplay.vram.tiles[i]);
+            guiDisplay.tileDirty[i] = false;
+            changed = true;
         }
     }
+    if( changed ) {
+        UpdateTexture(tileGpu.atlasTex, tileGpu.atlas);
+        tileGeneration++;
+    }
+    if( !tileGpu.shadersValid ) {
+        guiApplyAtlasPalettes();
+    }
+}
+
+// Starts a panel cache key from the tiles, the palettes and the given register values
+static uint64_t guiTilePanelKey(const uint8_t reg1, const uint8_t reg2)
+{
+    const uint8_t regValues[5] = { guiDisplay.regs.BGP.val, guiDisplay.regs.OBP0.val, guiDisplay.regs.OBP1.val, reg1, reg2 };
+    uint64_t key = guiPanelHash(PANEL_HASH_SEED, &tileGeneration, sizeof(tileGeneration));
+    return guiPanelHash(key, regValues, sizeof(regValues));
+}
+
+// A palette register's four colors, as shader uniforms
+static void guiPaletteUniform(float colors[4][4], const uint8_t paletteReg)
+{
+    for( int palIdx = 0; palIdx < 4; palIdx++ ) {
+        const Vector4 color = ColorNormalize(paletteColor[PALETTE_COLOR(paletteReg, palIdx)]);
+        colors[palIdx][0] = color.x;
+        colors[palIdx][1] = color.y;
+        colors[palIdx][2] = color.z;
+        colors[palIdx][3] = color.w;
+    }
+}
+
+// guiDrawTile2 may only be used between these two, and nothing else may be drawn in between
+static void guiBeginTiles(void)
+{
+    if( tileGpu.shadersValid ) {
+        float palettes[3*4][4];     // BGP, OBP0, OBP1
+        guiPaletteUniform(&palettes[0], guiDisplay.regs.BGP.val);
+        guiPaletteUniform(&palettes[4], guiDisplay.regs.OBP0.val);
+        guiPaletteUniform(&palettes[8], guiDisplay.regs.OBP1.val);
+        BeginShaderMode(tileGpu.paletteShader);
+        SetShaderValueV(tileGpu.paletteShader, tileGpu.palettesLoc, palettes, SHADER_UNIFORM_VEC4, 3*4);
+    }
+}
+
+static void guiEndTiles(void)
+{
+    if( tileGpu.shadersValid ) {
+        EndShaderMode();
+    }
 }
 
+// palette is 0 for BGP, 1 for OBP0 and 2 for OBP1
 static void guiDrawTile2(const Vector2 anchor, int index, bool xFlip, bool yFlip, uint8_t palette, float scale)
 {
-    Rectangle source = { (float)8*palette, 0, 8, 8 };
+    Rectangle source = { (float)(index%16)*8, (float)(index/16)*8, 8, 8 };
     if( xFlip ) { source.width = -source.width; }
     if( yFlip ) { source.height = -source.height; }
     Rectangle dest = { anchor.x, anchor.y, 8*scale, 8*scale};
     Vector2 origin = { 0.0f, 0.0f };
-    DrawTexturePro(tileTextures[index].tex, source, dest, origin, 0, WHITE);
+    if( tileGpu.shadersValid ) {
+        // the shader picks the palette from the vertex color, so tiles with different palettes
+        //  still batch into one draw call
+        DrawTexturePro(tileGpu.atlasTex, source, dest, origin, 0, (Color){ palette, 0, 0, 255 });
+    } else {
+        DrawTexturePro(tileGpu.paletteAtlasTex[palette], source, dest, origin, 0, WHITE);
+    }
 }
 
 static void guiDrawMapFrame(const Vector2 anchor, uint16_t x, uint16_t y, Color color)
@@ -987,17 +1158,17 @@ static void guiDrawMapFrame(const Vector2 anchor, uint16_t x, uint16_t y, Color
     }
 }
 
-Vector2 guiDrawDisplayObjects(const Vector2 anchor)
+static void guiDrawObjectsPanel(const Vector2 anchor)
 {
-    // WxH 256+8 x 256+16
     DrawRectangle(anchor.x, anchor.y, 256+8, 256+16, WHITE);
-    DrawRectangle(anchor.x+8, anchor.y+16, SCREEN_WIDTH, SCREEN_HEIGHT, paletteColor[regs.BGP.palCol0]);
+    DrawRectangle(anchor.x+8, anchor.y+16, SCREEN_WIDTH, SCREEN_HEIGHT, paletteColor[guiDisplay.regs.BGP.palCol0]);
+    guiBeginTiles();
     for( int i=0; i < OAM_ENTRIES; i++ ) {
-        OamEntry *object = &oamRam.entries[i];
+        OamEntry *object = &guiDisplay.oam.entries[i];
 
         Vector2 tileAnchor = { anchor.x + object->xPos, anchor.y + object->yPos };
-        PaletteReg pal = (object->attributes.palette)? regs.OBP0: regs.OBP1;
-        if( 0 == regs.LCDC.objSize ) {
+        PaletteReg pal = (object->attributes.palette)? guiDisplay.regs.OBP0: guiDisplay.regs.OBP1;
+        if( 0 == guiDisplay.regs.LCDC.objSize ) {
             guiDrawTile2(tileAnchor, object->tileIndex,
                         object->attributes.xFlip, object->attributes.yFlip,
                         1+object->attributes.palette, 1);
@@ -1011,10 +1182,25 @@ Vector2 guiDrawDisplayObjects(const Vector2 anchor)
                         1+object->attributes.palette, 1);
         }
     }
+    guiEndTiles();
     DrawRectangle(anchor.x, anchor.y,                   256+8, 16, ColorAlpha(GRAY,0.3));
     DrawRectangle(anchor.x, anchor.y+SCREEN_HEIGHT+16,  256+8, 256-SCREEN_HEIGHT, ColorAlpha(GRAY,0.3));
     DrawRectangle(anchor.x, anchor.y+16,                8, SCREEN_HEIGHT, ColorAlpha(GRAY,0.3));
     DrawRectangle(anchor.x+SCREEN_WIDTH+8, anchor.y+16, 256-SCREEN_WIDTH, SCREEN_HEIGHT, ColorAlpha(GRAY,0.3));
+}
+
+Vector2 guiDrawDisplayObjects(const Vector2 anchor)
+{
+    // WxH 256+8 x 256+16
+    static PanelCache cache;
+    guiRegenDirtyTiles();
+    uint64_t key = guiTilePanelKey(guiDisplay.regs.LCDC.objSize, 0);
+    key = guiPanelHash(key, guiDisplay.oam.contents, sizeof(guiDisplay.oam.contents));
+    if( guiPanelCacheBegin(&cache, (Vector2){256+8, 256+16}, key, BLANK) ) {
+        guiDrawObjectsPanel((Vector2){ 0, 0 });
+        guiPanelCacheEnd();
+    }
+    guiPanelCacheDraw(&cache, anchor);
 
     return (Vector2){256+8, 256+16};
 }
@@ -1026,7 +1212,7 @@ Vector2 guiDrawOamEntry(const Vector2 viewAnchor, int index)
     Vector2 anchor = viewAnchor;
 
     if(index < OAM_ENTRIES) {
-        entry = oamRam.entries[index];
+        entry = guiDisplay.oam.entries[index];
     } else if( OAM_ENTRIES == index ) {
         // Divide the two categories
         Color color = GetColor(GuiGetStyle(DEFAULT, LINE_COLOR));
@@ -1040,8 +1226,8 @@ Vector2 guiDrawOamEntry(const Vector2 viewAnchor, int index)
         return (Vector2){anchor.x-viewAnchor.x, 36};
     } else {
         index -= (OAM_ENTRIES + 1);
-        entry = scanlineObjects[index].object;
-        index = scanlineObjects[index].oamIndex;
+        entry = guiDisplay.scanlineObjects[index].object;
+        index = guiDisplay.scanlineObjects[index].oamIndex;
     }
 
     anchor.x += 1;
@@ -1059,16 +1245,19 @@ Vector2 guiDrawOamEntry(const Vector2 viewAnchor, int index)
     size = guiDrawRegField(anchor, 2, "TILE", TextFormat("%02X", entry.tileIndex));
 
     anchor.x += size.x+FONTWIDTH;
-    if( 0 == regs.LCDC.objSize ) {
+    if( 0 == guiDisplay.regs.LCDC.objSize ) {
         anchor.y = viewAnchor.y+6;
-        DrawRectangleV(anchor, (Vector2){2*8,2*8}, paletteColor[regs.BGP.palCol0]);
+        DrawRectangleV(anchor, (Vector2){2*8,2*8}, paletteColor[guiDisplay.regs.BGP.palCol0]);
+        guiBeginTiles();
         guiDrawTile2(anchor, entry.tileIndex,
                     entry.attributes.xFlip, entry.attributes.yFlip,
                     1+entry.attributes.palette, 2);
+        guiEndTiles();
         anchor.x += 16+FONTWIDTH;
     } else {
         anchor.y = viewAnchor.y;
-        DrawRectangleV(anchor, (Vector2){2*8,2*2*8}, paletteColor[regs.BGP.palCol0]);
+        DrawRectangleV(anchor, (Vector2){2*8,2*2*8}, paletteColor[guiDisplay.regs.BGP.palCol0]);
+        guiBeginTiles();
         guiDrawTile2(anchor, (entry.tileIndex & 0xFE),
                     entry.attributes.xFlip, entry.attributes.yFlip,
                     1+entry.attributes.palette, 2);
@@ -1076,6 +1265,7 @@ Vector2 guiDrawOamEntry(const Vector2 viewAnchor, int index)
         guiDrawTile2(anchor, (entry.tileIndex & 0xFE)+1,
                     entry.attributes.xFlip, entry.attributes.yFlip,
                     1+entry.attributes.palette, 2);
+        guiEndTiles();
         anchor.x += 16+FONTWIDTH;
     }
 
@@ -1086,47 +1276,84 @@ Vector2 guiDrawOamEntry(const Vector2 viewAnchor, int index)
     return (Vector2){anchor.x-viewAnchor.x, size.y};
 }
 
-Vector2 guiDrawDisplayTileMap(const Vector2 anchor, const uint8_t map)
+static void guiDrawTileMapTiles(const Vector2 anchor, const uint8_t map)
 {
-    // Width x Height = 256 x 256 or 288 x 288
     Vector2 tileAnchor = anchor;
     uint8_t tileRef;
-    Tile *tile;
 
+    guiBeginTiles();
     for( int y = 0; y < 32; y++ ) {
         tileAnchor.x = anchor.x;
         for( int x = 0; x < 32; x++ ) {
-            tileRef = vram.tileMap[map].tileRef[y][x];
-            if( 1 == regs.LCDC.bgWinTileData ) {
-                tile = (Tile *)&vram.tiles[tileRef];
+            tileRef = guiDisplay.vram.tileMap[map].tileRef[y][x];
+            if( 1 == guiDisplay.regs.LCDC.bgWinTileData ) {
                 guiDrawTile2(tileAnchor, tileRef, false, false, 0, 1);
             } else {
-                tile = (Tile *)&vram.tiles[ (256+((int8_t)tileRef))*16 ];
                 guiDrawTile2(tileAnchor, (256+(int8_t)tileRef), false, false, 0, 1);
             }
             tileAnchor.x += 8;
         }
         tileAnchor.y += 8;
     }
+    guiEndTiles();
+}
 
-    if( 1 == regs.LCDC.bgWinEnable ) {
-        if( map == regs.LCDC.bgTileMap ) {
+// One quad, the shader looks up each pixel's tile and color
+static void guiDrawTileMapShader(const Vector2 anchor, const uint8_t map)
+{
+    UpdateTextureRec(tileGpu.mapTex, (Rectangle){ 0, (float)map*32, 32, 32 }, guiDisplay.vram.tileMap[map].tileRef);
+
+    float palette[4][4];
+    guiPaletteUniform(palette, guiDisplay.regs.BGP.val);
+    const int signedTileData = (0 == guiDisplay.regs.LCDC.bgWinTileData)? 1 : 0;
+
+    BeginShaderMode(tileGpu.mapShader);
+        SetShaderValueTexture(tileGpu.mapShader, tileGpu.mapAtlasLoc, tileGpu.atlasTex);
+        SetShaderValue(tileGpu.mapShader, tileGpu.mapSignedLoc, &signedTileData, SHADER_UNIFORM_INT);
+        SetShaderValueV(tileGpu.mapShader, tileGpu.mapPaletteLoc, palette, SHADER_UNIFORM_VEC4, 4);
+        DrawTexturePro(tileGpu.mapTex, (Rectangle){ 0, (float)map*32, 32, 32 }, (Rectangle){ anchor.x, anchor.y, 32*8, 32*8 },
+                        (Vector2){ 0, 0 }, 0, WHITE);
+    EndShaderMode();
+}
+
+Vector2 guiDrawDisplayTileMap(const Vector2 anchor, const uint8_t map)
+{
+    // Width x Height = 256 x 256
+    guiRegenDirtyTiles();
+    if( tileGpu.shadersValid ) {
+        guiDrawTileMapShader(anchor, map);
+    } else {
+        // without the shaders, each map is drawn a tile at a time into a cache
+        static PanelCache cache[2];
+        uint64_t key = guiTilePanelKey(guiDisplay.regs.LCDC.bgWinTileData, 0);
+        key = guiPanelHash(key, &guiDisplay.vram.tileMap[map], sizeof(guiDisplay.vram.tileMap[map]));
+        if( guiPanelCacheBegin(&cache[map], (Vector2){32*8, 32*8}, key, BLANK) ) {
+            guiDrawTileMapTiles((Vector2){ 0, 0 }, map);
+            guiPanelCacheEnd();
+        }
+        guiPanelCacheDraw(&cache[map], anchor);
+    }
+
+    // scroll and window frames on top
+
+    if( 1 == guiDisplay.regs.LCDC.bgWinEnable ) {
+        if( map == guiDisplay.regs.LCDC.bgTileMap ) {
             // draw background frame
-            guiDrawMapFrame(anchor, regs.SCX.val, regs.SCY.val, PURPLE);
+            guiDrawMapFrame(anchor, guiDisplay.regs.SCX.val, guiDisplay.regs.SCY.val, PURPLE);
         }
-        if( (1 == regs.LCDC.windowEnable)
-         && (map == regs.LCDC.windowTileMap) ) {
-            if(regs.WX.val < SCREEN_WIDTH && regs.WY.val < SCREEN_HEIGHT) {
+        if( (1 == guiDisplay.regs.LCDC.windowEnable)
+         && (map == guiDisplay.regs.LCDC.windowTileMap) ) {
+            if(guiDisplay.regs.WX.val < SCREEN_WIDTH && guiDisplay.regs.WY.val < SCREEN_HEIGHT) {
                     // draw window frame
-                if( regs.WX.val < 7 ) {
-                    DrawRectangle(anchor.x + (7-regs.WX.val), anchor.y, SCREEN_WIDTH, SCREEN_HEIGHT-regs.WY.val, ColorAlpha(BLUE,0.3));
+                if( guiDisplay.regs.WX.val < 7 ) {
+                    DrawRectangle(anchor.x + (7-guiDisplay.regs.WX.val), anchor.y, SCREEN_WIDTH, SCREEN_HEIGHT-guiDisplay.regs.WY.val, ColorAlpha(BLUE,0.3));
                 } else {
-                    DrawRectangle(anchor.x, anchor.y, SCREEN_WIDTH-(regs.WX.val-7), SCREEN_HEIGHT-regs.WY.val, ColorAlpha(BLUE,0.3));
+                    DrawRectangle(anchor.x, anchor.y, SCREEN_WIDTH-(guiDisplay.regs.WX.val-7), SCREEN_HEIGHT-guiDisplay.regs.WY.val, ColorAlpha(BLUE,0.3));
                 }
             }
         }
     }
-    return (Vector2){tileAnchor.x-anchor.x, tileAnchor.y-anchor.y};
+    return (Vector2){32*8, 32*8};
 }
 
 static Vector2 guiDrawPalette(const Vector2 anchor, const PaletteReg palette, const char *name, bool *active)
@@ -1170,17 +1397,17 @@ static Vector2 guiDrawPaletteSelector(const Vector2 viewAnchor, int *selected)
     bool active = false;
 
     active = (0 == *selected);
-    Vector2 size = guiDrawPalette(anchor, regs.BGP, "BGP", &active);
+    Vector2 size = guiDrawPalette(anchor, guiDisplay.regs.BGP, "BGP", &active);
     *selected = (active)? 0 : *selected;
 
     active = (1 == *selected);
     anchor.x += size.x + GUI_PAD;
-    size = guiDrawPalette(anchor, regs.OBP0, "OBP0", &active);
+    size = guiDrawPalette(anchor, guiDisplay.regs.OBP0, "OBP0", &active);
     *selected = (active)? 1 : *selected;
 
     active = (2 == *selected);
     anchor.x += size.x + GUI_PAD;
-    size = guiDrawPalette(anchor, regs.OBP1, "OPB1", &active);
+    size = guiDrawPalette(anchor, guiDisplay.regs.OBP1, "OPB1", &active);
     *selected = (active)? 2 : *selected;
 
     anchor.x += size.x;
@@ -1188,11 +1415,35 @@ static Vector2 guiDrawPaletteSelector(const Vector2 viewAnchor, int *selected)
     return (Vector2){anchor.x - viewAnchor.x, size.y};
 }
 
+static void guiDrawTileDataTiles(const Vector2 anchor, const int selectedPalette)
+{
+    uint16_t index = 0;
+    Vector2 tileAnchor = anchor;
+    if(0 != selectedPalette) {
+        // object color 0 is transparent, show the background behind every tile first
+        for( int y = 0; y < 24; y++ ) {
+            for( int x = 0; x < 16; x++ ) {
+                DrawRectangleV((Vector2){anchor.x + x*(2*8+1), anchor.y + y*(2*8+1)}, (Vector2){2*8,2*8}, paletteColor[guiDisplay.regs.BGP.palCol0]);
+            }
+        }
+    }
+    guiBeginTiles();
+    for( int y = 0; y < 24; y++ ) {
+        tileAnchor.x = anchor.x;
+        for( int x = 0; x < 16; x++ ) {
+            guiDrawTile2(tileAnchor, index, false, false, selectedPalette, 2);
+            index++;
+            tileAnchor.x += 2*8+1;
+        }
+        tileAnchor.y += 2*8+1;
+    }
+    guiEndTiles();
+}
+
 Vector2 guiDrawDisplayTileData(const Vector2 anchor)
 {
     // Width x Height = 18*17 x 25*17 = 306 x 425
 
-    uint16_t index = 0;
     Vector2 tileAnchor = anchor;
 
     guiRegenDirtyTiles();
@@ -1202,6 +1453,15 @@ Vector2 guiDrawDisplayTileData(const Vector2 anchor)
     static int selectedPalette = 0;
     guiDrawPaletteSelector((Vector2){anchor.x+FONTWIDTH*3, anchor.y+FONTSIZE+24*(2*8+1)}, &selectedPalette);
 
+    // The tiles themselves only change with VRAM or the palettes
+    static PanelCache cache;
+    const uint64_t key = guiTilePanelKey(selectedPalette, 0);
+    if( guiPanelCacheBegin(&cache, (Vector2){16*(2*8+1), 24*(2*8+1)}, key, BLANK) ) {
+        guiDrawTileDataTiles((Vector2){ 0, 0 }, selectedPalette);
+        guiPanelCacheEnd();
+    }
+    guiPanelCacheDraw(&cache, (Vector2){ anchor.x + FONTWIDTH*2, anchor.y + FONTSIZE });
+
     // Draw offsets across the top
     tileAnchor.x += 4 + FONTWIDTH*2;
     for( int x = 0; x < 16; x++ ) {
@@ -1209,7 +1469,7 @@ Vector2 guiDrawDisplayTileData(const Vector2 anchor)
         tileAnchor.x += 2*8+1;
     }
 
-    // Draw Tile Map itself
+    // Draw the row indexes either side of the tiles
     tileAnchor = (Vector2){ anchor.x, anchor.y + FONTSIZE };
     for( int y = 0; y < 24; y++ ) {
         tileAnchor.x = anchor.x;
@@ -1217,24 +1477,15 @@ Vector2 guiDrawDisplayTileData(const Vector2 anchor)
         // Draw indexes for selected BG/Win tile data
         // The s
         if( y < 8 ) {
-            if (1 == regs.LCDC.bgWinTileData) {
+            if (1 == guiDisplay.regs.LCDC.bgWinTileData) {
                 DrawTextEx(firaFont, TextFormat("%X0",y), tileAnchor, FONTSIZE, 0, lineColor);
             }
         } else if( y < 16 ) {
             DrawTextEx(firaFont, TextFormat("%X0",y), tileAnchor, FONTSIZE, 0, lineColor);
-        } else if( 0 == regs.LCDC.bgWinTileData ) {
+        } else if( 0 == guiDisplay.regs.LCDC.bgWinTileData ) {
             DrawTextEx(firaFont, TextFormat("%X0",y-16), tileAnchor, FONTSIZE, 0, lineColor);
         }
-        tileAnchor.x += FONTWIDTH*2;
-
-        for( int x = 0; x < 16; x++ ) {
-            if(0 != selectedPalette) {
-                DrawRectangleV(tileAnchor, (Vector2){2*8,2*8}, paletteColor[regs.BGP.palCol0]);
-            }
-            guiDrawTile2(tileAnchor, index, false, false, selectedPalette, 2);
-            index++;
-            tileAnchor.x += 2*8+1;
-        }
+        tileAnchor.x += FONTWIDTH*2 + 16*(2*8+1);   // past the cached tiles
 
         // Draw indexes for Obj tiles
         if( y < 16 ) {
@@ -1245,27 +1496,82 @@ Vector2 guiDrawDisplayTileData(const Vector2 anchor)
     return (Vector2){(tileAnchor.x+FONTWIDTH*2)-anchor.x, tileAnchor.y-anchor.y+32};
 }
 
+// Called by the emulation thread when a frame is finished
+void displayPublishFrame(void)
+{
+    ScreenFrame * const frame = &screenFrames[writeFrame];
+    frame->displayEnabled = (1 == regs.LCDC.displayEnable);
+    for( int y = 0; y < SCREEN_HEIGHT; y++ ) {
+        for( int x = 0; x < SCREEN_WIDTH; x++ ) {
+            frame->pixels[y][x] = (uint8_t)screenData[y][x];
+        }
+    }
+    writeFrame = __atomic_exchange_n(&latestFrame, writeFrame | FRAME_FRESH, __ATOMIC_ACQ_REL) & ~FRAME_FRESH;
+}
+
+// Called by the GUI thread, returns the newest published frame.  The same frame is
+//  returned again until a newer one is published.
+static const ScreenFrame *displayAcquireFrame(void)
+{
+    if( 0 != (__atomic_load_n(&latestFrame, __ATOMIC_ACQUIRE) & FRAME_FRESH) ) {
+        readFrame = __atomic_exchange_n(&latestFrame, readFrame, __ATOMIC_ACQ_REL) & ~FRAME_FRESH;
+    }
+    return &screenFrames[readFrame];
+}
+
 Vector2 guiDrawDisplayScreen(const Vector2 anchor)
 {
+    const ScreenFrame * const frame = displayAcquireFrame();
     DrawRectangleV(anchor, (Vector2){ SCREEN_WIDTH*3, SCREEN_HEIGHT*3 }, ColorAlpha(screenPaletteColor[0], 0.7));
-    if(1 == regs.LCDC.displayEnable) {
+    if( frame->displayEnabled ) {
         //DrawRectangleV(anchor, (Vector2){ 160*3, 144*3 }, screenPaletteColor[0]);
         Rectangle pixelRect = { anchor.x, anchor.y, 2.6, 2.6 };
         for( int y = 0; y < SCREEN_HEIGHT; y++ ) {
             pixelRect.x = anchor.x;
             for( int x = 0; x < SCREEN_WIDTH; x++ ) {
-                int palColor = screenData[y][x];
+                int palColor = frame->pixels[y][x];
                 DrawRectangleRec(pixelRect, screenPaletteColor[palColor]);
                 pixelRect.x += 2+1;
             }
             pixelRect.y += 2+1;
         }
     }
-    guiUpdateScreen = false;
 
     return (Vector2){SCREEN_WIDTH*3, SCREEN_HEIGHT*3};
 }
 
+static inline uint64_t rotl64(const uint64_t value, const int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// 64-bit hash of what's on the screen, for the frame hash regression tests.  Four independent
+//  lanes keep the multiplies from serializing on each other, and let the compiler vectorize
+//  the loop on targets with 64-bit vector multiplies.
+uint64_t displayScreenHash(void)
+{
+    if( 0 == regs.LCDC.displayEnable ) {
+        return 0;   // nothing shown, whatever's left in screenData
+    }
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    uint64_t lanes[4] = { prime1, prime2, ~prime1, ~prime2 };
+    const uint8_t *bytes = (const uint8_t *)screenData;
+    static_assert(0 == (sizeof(screenData) % 32), "screen must be whole 32 byte blocks");
+    for(size_t offset = 0; offset < sizeof(screenData); offset += 32) {
+        for(int lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            memcpy(&word, &bytes[offset + lane*8], sizeof(word));
+            lanes[lane] = rotl64(lanes[lane] + word * prime2, 31) * prime1;
+        }
+    }
+    uint64_t hash = rotl64(lanes[0], 1) + rotl64(lanes[1], 7) + rotl64(lanes[2], 12) + rotl64(lanes[3], 18);
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
 
 Vector2 guiDrawDisplay(const Vector2 viewAnchor)
 {
@@ -1332,12 +1638,8 @@ void displayInit(void)
     vramImage.contents = vram.contents;
     addRamView(&vramImage, "VRAM", 0x8000);
     guiUpdateScreen = false;
-    memset(&tileTextures, 0, sizeof(tileTextures));
-    // setup initial blank tile textures
-    for(int i=0; i<384; i++) {
-        tileTextures[i].image = GenImageColor(8*3, 8, BLANK);
-        tileTextures[i].tex = LoadTextureFromImage(tileTextures[i].image);
-    }
+    // decoded into the atlas the next time a tile panel is drawn
+    memset(tileDirty, true, sizeof(tileDirty));
     memset(screenData, 0, sizeof(screenData));
     bgFetch.reset(true, false);
     objFetch.reset(true);
@@ -1349,6 +1651,26 @@ void displayInit(void)
 
     addRegView(&displayRegView, "DISP");
     addRegView(&oamRegView, "OAM");
+
+    ADD_REWIND_STATE(vram);
+    ADD_REWIND_STATE(regs);
+    ADD_REWIND_STATE(oamRam);
+    ADD_REWIND_STATE(oamDmaOffset);
+    ADD_REWIND_STATE(oamDmaStart);
+    ADD_REWIND_STATE(frameCounter);
+    ADD_REWIND_STATE(scanlineCounter);
+    ADD_REWIND_STATE(totalFrames);
+    ADD_REWIND_STATE(activeStatFlags);
+    ADD_REWIND_STATE(bgFetch);
+    ADD_REWIND_STATE(objFetch);
+    ADD_REWIND_STATE(scanlineObjects);
+    ADD_REWIND_STATE(ppu);
+}
+
+// VRAM was put back without going through setVram8
+void displayStateRestored(void)
+{
+    memset(tileDirty, true, sizeof(tileDirty));
 }
 
 void displayDeinit(void)
@@ -23,7 +23,10 @@ extern "C" {
 #define GBCOL_DARKGRAY  (2)
 #define GBCOL_BLACK     (3)
 
+#define LCD_FRAME_DOTS  (70224)    // 154 scanlines of 456 dots
+
 extern bool guiUpdateScreen;
+extern bool displaySkipFrame;   // the frame being drawn won't be shown, don't bother writing screenData
 
 void setGfxReg8(uint16_t addr, uint8_t val8);
 uint8_t getGfxReg8(uint16_t addr);
@@ -41,15 +44,20 @@ uint8_t getOam8(uint16_t addr);
 
 void displayInit(void);
 void displayDeinit(void);
+void displayStateRestored(void);
 
 
 
+void guiSnapshotDisplay(void);
 Vector2 guiDrawDisplayObjects(const Vector2 anchor);
 Vector2 guiDrawDisplayTileMap(const Vector2 anchor, const uint8_t map);
 Vector2 guiDrawDisplayTileData(const Vector2 anchor);
+void displayPublishFrame(void);
 Vector2 guiDrawDisplayScreen(const Vector2 anchor);
 Vector2 guiDrawDisplay(const Vector2 anchor);
 
+uint64_t displayScreenHash(void);
+
 
 #ifdef __cplusplus
 }
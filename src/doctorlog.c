@@ -0,0 +1,143 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "doctorlog.h"
+#ifdef GAMEGIRL_ZSTD
+#include <zstd.h>
+#endif
+
+// Gameboy-Doctor log output
+//
+// Records are formatted (or, for binary logs, just copied) into one large buffer that's
+//  written out only when it fills, so logging costs a few stores per instruction rather
+//  than an fprintf.  With zstd the buffer is compressed on its way to the file.
+
+#define DOCTOR_LOG_BUFFER_SIZE  (4*1024*1024)
+#define DOCTOR_LOG_ZSTD_LEVEL   (3)
+
+bool doctorLogEnabled = false;
+
+static struct {
+    FILE *file;
+    DoctorLogFormat format;
+    uint8_t *buffer;
+    size_t used;
+    uint64_t records;
+#ifdef GAMEGIRL_ZSTD
+    ZSTD_CCtx *zstd;
+    uint8_t *zstdOut;
+    size_t zstdOutSize;
+#endif
+} doctorLog;
+
+static bool isZstdFilename(const char * const filename)
+{
+    const size_t length = strlen(filename);
+    return (4 <= length) && (0 == strcmp(".zst", &filename[length-4]));
+}
+
+#ifdef GAMEGIRL_ZSTD
+static void doctorLogCompress(const ZSTD_EndDirective mode)
+{
+    ZSTD_inBuffer in = { doctorLog.buffer, doctorLog.used, 0 };
+    size_t remaining;
+    do {
+        ZSTD_outBuffer out = { doctorLog.zstdOut, doctorLog.zstdOutSize, 0 };
+        remaining = ZSTD_compressStream2(doctorLog.zstd, &out, &in, mode);
+        if( ZSTD_isError(remaining) ) {
+            printf("Error compressing doctor log: %s\n", ZSTD_getErrorName(remaining));
+            return;
+        }
+        fwrite(doctorLog.zstdOut, 1, out.pos, doctorLog.file);
+    } while( (ZSTD_e_end == mode)? (0 != remaining) : (in.pos < in.size) );
+}
+#endif
+
+static void doctorLogFlush(void)
+{
+#ifdef GAMEGIRL_ZSTD
+    if( NULL != doctorLog.zstd ) {
+        doctorLogCompress(ZSTD_e_continue);
+        doctorLog.used = 0;
+        return;
+    }
+#endif
+    fwrite(doctorLog.buffer, 1, doctorLog.used, doctorLog.file);
+    doctorLog.used = 0;
+}
+
+Status doctorLogOpen(const char * const filename, const DoctorLogFormat format)
+{
+    doctorLogClose();
+    memset(&doctorLog, 0, sizeof(doctorLog));
+#ifndef GAMEGIRL_ZSTD
+    if( isZstdFilename(filename) ) {
+        printf("Compressed doctor logs need a zstd build (premake5 --zstd)\n");
+        return FAILURE;
+    }
+#endif
+    doctorLog.file = fopen(filename, "wb");
+    if( NULL == doctorLog.file ) {
+        printf("Error opening debug log file '%s'\n", filename);
+        return FAILURE;
+    }
+    doctorLog.format = format;
+    doctorLog.buffer = (uint8_t *)MemAlloc(DOCTOR_LOG_BUFFER_SIZE);
+#ifdef GAMEGIRL_ZSTD
+    if( isZstdFilename(filename) ) {
+        doctorLog.zstd = ZSTD_createCCtx();
+        ZSTD_CCtx_setParameter(doctorLog.zstd, ZSTD_c_compressionLevel, DOCTOR_LOG_ZSTD_LEVEL);
+        doctorLog.zstdOutSize = ZSTD_CStreamOutSize();
+        doctorLog.zstdOut = (uint8_t *)MemAlloc(doctorLog.zstdOutSize);
+    }
+#endif
+
+    if( DOCTOR_LOG_BINARY == format ) {
+        DoctorLogHeader header;
+        doctorLogHeaderInit(&header);
+        memcpy(doctorLog.buffer, &header, sizeof(header));
+        doctorLog.used = sizeof(header);
+    }
+    doctorLogEnabled = true;
+    return SUCCESS;
+}
+
+void doctorLogClose(void)
+{
+    if( !doctorLogEnabled ) {
+        return;
+    }
+#ifdef GAMEGIRL_ZSTD
+    if( NULL != doctorLog.zstd ) {
+        doctorLogCompress(ZSTD_e_end);
+        ZSTD_freeCCtx(doctorLog.zstd);
+        MemFree(doctorLog.zstdOut);
+        doctorLog.zstd = NULL;
+        doctorLog.used = 0;
+    }
+#endif
+    doctorLogFlush();   // whatever's left of an uncompressed log
+    fclose(doctorLog.file);
+    MemFree(doctorLog.buffer);
+    printf("Doctor log closed after %llu instructions\n", (unsigned long long)doctorLog.records);
+    doctorLogEnabled = false;
+}
+
+void doctorLogWrite(const DoctorLogRecord * const record)
+{
+    if( (DOCTOR_LOG_BUFFER_SIZE - DOCTOR_LOG_LINE_LENGTH) < doctorLog.used ) {
+        doctorLogFlush();
+    }
+    if( DOCTOR_LOG_BINARY == doctorLog.format ) {
+        memcpy(&doctorLog.buffer[doctorLog.used], record, sizeof(*record));
+        doctorLog.used += sizeof(*record);
+    } else {
+        doctorLogFormatLine(record, (char *)&doctorLog.buffer[doctorLog.used]);
+        doctorLog.used += DOCTOR_LOG_LINE_LENGTH;
+    }
+    doctorLog.records++;
+}
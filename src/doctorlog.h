@@ -0,0 +1,34 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __DOCTORLOG_H__
+#define __DOCTORLOG_H__
+
+#include "gb_types.h"
+#include "doctorlog_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    DOCTOR_LOG_TEXT,        // Gameboy-Doctor's own format
+    DOCTOR_LOG_BINARY,      // DoctorLogRecords, tools/doctorlog converts them to text
+} DoctorLogFormat;
+
+// Also makes LY read as 0x90, which is what Gameboy-Doctor expects
+extern bool doctorLogEnabled;
+
+// Filenames ending in .zst are compressed as they're written (zstd builds only)
+Status doctorLogOpen(const char * const filename, const DoctorLogFormat format);
+void doctorLogClose(void);
+void doctorLogWrite(const DoctorLogRecord * const record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__DOCTORLOG_H__
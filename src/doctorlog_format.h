@@ -0,0 +1,142 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __DOCTORLOG_FORMAT_H__
+#define __DOCTORLOG_FORMAT_H__
+
+// Gameboy-Doctor log records, shared between the emulator and the tools/ programs,
+//  so nothing in here may depend on raylib or the rest of the emulator.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary logs are a header followed by one fixed size record per instruction.
+//  Every field is a byte, so there's no padding or byte order to worry about.
+#define DOCTOR_LOG_MAGIC        "GBDOCLOG"
+#define DOCTOR_LOG_VERSION      (1)
+
+typedef struct {
+    char magic[8];
+    uint8_t version;
+    uint8_t recordSize;
+    uint8_t reserved[6];
+} DoctorLogHeader;
+
+typedef struct {
+    uint8_t A, F, B, C, D, E, H, L;
+    uint8_t SP[2];          // little endian
+    uint8_t PC[2];          // little endian
+    uint8_t PCMEM[4];
+} DoctorLogRecord;
+
+// A:00 F:11 B:22 C:33 D:44 E:55 H:66 L:77 SP:8888 PC:9999 PCMEM:AA,BB,CC,DD\n
+#define DOCTOR_LOG_LINE_LENGTH  (74)
+
+static inline void doctorLogHeaderInit(DoctorLogHeader * const header)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, DOCTOR_LOG_MAGIC, sizeof(header->magic));
+    header->version = DOCTOR_LOG_VERSION;
+    header->recordSize = sizeof(DoctorLogRecord);
+}
+
+static inline bool doctorLogHeaderValid(const DoctorLogHeader * const header)
+{
+    return (0 == memcmp(header->magic, DOCTOR_LOG_MAGIC, sizeof(header->magic)))
+            && (DOCTOR_LOG_VERSION == header->version) && (sizeof(DoctorLogRecord) == header->recordSize);
+}
+
+static inline char *doctorLogHex(char *out, const uint8_t value)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    out[0] = digits[value >> 4];
+    out[1] = digits[value & 0xF];
+    return out + 2;
+}
+
+static inline char *doctorLogField(char *out, const char name, const uint8_t value)
+{
+    out[0] = name;
+    out[1] = ':';
+    out = doctorLogHex(out + 2, value);
+    *out = ' ';
+    return out + 1;
+}
+
+// Formats one record as a Gameboy-Doctor text line, exactly DOCTOR_LOG_LINE_LENGTH
+//  characters including the newline, without a terminator
+static inline void doctorLogFormatLine(const DoctorLogRecord * const record, char * const line)
+{
+    char *out = line;
+    out = doctorLogField(out, 'A', record->A);
+    out = doctorLogField(out, 'F', record->F);
+    out = doctorLogField(out, 'B', record->B);
+    out = doctorLogField(out, 'C', record->C);
+    out = doctorLogField(out, 'D', record->D);
+    out = doctorLogField(out, 'E', record->E);
+    out = doctorLogField(out, 'H', record->H);
+    out = doctorLogField(out, 'L', record->L);
+    memcpy(out, "SP:", 3);
+    out = doctorLogHex(out + 3, record->SP[1]);
+    out = doctorLogHex(out, record->SP[0]);
+    memcpy(out, " PC:", 4);
+    out = doctorLogHex(out + 4, record->PC[1]);
+    out = doctorLogHex(out, record->PC[0]);
+    memcpy(out, " PCMEM:", 7);
+    out += 7;
+    for(int index = 0; index < 4; index++) {
+        out = doctorLogHex(out, record->PCMEM[index]);
+        *out++ = (3 == index)? '\n' : ',';
+    }
+}
+
+static inline int doctorLogHexValue(const char c)
+{
+    if( ('0' <= c) && ('9' >= c) ) {
+        return c - '0';
+    } else if( ('A' <= c) && ('F' >= c) ) {
+        return c - 'A' + 10;
+    } else if( ('a' <= c) && ('f' >= c) ) {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static inline bool doctorLogParseHex(const char * const text, uint8_t * const value)
+{
+    const int high = doctorLogHexValue(text[0]);
+    const int low = doctorLogHexValue(text[1]);
+    *value = (uint8_t)((high << 4) | low);
+    return (0 <= high) && (0 <= low);
+}
+
+// Parses one Gameboy-Doctor text line (see doctorLogFormatLine), fields are expected at
+//  their fixed positions.  Returns false if the line isn't in that exact format.
+static inline bool doctorLogParseLine(const char * const line, DoctorLogRecord * const record)
+{
+    uint8_t * const regs = &record->A;  // A through L are consecutive bytes
+    bool valid = ('\n' == line[DOCTOR_LOG_LINE_LENGTH-1]);
+    for(int index = 0; index < 8; index++) {
+        valid = valid && doctorLogParseHex(&line[index*5 + 2], &regs[index]);
+    }
+    valid = valid && doctorLogParseHex(&line[43], &record->SP[1]) && doctorLogParseHex(&line[45], &record->SP[0]);
+    valid = valid && doctorLogParseHex(&line[51], &record->PC[1]) && doctorLogParseHex(&line[53], &record->PC[0]);
+    for(int index = 0; index < 4; index++) {
+        valid = valid && doctorLogParseHex(&line[62 + index*3], &record->PCMEM[index]);
+    }
+    return valid;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__DOCTORLOG_FORMAT_H__
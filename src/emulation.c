@@ -0,0 +1,260 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "gui.h"
+#include "emulation.h"
+#include "instrument.h"
+#include "trace.h"
+#include "rewind.h"
+#include "history.h"
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+// Emulation thread
+//
+// The machine runs on its own thread, paced to the Game Boy's ~59.73Hz frame rate instead of
+//  the display's.  Finished frames go to the GUI through a triple buffer (displayPublishFrame)
+//  and input comes back as one atomic ControlState, so presenting and polling never wait on
+//  emulation, and a slow GUI frame doesn't cost the emulator a frame.
+//
+// Everything else the debug panels look at is only touched with the emulation lock held.
+//  The emulation thread holds it for a frame at a time and the GUI only long enough to copy
+//  what the panels show (the guiSnapshot* functions), so they always see the machine as it was
+//  between two frames (or two steps) and drawing them never holds up emulation.
+//
+// Fast-forward shortens the frame period by fastForwardSpeed (or drops pacing entirely for
+//  unlimited) and only presents every Nth frame, roughly the display rate.  The PPU is told
+//  in advance about the frames in between so it can skip writing their pixels.
+
+#define EMULATION_FRAME_NS      ((uint64_t)LCD_FRAME_DOTS * 1000000000ULL / MAIN_CLOCK_HZ)
+#define EMULATION_MAX_LAG_NS    (4 * EMULATION_FRAME_NS)   // beyond this, stop trying to catch up
+
+bool takeStep = false;
+bool takeBigStep = false;
+int bigStepCount = 0;
+bool takeReverseStep = false;
+bool takeReverseContinue = false;
+int fastForwardSpeed = EMULATION_DEFAULT_FAST_FORWARD;
+
+static struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool started;
+    bool quit;          // under the lock
+    bool guiWaiting;    // atomic, the GUI wants the lock
+    bool exited;        // atomic, stopped on a breakpoint with exitOnBreak
+    bool fastForward;   // atomic
+    uint8_t controls;   // atomic, ControlState.val
+    uint32_t skipped;   // frames since the last one presented
+    uint64_t nextPresentNs;
+} emulation = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+};
+
+static uint64_t emulationNowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Sleeps until the next frame is due.  After a stall (the window being dragged, a slow
+//  debug panel) it starts over from now rather than racing through the missed frames.
+static void emulationPace(uint64_t * const deadline)
+{
+    const uint64_t now = emulationNowNs();
+    if( emulationFastForwarding() ) {
+        if( 0 == fastForwardSpeed ) {
+            *deadline = now;    // unlimited
+            return;
+        }
+        *deadline += EMULATION_FRAME_NS / fastForwardSpeed;
+    } else {
+        *deadline += EMULATION_FRAME_NS;
+    }
+    if( (*deadline + EMULATION_MAX_LAG_NS) < now ) {
+        *deadline = now;
+    } else if( *deadline > now ) {
+        const uint64_t wait = *deadline - now;
+        const struct timespec pause = { (time_t)(wait / 1000000000ULL), (long)(wait % 1000000000ULL) };
+        nanosleep(&pause, NULL);
+    }
+}
+
+// Decides before a frame is drawn whether it will be presented
+static bool emulationPresentNext(void)
+{
+    if( !emulationFastForwarding() ) {
+        emulation.skipped = 0;
+        return true;
+    }
+    if( 0 < fastForwardSpeed ) {
+        // every Nth frame
+        if( ++emulation.skipped < (uint32_t)fastForwardSpeed ) {
+            return false;
+        }
+    } else {
+        // unlimited, about as often as the display refreshes
+        const uint64_t now = emulationNowNs();
+        if( now < emulation.nextPresentNs ) {
+            return false;
+        }
+        emulation.nextPresentNs = now + EMULATION_FRAME_NS;
+    }
+    emulation.skipped = 0;
+    return true;
+}
+
+// Runs whatever the GUI asked for, with the lock held.  Returns true if a frame was finished.
+//  Breakpoints are checked inside executeInstruction (see breakpoints.c), not by address here,
+//  and going backwards is up to rewind.c.
+static bool emulationRunFrame(void)
+{
+    rewindBeginFrame();
+    ControlState controls;
+    controls.val = __atomic_load_n(&emulation.controls, __ATOMIC_ACQUIRE);
+    updateControls(controls);
+
+    bool present = true;
+    displaySkipFrame = false;
+
+    if( takeReverseStep ) {
+        rewindStep();
+        running = false;
+        takeReverseStep = false;
+    } else if( takeReverseContinue ) {
+        rewindContinue();
+        running = false;
+        takeReverseContinue = false;
+    } else if( takeStep ) {
+        executeInstruction();
+        running = false;
+        takeStep = false;
+    } else if( takeBigStep ) {
+        for( int i=0; i<bigStepCount; i++) {
+            executeInstruction();
+        }
+        running = false;
+        takeBigStep = false;
+    } else if ( running ) {
+        present = emulationPresentNext();
+        displaySkipFrame = !present;
+        while( !guiUpdateScreen ) {
+            if( executeInstruction() ) {
+                running = false;
+                historyBreak();
+                if( exitOnBreak ) {
+                    __atomic_store_n(&emulation.exited, true, __ATOMIC_RELEASE);
+                }
+                break;
+            }
+        }
+    }
+    rewindCheckpoint();
+
+    if( guiUpdateScreen ) {
+        guiUpdateScreen = false;
+        if( present ) {
+            displayPublishFrame();
+        }
+        return true;
+    }
+    return false;
+}
+
+static void *emulationThread(void *arg)
+{
+    uint64_t deadline = emulationNowNs();
+    pthread_mutex_lock(&emulation.lock);
+    while( !emulation.quit ) {
+        if( !running && !takeStep && !takeBigStep && !takeReverseStep && !takeReverseContinue ) {
+            pthread_cond_wait(&emulation.wake, &emulation.lock);
+            deadline = emulationNowNs();
+            continue;
+        }
+
+        TRACE_BEGIN(TRACE_TRACK_HOST_EMULATION, "emulate", -1);
+        INSTRUMENT_BEGIN(INSTR_EMULATE);
+        const bool paced = emulationRunFrame() && running;
+        INSTRUMENT_END(INSTR_EMULATE);
+        TRACE_END(TRACE_TRACK_HOST_EMULATION);
+        pthread_mutex_unlock(&emulation.lock);
+
+        // mutexes aren't fair, make sure a waiting GUI gets in between frames
+        while( __atomic_load_n(&emulation.guiWaiting, __ATOMIC_ACQUIRE) ) {
+            sched_yield();
+        }
+        if( paced ) {
+            emulationPace(&deadline);
+        }
+        pthread_mutex_lock(&emulation.lock);
+    }
+    pthread_mutex_unlock(&emulation.lock);
+    return NULL;
+}
+
+Status emulationStart(void)
+{
+    emulation.quit = false;
+    emulation.exited = false;
+    if( 0 != pthread_create(&emulation.thread, NULL, emulationThread, NULL) ) {
+        printf("Unable to start the emulation thread\n");
+        return FAILURE;
+    }
+    emulation.started = true;
+    return SUCCESS;
+}
+
+void emulationStop(void)
+{
+    if( !emulation.started ) {
+        return;
+    }
+    pthread_mutex_lock(&emulation.lock);
+    emulation.quit = true;
+    pthread_cond_signal(&emulation.wake);
+    pthread_mutex_unlock(&emulation.lock);
+    pthread_join(emulation.thread, NULL);
+    emulation.started = false;
+}
+
+void emulationLock(void)
+{
+    __atomic_store_n(&emulation.guiWaiting, true, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&emulation.lock);
+    __atomic_store_n(&emulation.guiWaiting, false, __ATOMIC_RELEASE);
+}
+
+// Wakes the emulation thread too, in case the GUI just asked it to run or step
+void emulationUnlock(void)
+{
+    pthread_cond_signal(&emulation.wake);
+    pthread_mutex_unlock(&emulation.lock);
+}
+
+void emulationSetControls(const ControlState controls)
+{
+    __atomic_store_n(&emulation.controls, controls.val, __ATOMIC_RELEASE);
+}
+
+void emulationSetFastForward(const bool enable)
+{
+    __atomic_store_n(&emulation.fastForward, enable, __ATOMIC_RELEASE);
+}
+
+bool emulationFastForwarding(void)
+{
+    return __atomic_load_n(&emulation.fastForward, __ATOMIC_ACQUIRE);
+}
+
+bool emulationExited(void)
+{
+    return __atomic_load_n(&emulation.exited, __ATOMIC_ACQUIRE);
+}
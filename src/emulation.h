@@ -0,0 +1,45 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __EMULATION_H__
+#define __EMULATION_H__
+
+#include "gb_types.h"
+#include "controls.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EMULATION_DEFAULT_FAST_FORWARD  (4)
+
+// Frame rate multiplier while fast-forwarding, 0 for unlimited
+extern int fastForwardSpeed;
+
+// Step requests from the GUI, only touched with the emulation lock held (as is running)
+extern bool takeStep;
+extern bool takeBigStep;
+extern int bigStepCount;
+extern bool takeReverseStep;
+extern bool takeReverseContinue;
+
+Status emulationStart(void);
+void emulationStop(void);
+
+// The GUI holds the lock while it copies or changes machine state, see emulation.c
+void emulationLock(void);
+void emulationUnlock(void);
+
+void emulationSetControls(const ControlState controls);
+void emulationSetFastForward(const bool enable);
+bool emulationFastForwarding(void);
+bool emulationExited(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__EMULATION_H__
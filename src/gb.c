@@ -5,8 +5,25 @@
 // Copyright (c) 2025 Haley Taylor (@truehaley)
 
 #include "gb.h"
-
-unsigned int mainClock = 0;
+#include "instrument.h"
+#include "breakpoints.h"
+#include "rewind.h"
+#include "history.h"
+
+uint64_t mainClock = 0;
+
+bool serialConsole = false;
+bool exitOnBreak = false;
+bool running = false;
+bool mooneye = false;
+bool fastBoot = false;
+bool verifyRomChecksum = false;
+bool headless = false;
+#ifdef GAMEGIRL_BENCH
+BusWriteHook *busWriteHook = NULL;
+#endif
+uint32_t memPageGeneration[256];
+uint32_t memMapGeneration = 0;
 
 RomImage bootrom;
 bool bootRomActive = true;
@@ -19,15 +36,17 @@ RamImage hram;
 void gbInit(const char * const cartFilename)
 {
     mainClock = 0;
+    bootRomActive = true;
 
     memInit();
+    rewindInit();
 
     printf("Loading Boot ROM...");
-    if(SUCCESS != loadRom(&bootrom, "Resources/ROMs/DMG_ROM.bin", BOOTROM_ENTRY)) {
+    if(SUCCESS != loadRom(&bootrom, "resources/ROMs/DMG_ROM.bin", BOOTROM_ENTRY)) {
         printf("ERROR\n");
         exit(1);
     }
-    //preprocessRom(&bootrom, BOOTROM_ENTRY);
+    analyzeRomAsync(&bootrom);
     addRomView(&bootrom, "BOOT", 0x0000);
     printf("SUCCESS\n");
 
@@ -46,6 +65,11 @@ void gbInit(const char * const cartFilename)
     addRamView(&wram, "WRAM", 0xC000);
     allocateRam(&hram, 0x80);
     addRamView(&hram, "HRAM", 0xFF80);
+
+    ADD_REWIND_STATE(mainClock);
+    ADD_REWIND_STATE(bootRomActive);
+    addRewindState(wram.contents, wram.size);
+    addRewindState(hram.contents, hram.size);
 }
 
 void gbDeinit(void)
@@ -53,16 +77,26 @@ void gbDeinit(void)
     unloadRom(&bootrom);
     unloadCartridge();
     deallocateRam(&wram);
+    deallocateRam(&hram);
     displayDeinit();
     audioDeinit();
+    rewindDeinit();
+    historyDeinit();
 }
 
 void cpuCycle(void)
 {
+    INSTRUMENT_BEGIN(INSTR_TIMER);
     timerTick();
+    INSTRUMENT_END(INSTR_TIMER);
     mainClock += MAIN_CLOCKS_PER_CPU_CYCLE;
+    INSTRUMENT_BEGIN(INSTR_PPU);
     ppuCycles(MAIN_CLOCKS_PER_CPU_CYCLE);
+    INSTRUMENT_END(INSTR_PPU);
+    INSTRUMENT_BEGIN(INSTR_OAM_DMA);
     oamDmaCycle();
+    INSTRUMENT_END(INSTR_OAM_DMA);
+    INSTRUMENT_COUNT(INSTR_COUNT_CPU_CYCLES, 1);
 }
 
 void cpuCycles(int cycles)
@@ -226,9 +260,9 @@ uint8_t getRawMem8(uint16_t addr)
     if(addr < 0x00100 && bootRomActive) {
         return bootrom.contents[addr];
 
-    } else if( addr < 0x7FFF ) {
-        // ROM Bank 0-n
-        return getCartRom8(addr&0x7FFF);
+    } else if( addr <= 0x7FFF ) {
+        // ROM Bank 0-n, straight from whichever banks the mapper currently has selected
+        return cartRomBank[addr >> 14][addr & 0x3FFF];
 
     } else if( addr >= 0x8000 && addr <= 0x9FFF) {
         // VRAM
@@ -288,9 +322,11 @@ uint8_t getMem8(uint16_t addr)
 
 void setRawMem8(uint16_t addr, uint8_t val8)
 {
+    memPageGeneration[addr >> 8]++;
     if( addr <= 0x7FFF ) {
         // ROM Bank 0-n
         setCartRom8(addr & 0x7FFF, val8);
+        memMapGeneration++;     // possibly a bank switch
     } else if( addr >= 0x8000 && addr <= 0x9FFF) {
         // VRAM
         setVram8(addr&0x1FFF, val8);
@@ -302,10 +338,12 @@ void setRawMem8(uint16_t addr, uint8_t val8)
     } else if( addr >= 0xC000 && addr <= 0xDFFF) {
         // WORK RAM
         wram.contents[addr&0x1FFF] = val8;
+        memPageGeneration[(addr >> 8) + 0x20]++;   // and its echo
 
     } else if( addr >= 0xE000 && addr <= 0xFDFF ) {
         // ECHO RAM
         wram.contents[addr&0x1FFF] = val8;
+        memPageGeneration[(addr >> 8) - 0x20]++;
 
     } else if( addr >= 0xFE00 && addr <= 0xFE9F ) {
         // OAM
@@ -319,6 +357,7 @@ void setRawMem8(uint16_t addr, uint8_t val8)
         // IO Regs
         if( 0xFF50 == addr ) {
             bootRomActive = (0 == val8);
+            memMapGeneration++;
         } else if( addr <= 0xFF77 ) {
             if( NULL != ioRegDispatch[addr & 0x00FF].setIo8 ) {
                 ioRegDispatch[addr & 0x00FF].setIo8(addr, val8);
@@ -344,12 +383,19 @@ void setMem8(uint16_t addr, uint8_t val8)
 uint8_t readMem8(uint16_t addr)
 {
     uint8_t val8 = getMem8(addr);
+    BREAK_ACCESS(addr, val8, BREAK_READ);
     cpuCycle();
     return val8;
 }
 
 void writeMem8(uint16_t addr, uint8_t val8)
 {
+#ifdef GAMEGIRL_BENCH
+    if( NULL != busWriteHook ) {
+        busWriteHook(addr, val8);
+    }
+#endif
+    BREAK_ACCESS(addr, val8, BREAK_WRITE);
     setMem8(addr, val8);
     cpuCycle();
 }
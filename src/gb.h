@@ -33,12 +33,14 @@
 extern "C" {
 #endif
 
-extern FILE *doctorLogFile;
 extern bool serialConsole;
 extern bool exitOnBreak;
 extern bool running;
 extern bool fastBoot;
 extern bool mooneye;
+extern bool verifyRomChecksum;
+extern bool headless;       // no window, nothing may touch the GPU
+extern uint64_t mainClock;
 extern bool bootRomActive;
 
 #define MAIN_CLOCK_HZ (4194304)
@@ -123,9 +125,22 @@ void gbDeinit(void);
 void cpuCycle();
 void cpuCycles(int cycles);
 
+#ifdef GAMEGIRL_BENCH
+// Sees every CPU write before it happens, used by gamegirl-bench --lockstep.  Only the bench
+//  is built with it, the emulator's writes don't pay for the check.
+typedef void (BusWriteHook)(const uint16_t addr, const uint8_t val8);
+extern BusWriteHook *busWriteHook;
+#endif
+
+// Bumped by every write into each 256 byte page of the CPU's address space, and whenever a
+//  write may have changed what's mapped in, so the memory view only re-reads written pages
+extern uint32_t memPageGeneration[256];
+extern uint32_t memMapGeneration;
+
 // get/set just access the memory.  read/write trigger cpu cycles
 uint8_t getMem8(uint16_t addr);
 uint8_t getRawMem8(uint16_t addr);
+void setRawMem8(uint16_t addr, uint8_t val8);
 void setMem8(uint16_t addr, uint8_t val8);
 uint8_t readMem8(uint16_t addr);
 void writeMem8(uint16_t addr, uint8_t val8);
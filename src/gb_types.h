@@ -23,11 +23,15 @@ typedef enum {
 } Status;
 
 
+typedef struct RomAnalysis RomAnalysis;
+
 typedef struct {
     int size;
     uint8_t *contents;
     uint8_t *contentFlags;
+    uint32_t flagsGeneration;   // bumped when contentFlags change after the analysis is done
     int entrypoint;
+    RomAnalysis *analysis;  // background code/data classification, see cpu_dis.c
 } RomImage;
 
 typedef struct {
@@ -6,13 +6,96 @@
 
 #include "gb.h"
 #include "gui.h"
+#include "profile.h"
+#include "instrument.h"
+#include "trace.h"
+#include "emulation.h"
+#include "rewind.h"
+#include "rlgl.h"
 
 Font firaFont;
-uint16_t systemBreakpoint = 0xFFFF;
 
-bool takeStep = false;
-bool takeBigStep = false;
-int bigStepCount = 0;
+// FNV-1a, hashes are chained by passing the previous one back in (start with PANEL_HASH_SEED)
+uint64_t guiPanelHash(uint64_t hash, const void * const data, const size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for(size_t index = 0; index < size; index++) {
+        hash = (hash ^ bytes[index]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Returns true if the panel has to be redrawn, in which case everything drawn until
+//  guiPanelCacheEnd goes into the cache, relative to its top left corner.
+bool guiPanelCacheBegin(PanelCache * const cache, const Vector2 size, const uint64_t key, const Color background)
+{
+    if( (0 != cache->target.id) && (key == cache->key) && (size.x == cache->size.x) && (size.y == cache->size.y) ) {
+        return false;
+    }
+    // rendered at the window's pixel density so text stays sharp on high DPI displays
+    const Vector2 scale = GetWindowScaleDPI();
+    if( (size.x != cache->size.x) || (size.y != cache->size.y) ) {
+        if( 0 != cache->target.id ) {
+            UnloadRenderTexture(cache->target);
+        }
+        cache->target = LoadRenderTexture(size.x*scale.x, size.y*scale.y);
+        cache->size = size;
+    }
+    cache->key = key;
+    BeginTextureMode(cache->target);
+    ClearBackground(background);
+    rlPushMatrix();
+    rlScalef(scale.x, scale.y, 1);
+    return true;
+}
+
+void guiPanelCacheEnd(void)
+{
+    rlPopMatrix();
+    EndTextureMode();
+}
+
+void guiPanelCacheDraw(const PanelCache * const cache, const Vector2 anchor)
+{
+    // render textures are stored upside down
+    const Rectangle source = { 0, 0, (float)cache->target.texture.width, -(float)cache->target.texture.height };
+    const Rectangle dest = { anchor.x, anchor.y, cache->size.x, cache->size.y };
+    DrawTexturePro(cache->target.texture, source, dest, (Vector2){ 0, 0 }, 0, WHITE);
+}
+
+// What the emulator controls show and ask for.  The buttons only record requests, they're
+//  handed to the emulation thread by guiSnapshotEmulatorControls with the lock held.
+static struct {
+    bool running;       // as of the last snapshot
+    bool step;
+    bool bigStep;
+    int bigStepCount;
+    bool reverseStep;
+    bool reverseContinue;
+    bool run;
+    bool stop;
+} emulatorControls = { .bigStepCount = 1000 };     // the default 1K, until the toggle is drawn
+
+static void guiSnapshotEmulatorControls(void)
+{
+    takeStep = takeStep || emulatorControls.step;
+    takeBigStep = takeBigStep || emulatorControls.bigStep;
+    bigStepCount = emulatorControls.bigStepCount;
+    takeReverseStep = takeReverseStep || emulatorControls.reverseStep;
+    takeReverseContinue = takeReverseContinue || emulatorControls.reverseContinue;
+    if( emulatorControls.run ) {
+        running = true;
+    } else if( emulatorControls.stop ) {
+        running = false;
+    }
+    emulatorControls.step = false;
+    emulatorControls.bigStep = false;
+    emulatorControls.reverseStep = false;
+    emulatorControls.reverseContinue = false;
+    emulatorControls.run = false;
+    emulatorControls.stop = false;
+    emulatorControls.running = running;
+}
 
 Vector2 guiDrawEmulatorControls(const Vector2 viewAnchor)
 {
@@ -24,7 +107,10 @@ Vector2 guiDrawEmulatorControls(const Vector2 viewAnchor)
     anchor.y += 5;
 
     // State
-    if( running ) {
+    if( emulatorControls.running && emulationFastForwarding() ) {
+        DrawRectangleV(anchor, (Vector2){60, 22}, ColorAlpha(ORANGE, 0.5));
+        DrawText((0 == fastForwardSpeed)? "FFWD MAX" : TextFormat("FFWD %dX", fastForwardSpeed), anchor.x+6, anchor.y+6, 10, BLACK);
+    } else if( emulatorControls.running ) {
         DrawRectangleV(anchor, (Vector2){60, 22}, ColorAlpha(LIME, 0.5));
         DrawText("RUNNING", anchor.x+8, anchor.y+6, 10, BLACK);
     } else {
@@ -33,31 +119,47 @@ Vector2 guiDrawEmulatorControls(const Vector2 viewAnchor)
     }
     anchor.x += 65;
 
+    // Reverse continue, back to the previous breakpoint
+    if( true == GuiButton((Rectangle){anchor.x, anchor.y, 40, 22}, "<RUN")) {
+        emulatorControls.reverseContinue = true;
+    }
+    anchor.x += 44;
+
+    // Reverse step
+    if( true == GuiButton((Rectangle){anchor.x, anchor.y, 40, 22}, "<STEP")) {
+        emulatorControls.reverseStep = true;
+    }
+    anchor.x += 44;
+
     // Step
-    takeStep = GuiButton((Rectangle){anchor.x, anchor.y, 50, 22}, "STEP");
-    anchor.x += 55;
+    if( true == GuiButton((Rectangle){anchor.x, anchor.y, 40, 22}, "STEP")) {
+        emulatorControls.step = true;
+    }
+    anchor.x += 44;
 
     // Big Step
-    takeBigStep = GuiButton((Rectangle){anchor.x, anchor.y, 50, 22}, "BGSTP");
-    anchor.x += 55;
+    if( true == GuiButton((Rectangle){anchor.x, anchor.y, 40, 22}, "BGSTP")) {
+        emulatorControls.bigStep = true;
+    }
+    anchor.x += 44;
 
     // Big Step size
     static int bigStepSelected = 2;
-    GuiToggleGroup((Rectangle){anchor.x, anchor.y+2, 30, 18}, "10;100;1K;10K;100K", &bigStepSelected);
-    bigStepCount = pow(10,bigStepSelected+1);
-    anchor.x += 34*5;
+    GuiToggleGroup((Rectangle){anchor.x, anchor.y+2, 26, 18}, "10;100;1K;10K;100K", &bigStepSelected);
+    emulatorControls.bigStepCount = pow(10,bigStepSelected+1);
+    anchor.x += 29*5;
 
     // Run
-    if( true == GuiButton((Rectangle){anchor.x, anchor.y, 50, 22}, "RUN")) {
-        running = true;
+    if( true == GuiButton((Rectangle){anchor.x, anchor.y, 40, 22}, "RUN")) {
+        emulatorControls.run = true;
     }
-    anchor.x += 55;
+    anchor.x += 44;
 
     // Stop
-    if( true == GuiButton((Rectangle){anchor.x, anchor.y, 50, 22}, "STOP")) {
-        running = false;
+    if( true == GuiButton((Rectangle){anchor.x, anchor.y, 40, 22}, "STOP")) {
+        emulatorControls.stop = true;
     }
-    anchor.x += 55;
+    anchor.x += 44;
 
     return (Vector2){480, 32};
 }
@@ -79,26 +181,20 @@ void guiInit(void)
 
 int gui(void)
 {
+#ifdef GAMEGIRL_PROFILE
+    bool showInstrumentation = false;
+#endif
 
-    int instructionsPerTab = 10000;
-    bool keepRunning = true;
+    if( SUCCESS != emulationStart() ) {
+        CloseWindow();
+        return 1;
+    }
 
     // game loop
     // run the loop untill the user presses ESCAPE or presses the Close button on the window
-    while (!WindowShouldClose() && keepRunning)
+    //  emulation runs on its own thread (see emulation.c), this one only draws
+    while (!WindowShouldClose() && !emulationExited())
     {
-        // Process keys
-        // Only change takeStep if the key is pressed so we don't miss gui button interations
-        takeStep = (IsKeyPressed(KEY_SPACE))? true : takeStep;
-        takeBigStep = (IsKeyPressed(KEY_TAB))? true : takeBigStep;
-        if(IsKeyPressed(KEY_R)) {
-            if(IsKeyDown(KEY_LEFT_SHIFT)) {
-                resetCpu();
-            } else {
-                running=true;
-            }
-        }
-
         ControlState controls;
         controls.buttonA = IsKeyDown(KEY_L);
         controls.buttonB = IsKeyDown(KEY_K);
@@ -108,34 +204,75 @@ int gui(void)
         controls.dpadLeft = IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A);
         controls.dpadUp = IsKeyDown(KEY_UP) || IsKeyDown(KEY_W);
         controls.dpadDown = IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S);
-        updateControls(controls);
-
-        if( takeStep ) {
-            executeInstruction(systemBreakpoint);
-            running = false;
-            takeStep = false;
-        } else if( takeBigStep ) {
-            for( int i=0; i<bigStepCount; i++) {
-                executeInstruction(systemBreakpoint);
+        emulationSetControls(controls);
+
+        // F toggles fast-forward
+        if(IsKeyPressed(KEY_F)) {
+            emulationSetFastForward(!emulationFastForwarding());
+        }
+        // the bigger debug panels would only slow it down
+        const bool showPanels = !emulationFastForwarding();
+
+        // Everything the panels show is copied between two emulated frames with the lock held,
+        //  and the requests from the keys and last frame's buttons are handed over at the same
+        //  time.  The panels are then drawn from the copies without holding up emulation.
+        emulationLock();
+        if( !running ) {
+            // the emulation thread picks them up while running
+            updateControls(controls);
+        }
+
+        // Process keys
+        // Only set the step requests here, the buttons' are added by guiSnapshotEmulatorControls
+        takeStep = (IsKeyPressed(KEY_SPACE))? true : takeStep;
+        takeBigStep = (IsKeyPressed(KEY_TAB))? true : takeBigStep;
+        // backspace steps back, shift+backspace continues back to the previous breakpoint
+        if(IsKeyPressed(KEY_BACKSPACE)) {
+            if(IsKeyDown(KEY_LEFT_SHIFT)) {
+                takeReverseContinue = true;
+            } else {
+                takeReverseStep = true;
             }
-            running = false;
-            takeBigStep = false;
-        } else if ( running ) {
-            int maxInstructionsPerFrame = 20000;  // Theoretical max should be ~17500
-            while( !guiUpdateScreen ) { //&& (0 < maxInstructionsPerFrame--) ) {
-                if( executeInstruction(systemBreakpoint) ) {
-                    running = false;
-                    if( exitOnBreak ) {
-                        keepRunning = false;
-                    }
-                    break;
-                }
+        }
+        if(IsKeyPressed(KEY_R)) {
+            if(IsKeyDown(KEY_LEFT_SHIFT)) {
+                resetCpu();
+                rewindReset();
+            } else {
+                running=true;
             }
         }
+#ifdef GAMEGIRL_PROFILE
+        // F9 dumps the opcode profile so far, shift+F9 starts it over
+        if(IsKeyPressed(KEY_F9)) {
+            if(IsKeyDown(KEY_LEFT_SHIFT)) {
+                profileReset();
+            } else {
+                profileDump(stdout);
+            }
+        }
+        // F10 toggles the instrumentation overlay, F11 dumps its history
+        if(IsKeyPressed(KEY_F10)) {
+            showInstrumentation = !showInstrumentation;
+        }
+        if(IsKeyPressed(KEY_F11)) {
+            instrumentWriteCsv(INSTRUMENT_CSV_FILENAME);
+        }
+#endif
+
+        guiSnapshotEmulatorControls();
+        guiSnapshotControls();
+        guiSnapshotCpuState();
+        if( showPanels ) {
+            guiSnapshotDisplay();
+            guiSnapshotMemRegViews();
+        }
+        emulationUnlock();
 
         Vector2 anchor, size;
         anchor = (Vector2){ GUI_PAD, GUI_PAD };
         // drawing
+        TRACE_BEGIN(TRACE_TRACK_HOST_FRAME, "draw", -1);
         BeginDrawing();
             ClearBackground(RAYWHITE);
 
@@ -143,10 +280,13 @@ int gui(void)
             ////////////
             // Down the left side
 
-            // Main Display
+            // Main Display, the newest published frame
+            INSTRUMENT_BEGIN(INSTR_DRAW_SCREEN);
             Vector2 screenSize = size = guiDrawDisplayScreen(anchor);
+            INSTRUMENT_END(INSTR_DRAW_SCREEN);
 
             // Controls
+            INSTRUMENT_BEGIN(INSTR_DRAW_OTHER);
             anchor.y += size.y + GUI_PAD;
             size = guiDrawControls(anchor);
 
@@ -157,6 +297,7 @@ int gui(void)
             // Emulator controls
             anchor.y += size.y + GUI_PAD;
             size = guiDrawEmulatorControls(anchor);
+            INSTRUMENT_END(INSTR_DRAW_OTHER);
 
             ///////////
             // Down adjacent to the screen
@@ -164,31 +305,59 @@ int gui(void)
             anchor = (Vector2){ anchor.x + screenSize.x + GUI_PAD, GUI_PAD };
             DrawFPS(anchor.x, anchor.y- (GUI_PAD/2));
 
-            // Tile Maps
-            anchor.y += 16;
-            Vector2 tileMapSize = size = guiDrawDisplayTileMap(anchor, 0);
-            size = guiDrawDisplayTileMap((Vector2){anchor.x + size.x + GUI_PAD, anchor.y}, 1);
-
-            // Memory view
-            anchor.y += size.y + GUI_PAD;
-            size = guiDrawMemRegViews(anchor);
-
-            ///////////
-            // Right side of the window
-
-            // OAM Objects
-            anchor = (Vector2){ anchor.x + 2*(tileMapSize.x + GUI_PAD), GUI_PAD };
-            size = guiDrawDisplayObjects((Vector2){anchor.x + FONTWIDTH*2, anchor.y});
+            if( showPanels ) {
+                // Tile Maps
+                anchor.y += 16;
+                INSTRUMENT_BEGIN(INSTR_DRAW_TILEMAPS);
+                Vector2 tileMapSize = size = guiDrawDisplayTileMap(anchor, 0);
+                size = guiDrawDisplayTileMap((Vector2){anchor.x + size.x + GUI_PAD, anchor.y}, 1);
+                INSTRUMENT_END(INSTR_DRAW_TILEMAPS);
+
+                // Memory view
+                anchor.y += size.y + GUI_PAD;
+                INSTRUMENT_BEGIN(INSTR_DRAW_MEMORY);
+                size = guiDrawMemRegViews(anchor);
+                INSTRUMENT_END(INSTR_DRAW_MEMORY);
+
+                ///////////
+                // Right side of the window
+
+                // OAM Objects
+                anchor = (Vector2){ anchor.x + 2*(tileMapSize.x + GUI_PAD), GUI_PAD };
+                INSTRUMENT_BEGIN(INSTR_DRAW_OBJECTS);
+                size = guiDrawDisplayObjects((Vector2){anchor.x + FONTWIDTH*2, anchor.y});
+                INSTRUMENT_END(INSTR_DRAW_OBJECTS);
+
+                // Tile Data
+                anchor.y += size.y + GUI_PAD;
+                INSTRUMENT_BEGIN(INSTR_DRAW_TILEDATA);
+                Vector2 tileDataSize = size = guiDrawDisplayTileData(anchor);
+                INSTRUMENT_END(INSTR_DRAW_TILEDATA);
+            }
 
-            // Tile Data
-            anchor.y += size.y + GUI_PAD;
-            Vector2 tileDataSize = size = guiDrawDisplayTileData(anchor);
+#ifdef GAMEGIRL_PROFILE
+            if( showInstrumentation ) {
+                // just right of the FPS counter, over the tile maps
+                guiDrawInstrumentation((Vector2){ GUI_PAD*2 + screenSize.x + FONTWIDTH*12, GUI_PAD/2 });
+            }
+#endif
 
         // end the frame and get ready for the next one  (display frame, poll input, etc...)
+        TRACE_BEGIN(TRACE_TRACK_HOST_FRAME, "present", -1);
+        INSTRUMENT_BEGIN(INSTR_PRESENT);
         EndDrawing();
+        INSTRUMENT_END(INSTR_PRESENT);
+        TRACE_END(TRACE_TRACK_HOST_FRAME);
+#ifdef GAMEGIRL_PROFILE
+        // the emulation thread adds to the counters too
+        emulationLock();
+        instrumentEndFrame();
+        emulationUnlock();
+#endif
     }
 
     // cleanup
+    emulationStop();
 
     // destroy the window and cleanup the OpenGL context
     CloseWindow();
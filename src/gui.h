@@ -24,7 +24,21 @@ extern "C" {
 #define GUI_PAD         (10.0f)
 
 extern Font firaFont;
-extern uint16_t systemBreakpoint;
+
+// Debug panels that only change when the machine does are drawn into a render texture once
+//  and redrawn only when their key, a hash of whatever they're drawn from, changes.
+typedef struct {
+    RenderTexture2D target;
+    Vector2 size;
+    uint64_t key;
+} PanelCache;
+
+#define PANEL_HASH_SEED     (0xCBF29CE484222325ULL)
+
+uint64_t guiPanelHash(uint64_t hash, const void * const data, const size_t size);
+bool guiPanelCacheBegin(PanelCache * const cache, const Vector2 size, const uint64_t key, const Color background);
+void guiPanelCacheEnd(void);
+void guiPanelCacheDraw(const PanelCache * const cache, const Vector2 anchor);
 
 void guiInit(void);
 int gui(void);
@@ -0,0 +1,445 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "gui.h"
+#include "history.h"
+#include <signal.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Instruction history
+//
+// executeInstruction starts a record as it decodes each instruction and the operand fetches
+//  fill in its bytes, so keeping it costs a handful of stores.  The ring keeps the last
+//  HISTORY_SIZE instructions for the history view, the disassembly in the cpu panel, and a
+//  text dump when execution stops on a breakpoint or the emulator crashes.  While it's off,
+//  or compiled out, historyRecent keeps just enough for the cpu panel.
+//
+// rewind.c puts historyCount back along with the rest of the machine and replaying writes the
+//  same records again, so only the ones overwritten since (historyHighWater) are lost.
+
+#define HISTORY_LINE_HEIGHT     (18)
+#define HISTORY_VISIBLE_LINES   (16)
+#define HISTORY_PADDING         (4)
+
+bool historyEnabled = false;
+HistoryRecord *historyRing = NULL;
+static HistoryRecord historyScratch;    // written to before there's a ring to write to
+HistoryRecord *historyCurrent = &historyScratch;
+uint64_t historyCount = 0;
+HistoryRecord historyRecent[HISTORY_RECENT_SIZE];
+uint64_t historyRecentCount = 0;
+
+static uint64_t historyHighWater = 0;   // the most historyCount has been before a rewind
+static const char *historyDumpFilename = NULL;
+#ifndef _WIN32
+static int historyCrashFd = -1;         // opened ahead of time, nothing can be opened in the handler
+#endif
+
+Status historyStart(void)
+{
+#ifdef GAMEGIRL_NO_HISTORY
+    printf("Built without the instruction history\n");
+    return FAILURE;
+#else
+    if( NULL == historyRing ) {
+        historyRing = (HistoryRecord *)MemAlloc(HISTORY_SIZE * sizeof(HistoryRecord));
+        if( NULL == historyRing ) {
+            printf("Unable to allocate the instruction history\n");
+            return FAILURE;
+        }
+    }
+    historyEnabled = true;
+    return SUCCESS;
+#endif
+}
+
+static void historyDetach(void)
+{
+    historyScratch.length = 0;
+    historyCurrent = &historyScratch;
+}
+
+void historyStop(void)
+{
+    historyEnabled = false;
+    historyDetach();
+}
+
+void historyReset(void)
+{
+    historyCount = 0;
+    historyHighWater = 0;
+    historyRecentCount = 0;
+    historyDetach();
+}
+
+void historyDeinit(void)
+{
+    historyStop();
+    if( NULL != historyRing ) {
+        MemFree(historyRing);
+        historyRing = NULL;
+    }
+    historyReset();
+}
+
+void historyRewound(void)
+{
+    historyHighWater = MAX(historyHighWater, historyCount);
+}
+
+uint64_t historyAvailable(void)
+{
+    if( NULL == historyRing ) {
+        return 0;
+    }
+    const uint64_t written = MAX(historyHighWater, historyCount);
+    const uint64_t oldest = (HISTORY_SIZE < written)? (written - HISTORY_SIZE) : 0;
+    return (historyCount > oldest)? (historyCount - oldest) : 0;
+}
+
+const HistoryRecord *historyAt(const uint64_t age)
+{
+    if( age >= historyAvailable() ) {
+        return NULL;
+    }
+    return &historyRing[(historyCount - 1 - age) & (HISTORY_SIZE-1)];
+}
+
+const HistoryRecord *historyRecentAt(const uint64_t age)
+{
+    if( historyEnabled ) {
+        return historyAt(age);
+    }
+    if( age >= MIN(historyRecentCount, HISTORY_RECENT_SIZE) ) {
+        return NULL;
+    }
+    return &historyRecent[(historyRecentCount - 1 - age) & (HISTORY_RECENT_SIZE-1)];
+}
+
+static const char *historyBankText(const uint16_t bank)
+{
+    if( HISTORY_BANK_NONE == bank ) {
+        return "--";
+    } else if( HISTORY_BANK_BOOT == bank ) {
+        return "BT";
+    }
+    return TextFormat("%02X", bank);
+}
+
+// "C3 50 01  JP $0150", the bytes the instruction read and its disassembly
+static void historyFormatCode(char * const buffer, const HistoryRecord * const record)
+{
+    char *buff = buffer;
+    for(int index = 0; index < 3; index++) {
+        if( index < record->length ) {
+            buff += sprintf(buff, "%02X ", record->code[index]);
+        } else {
+            buff += sprintf(buff, "   ");
+        }
+    }
+    buff += sprintf(buff, " ");
+    uint8_t code[3] = {0};
+    memcpy(code, record->code, MIN(record->length, sizeof(code)));
+    disassemble2(buff, code, record->pc);
+}
+
+void historyDump(FILE * const file)
+{
+    const uint64_t available = historyAvailable();
+    fprintf(file, "# %llu instructions, oldest first: cycle bank:pc code\n", (unsigned long long)available);
+    for(uint64_t age = available; age > 0; age--) {
+        const HistoryRecord * const record = historyAt(age-1);
+        char code[64];
+        historyFormatCode(code, record);
+        fprintf(file, "%12llu %s:%04X  %s\n", (unsigned long long)(record->cycle / MAIN_CLOCKS_PER_CPU_CYCLE),
+            historyBankText(record->bank), record->pc, code);
+    }
+}
+
+Status historyWriteFile(const char * const filename)
+{
+    FILE *file = fopen(filename, "w");
+    if( NULL == file ) {
+        printf("Unable to write the instruction history to '%s'\n", filename);
+        return FAILURE;
+    }
+    historyDump(file);
+    fclose(file);
+    printf("Instruction history written to '%s'\n", filename);
+    return SUCCESS;
+}
+
+#ifndef _WIN32
+// Only what's safe in a signal handler from here on, no stdio and no allocation, so the crash
+//  dump is formatted by hand and has no disassembly (disassemble2 uses sprintf)
+static char *historyCrashDecimal(char *buff, uint64_t value, const int width)
+{
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while( 0 != value );
+    for(int pad = count; pad < width; pad++) {
+        *buff++ = ' ';
+    }
+    while( 0 < count ) {
+        *buff++ = digits[--count];
+    }
+    return buff;
+}
+
+static char *historyCrashHex(char *buff, const uint32_t value, const int digits)
+{
+    for(int shift = (digits-1)*4; shift >= 0; shift -= 4) {
+        *buff++ = "0123456789ABCDEF"[(value >> shift) & 0xF];
+    }
+    return buff;
+}
+
+static bool historyCrashWrite(const char *buffer, size_t length)
+{
+    while( 0 < length ) {
+        const ssize_t written = write(historyCrashFd, buffer, length);
+        if( 0 >= written ) {
+            return false;
+        }
+        buffer += written;
+        length -= written;
+    }
+    return true;
+}
+
+// "     1234567 01:4A3F  C3 50 01", the same as historyDump up to the disassembly
+static char *historyCrashLine(char *buff, const HistoryRecord * const record)
+{
+    buff = historyCrashDecimal(buff, record->cycle / MAIN_CLOCKS_PER_CPU_CYCLE, 12);
+    *buff++ = ' ';
+    if( HISTORY_BANK_NONE == record->bank ) {
+        *buff++ = '-';
+        *buff++ = '-';
+    } else if( HISTORY_BANK_BOOT == record->bank ) {
+        *buff++ = 'B';
+        *buff++ = 'T';
+    } else {
+        buff = historyCrashHex(buff, record->bank, (0xFF < record->bank)? 4 : 2);
+    }
+    *buff++ = ':';
+    buff = historyCrashHex(buff, record->pc, 4);
+    *buff++ = ' ';
+    for(int index = 0; (index < record->length) && (index < 3); index++) {
+        *buff++ = ' ';
+        buff = historyCrashHex(buff, record->code[index], 2);
+    }
+    *buff++ = '\n';
+    return buff;
+}
+
+static void historyCrashHandler(int sig)
+{
+    signal(sig, SIG_DFL);
+    char buffer[4096];
+    const uint64_t available = historyAvailable();
+    char *buff = buffer;
+    static const char crashed[] = "# crashed, ";
+    memcpy(buff, crashed, sizeof(crashed)-1);
+    buff = historyCrashDecimal(buff + sizeof(crashed)-1, available, 0);
+    static const char columns[] = " instructions, oldest first: cycle bank:pc code\n";
+    memcpy(buff, columns, sizeof(columns)-1);
+    buff += sizeof(columns)-1;
+
+    bool ok = (0 == ftruncate(historyCrashFd, 0));
+    for(uint64_t age = available; ok && (age > 0); age--) {
+        if( (size_t)(&buffer[sizeof(buffer)] - buff) < 64 ) {
+            ok = historyCrashWrite(buffer, buff - buffer);
+            buff = buffer;
+        }
+        buff = historyCrashLine(buff, historyAt(age-1));
+    }
+    if( ok ) {
+        historyCrashWrite(buffer, buff - buffer);
+    }
+    raise(sig);
+}
+#endif
+
+void historyDumpOnBreak(const char * const filename)
+{
+    historyDumpFilename = filename;
+#ifndef _WIN32
+    // not truncated until there's a crash to write, a breakpoint rewrites it anyway
+    historyCrashFd = open(filename, O_WRONLY | O_CREAT, 0644);
+    if( 0 > historyCrashFd ) {
+        printf("Unable to open '%s', the history won't be written on a crash\n", filename);
+        return;
+    }
+    signal(SIGSEGV, historyCrashHandler);
+    signal(SIGABRT, historyCrashHandler);
+    signal(SIGFPE, historyCrashHandler);
+    signal(SIGILL, historyCrashHandler);
+#ifdef SIGBUS
+    signal(SIGBUS, historyCrashHandler);
+#endif
+#endif
+}
+
+void historyBreak(void)
+{
+    if( NULL != historyDumpFilename ) {
+        historyWriteFile(historyDumpFilename);
+    }
+}
+
+// The history view's own state, and the records around where it's scrolled to as of the last
+//  guiSnapshotHistoryView.  Changes it asks for wait for the next snapshot, under the lock.
+#define HISTORY_SNAPSHOT_LINES  (3*(HISTORY_VISIBLE_LINES+1))   // a page either side, for scrolling
+
+static struct {
+    Vector2 scrollPosition;
+    char searchText[8];
+    bool searchEditing;
+    int64_t selected;
+    bool notFound;
+    // requests
+    int32_t findAddr;       // -1 for none
+    bool setCapture;
+    bool capture;
+    bool dump;
+    // snapshot
+    bool enabled;
+    uint64_t available;
+    uint64_t newestCycle;
+    uint64_t firstAge;      // of records[0]
+    int numRecords;
+    HistoryRecord records[HISTORY_SNAPSHOT_LINES];
+} historyView = { .selected = -1, .findAddr = -1 };
+
+static uint64_t historyViewStartAge(void)
+{
+    const int scrollY = floor(historyView.scrollPosition.y);
+    return -(scrollY/HISTORY_LINE_HEIGHT);
+}
+
+void guiSnapshotHistoryView(void)
+{
+    if( historyView.setCapture ) {
+        historyView.setCapture = false;
+        if( historyView.capture && !historyEnabled ) {
+            historyStart();
+        } else if( !historyView.capture && historyEnabled ) {
+            historyStop();
+        }
+    }
+    if( 0 <= historyView.findAddr ) {
+        historyView.notFound = true;
+        const uint64_t available = historyAvailable();
+        for(uint64_t age = historyView.selected+1; age < available; age++) {
+            if( historyView.findAddr == historyAt(age)->pc ) {
+                historyView.selected = age;
+                historyView.scrollPosition.y = -(float)(age * HISTORY_LINE_HEIGHT);
+                historyView.notFound = false;
+                break;
+            }
+        }
+        historyView.findAddr = -1;
+    }
+    if( historyView.dump ) {
+        historyView.dump = false;
+        historyWriteFile((NULL != historyDumpFilename)? historyDumpFilename : HISTORY_DUMP_FILENAME);
+    }
+
+    historyView.enabled = historyEnabled;
+    historyView.available = historyAvailable();
+    historyView.newestCycle = (0 < historyView.available)? historyAt(0)->cycle : 0;
+    const uint64_t startAge = historyViewStartAge();
+    historyView.firstAge = (HISTORY_VISIBLE_LINES+1 < startAge)? (startAge - (HISTORY_VISIBLE_LINES+1)) : 0;
+    historyView.numRecords = 0;
+    while( historyView.numRecords < HISTORY_SNAPSHOT_LINES ) {
+        const HistoryRecord * const record = historyAt(historyView.firstAge + historyView.numRecords);
+        if( NULL == record ) {
+            break;
+        }
+        historyView.records[historyView.numRecords++] = *record;
+    }
+}
+
+// Newest first, with a search for the next older instruction at an address
+Vector2 guiDrawHistoryView(const Vector2 viewAnchor)
+{
+    // Capture on or off
+    bool capture = historyView.enabled;
+    GuiCheckBox(ANCHOR_RECT(viewAnchor, 0, 3, 14, 14), "CAPTURE", &capture);
+    if( capture != historyView.enabled ) {
+        historyView.setCapture = true;
+        historyView.capture = capture;
+    }
+
+    // Search by address
+    if( GuiTextBox(ANCHOR_RECT(viewAnchor, 90, 0, 60, 20), historyView.searchText, sizeof(historyView.searchText), historyView.searchEditing) ) {
+        historyView.searchEditing = !historyView.searchEditing;
+    }
+    if( GuiButton(ANCHOR_RECT(viewAnchor, 154, 0, 50, 20), "FIND") ) {
+        char *end;
+        const long addr = strtol(historyView.searchText, &end, 16);
+        if( (end != historyView.searchText) && ('\0' == *end) && (0 <= addr) && (0xFFFF >= addr) ) {
+            historyView.findAddr = addr;
+        } else {
+            historyView.notFound = true;
+        }
+    }
+    if( GuiButton(ANCHOR_RECT(viewAnchor, 208, 0, 50, 20), "NEWEST") ) {
+        historyView.selected = -1;
+        historyView.scrollPosition.y = 0;
+        historyView.notFound = false;
+    }
+    if( GuiButton(ANCHOR_RECT(viewAnchor, 262, 0, 50, 20), "DUMP") ) {
+        historyView.dump = true;
+    }
+    DrawTextEx(firaFont, (historyView.notFound)? "NOT FOUND" : TextFormat("%llu", (unsigned long long)historyView.available),
+        (Vector2){viewAnchor.x + 320, viewAnchor.y + 2}, FONTSIZE, 0, (historyView.notFound)? MAROON : DARKGRAY);
+
+    // The records
+    Rectangle contentSize = {
+        0, 0,
+        480-(float)GuiGetStyle(LISTVIEW, SCROLLBAR_WIDTH)-2*GuiGetStyle(DEFAULT, BORDER_WIDTH),
+        historyView.available*HISTORY_LINE_HEIGHT+HISTORY_PADDING*2
+    };
+    Rectangle viewPort;
+    GuiScrollPanel(ANCHOR_RECT(viewAnchor, 0, 24, 480, HISTORY_VISIBLE_LINES*HISTORY_LINE_HEIGHT+HISTORY_PADDING*2),
+                    NULL, contentSize, &historyView.scrollPosition, &viewPort);
+
+    const int scrollY = floor(historyView.scrollPosition.y);
+    const uint64_t startAge = historyViewStartAge();
+    const float scrollOffset = scrollY % HISTORY_LINE_HEIGHT;
+
+    BeginScissorMode(viewPort.x, viewPort.y, viewPort.width, viewPort.height);
+        for( int viewRow = 0; viewRow < HISTORY_VISIBLE_LINES+1; viewRow++ ) {
+            const uint64_t age = startAge + viewRow;
+            if( (age < historyView.firstAge) || (age - historyView.firstAge >= (uint64_t)historyView.numRecords) ) {
+                continue;   // scrolled further than the snapshot since, it's there next frame
+            }
+            const HistoryRecord * const record = &historyView.records[age - historyView.firstAge];
+            const Vector2 lineAnchor = {viewAnchor.x+HISTORY_PADDING, viewPort.y+HISTORY_PADDING+scrollOffset+viewRow*HISTORY_LINE_HEIGHT};
+            if( (int64_t)age == historyView.selected ) {
+                DrawRectangle(viewPort.x, lineAnchor.y-1, viewPort.width, HISTORY_LINE_HEIGHT-1, ColorAlpha(GOLD, 0.3));
+            }
+            char code[64];
+            historyFormatCode(code, record);
+            // cpu cycles before the newest instruction, rather than since reset
+            const uint64_t cycles = (historyView.newestCycle - record->cycle) / MAIN_CLOCKS_PER_CPU_CYCLE;
+            DrawTextEx(firaFont, TextFormat("%7llu %s:%04X  %-28s -%llu", (unsigned long long)age,
+                historyBankText(record->bank), record->pc, code, (unsigned long long)cycles),
+                lineAnchor, FONTSIZE, 0, BLACK);
+        }
+    EndScissorMode();
+
+    return (Vector2){480, HISTORY_VISIBLE_LINES*HISTORY_LINE_HEIGHT+HISTORY_PADDING*2 + 24};
+}
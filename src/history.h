@@ -0,0 +1,107 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#include "gb_types.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTORY_SIZE            (1 << 20)   // records, a power of two
+#define HISTORY_RECENT_SIZE     (8)         // records, a power of two
+#define HISTORY_BANK_NONE       (0xFFFF)    // not running from ROM
+#define HISTORY_BANK_BOOT       (0xFFFE)    // running the boot ROM
+#define HISTORY_DUMP_FILENAME   "gamegirl-history.txt"
+
+// One executed instruction, four to a cache line.  The code is whatever the instruction read
+//  as it ran, so nothing is read again to record it.
+typedef struct {
+    uint64_t cycle;     // mainClock as it started
+    uint16_t pc;
+    uint16_t bank;      // ROM bank mapped at pc, or HISTORY_BANK_*
+    uint8_t code[3];    // the opcode, then its operand bytes
+    uint8_t length;     // of code
+} HistoryRecord;
+
+extern bool historyEnabled;
+extern HistoryRecord *historyRing;
+extern HistoryRecord *historyCurrent;   // the instruction being executed
+extern uint64_t historyCount;           // records written since reset
+extern HistoryRecord historyRecent[HISTORY_RECENT_SIZE];
+extern uint64_t historyRecentCount;
+
+// The ring is compiled out entirely with GAMEGIRL_NO_HISTORY (premake5 --nohistory), otherwise
+//  only recorded while historyEnabled, which the GUI turns on.  Whenever it isn't, the last few
+//  instructions still go into historyRecent for the cpu panel, without their bank or cycle.
+
+static inline void historyBeginRecent(const uint16_t pc, const uint8_t opcode)
+{
+    HistoryRecord * const record = &historyRecent[historyRecentCount++ & (HISTORY_RECENT_SIZE-1)];
+    record->pc = pc;
+    record->code[0] = opcode;
+    record->length = 1;
+    historyCurrent = record;
+}
+
+#ifndef GAMEGIRL_NO_HISTORY
+
+static inline void historyBegin(const uint16_t pc, const uint16_t bank, const uint8_t opcode, const uint64_t cycle)
+{
+    HistoryRecord * const record = &historyRing[historyCount++ & (HISTORY_SIZE-1)];
+    record->cycle = cycle;
+    record->pc = pc;
+    record->bank = bank;
+    record->code[0] = opcode;
+    record->length = 1;
+    historyCurrent = record;
+}
+
+#define HISTORY_BEGIN(pc, bank, opcode, cycle) \
+    do { if( historyEnabled ) { historyBegin((pc), (bank), (opcode), (cycle)); } else { historyBeginRecent((pc), (opcode)); } } while(0)
+
+#else
+
+#define HISTORY_BEGIN(pc, bank, opcode, cycle) \
+    do { historyBeginRecent((pc), (opcode)); } while(0)
+
+#endif
+
+#define HISTORY_OPERAND(val8) \
+    do { historyCurrent->code[historyCurrent->length++] = (val8); } while(0)
+
+Status historyStart(void);
+void historyStop(void);
+void historyReset(void);
+// Stops recording and frees the ring, historyStart allocates it again
+void historyDeinit(void);
+// Records still held for the current timeline, and the one age instructions before the newest
+uint64_t historyAvailable(void);
+const HistoryRecord *historyAt(const uint64_t age);
+// From the ring while it's recording, otherwise historyRecent, NULL past HISTORY_RECENT_SIZE
+const HistoryRecord *historyRecentAt(const uint64_t age);
+// Called before rewind.c puts historyCount back, the records after it are kept until overwritten
+void historyRewound(void);
+
+// Oldest first, one line per instruction
+void historyDump(FILE * const file);
+Status historyWriteFile(const char * const filename);
+// Writes the history to filename whenever execution stops on a breakpoint, and on a crash
+//  (POSIX only, without the disassembly)
+void historyDumpOnBreak(const char * const filename);
+void historyBreak(void);
+
+void guiSnapshotHistoryView(void);
+Vector2 guiDrawHistoryView(const Vector2 viewAnchor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__HISTORY_H__
@@ -0,0 +1,169 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "gui.h"
+#include "instrument.h"
+#include <time.h>
+
+#ifdef GAMEGIRL_PROFILE
+
+uint64_t instrumentTimerTicks[NUM_INSTR_TIMERS];
+uint64_t instrumentCounts[NUM_INSTR_COUNTERS];
+
+static const char * const timerNames[NUM_INSTR_TIMERS] = {
+    [INSTR_EMULATE]       = "emulate",
+    [INSTR_TIMER]         = "timer",
+    [INSTR_PPU]           = "ppu",
+    [INSTR_OAM_DMA]       = "oamDma",
+    [INSTR_DRAW_SCREEN]   = "drawScreen",
+    [INSTR_DRAW_TILEMAPS] = "drawTileMaps",
+    [INSTR_DRAW_OBJECTS]  = "drawObjects",
+    [INSTR_DRAW_TILEDATA] = "drawTileData",
+    [INSTR_DRAW_MEMORY]   = "drawMemory",
+    [INSTR_DRAW_OTHER]    = "drawOther",
+    [INSTR_PRESENT]       = "present",
+};
+
+static const char * const counterNames[NUM_INSTR_COUNTERS] = {
+    [INSTR_COUNT_INSTRUCTIONS] = "instructions",
+    [INSTR_COUNT_CPU_CYCLES]   = "cpuCycles",
+};
+
+typedef struct {
+    double frameNs;                 // wall time since the previous frame ended
+    double timerNs[NUM_INSTR_TIMERS];
+    uint64_t counts[NUM_INSTR_COUNTERS];
+} InstrumentFrame;
+
+static struct {
+    InstrumentFrame frames[INSTRUMENT_FRAMES];
+    int head;                       // next frame to write
+    int numFrames;
+    uint64_t totalFrames;
+    // ticks are converted to ns using the ratio seen since the first frame
+    double firstNs;
+    uint64_t firstTicks;
+    double lastNs;
+} instrument;
+
+static double instrumentNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// Closes out the current frame's timers and counters into the history ring
+void instrumentEndFrame(void)
+{
+    const double nowNs = instrumentNow();
+    const uint64_t nowTicks = instrumentTicks();
+    if( 0 == instrument.totalFrames++ ) {
+        // nothing to calibrate against yet, drop the first frame
+        instrument.firstNs = instrument.lastNs = nowNs;
+        instrument.firstTicks = nowTicks;
+        memset(instrumentTimerTicks, 0, sizeof(instrumentTimerTicks));
+        memset(instrumentCounts, 0, sizeof(instrumentCounts));
+        return;
+    }
+    const double nsPerTick = (nowNs - instrument.firstNs) / MAX(1, nowTicks - instrument.firstTicks);
+
+    InstrumentFrame *frame = &instrument.frames[instrument.head];
+    frame->frameNs = nowNs - instrument.lastNs;
+    for(int timer = 0; timer < NUM_INSTR_TIMERS; timer++) {
+        frame->timerNs[timer] = instrumentTimerTicks[timer] * nsPerTick;
+    }
+    memcpy(frame->counts, instrumentCounts, sizeof(frame->counts));
+    instrument.lastNs = nowNs;
+    instrument.head = (instrument.head + 1) % INSTRUMENT_FRAMES;
+    instrument.numFrames = MIN(instrument.numFrames + 1, INSTRUMENT_FRAMES);
+
+    memset(instrumentTimerTicks, 0, sizeof(instrumentTimerTicks));
+    memset(instrumentCounts, 0, sizeof(instrumentCounts));
+}
+
+// Writes the whole history, oldest frame first, times in milliseconds
+Status instrumentWriteCsv(const char * const filename)
+{
+    FILE *file = fopen(filename, "w");
+    if( NULL == file ) {
+        printf("Unable to write instrumentation to '%s'\n", filename);
+        return FAILURE;
+    }
+    fprintf(file, "frame,frameMs");
+    for(int timer = 0; timer < NUM_INSTR_TIMERS; timer++) {
+        fprintf(file, ",%sMs", timerNames[timer]);
+    }
+    for(int counter = 0; counter < NUM_INSTR_COUNTERS; counter++) {
+        fprintf(file, ",%s", counterNames[counter]);
+    }
+    fprintf(file, "\n");
+
+    const uint64_t firstFrame = instrument.totalFrames - instrument.numFrames;
+    for(int index = 0; index < instrument.numFrames; index++) {
+        const InstrumentFrame *frame =
+            &instrument.frames[(instrument.head + INSTRUMENT_FRAMES - instrument.numFrames + index) % INSTRUMENT_FRAMES];
+        fprintf(file, "%llu,%.4f", (unsigned long long)(firstFrame + index), frame->frameNs / 1e6);
+        for(int timer = 0; timer < NUM_INSTR_TIMERS; timer++) {
+            fprintf(file, ",%.4f", frame->timerNs[timer] / 1e6);
+        }
+        for(int counter = 0; counter < NUM_INSTR_COUNTERS; counter++) {
+            fprintf(file, ",%llu", (unsigned long long)frame->counts[counter]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    printf("Instrumentation for %d frames written to '%s'\n", instrument.numFrames, filename);
+    return SUCCESS;
+}
+
+// Averages over the last second, drawn over whatever is at anchor
+Vector2 guiDrawInstrumentation(const Vector2 anchor)
+{
+    const int averageFrames = MIN(60, instrument.numFrames);
+    const int lines = 2 + NUM_INSTR_TIMERS + NUM_INSTR_COUNTERS;
+    const Vector2 size = { FONTWIDTH*26, FONTSIZE*lines + GUI_PAD };
+    DrawRectangleV(anchor, size, ColorAlpha(RAYWHITE, 0.9f));
+    DrawRectangleLines(anchor.x, anchor.y, size.x, size.y, GRAY);
+    if( 0 == averageFrames ) {
+        return size;
+    }
+
+    InstrumentFrame average = {0};
+    for(int index = 0; index < averageFrames; index++) {
+        const InstrumentFrame *frame = &instrument.frames[(instrument.head + INSTRUMENT_FRAMES - 1 - index) % INSTRUMENT_FRAMES];
+        average.frameNs += frame->frameNs / averageFrames;
+        for(int timer = 0; timer < NUM_INSTR_TIMERS; timer++) {
+            average.timerNs[timer] += frame->timerNs[timer] / averageFrames;
+        }
+        for(int counter = 0; counter < NUM_INSTR_COUNTERS; counter++) {
+            average.counts[counter] += frame->counts[counter];
+        }
+    }
+
+    Vector2 line = { anchor.x + GUI_PAD/2, anchor.y + GUI_PAD/2 };
+    DrawTextEx(firaFont, TextFormat("%-14s %7.2f ms", "frame", average.frameNs / 1e6), line, FONTSIZE, 0, BLACK);
+    line.y += FONTSIZE;
+    for(int timer = 0; timer < NUM_INSTR_TIMERS; timer++) {
+        const char *indent = ((INSTR_TIMER <= timer) && (INSTR_OAM_DMA >= timer))? "  " : "";
+        DrawTextEx(firaFont, TextFormat("%s%-*s %7.2f ms", indent, 14 - (int)strlen(indent), timerNames[timer], average.timerNs[timer] / 1e6),
+            line, FONTSIZE, 0, BLACK);
+        line.y += FONTSIZE;
+    }
+    const double cpuNs = average.timerNs[INSTR_EMULATE] - average.timerNs[INSTR_TIMER]
+                         - average.timerNs[INSTR_PPU] - average.timerNs[INSTR_OAM_DMA];
+    DrawTextEx(firaFont, TextFormat("  %-12s %7.2f ms", "cpu (rest)", cpuNs / 1e6), line, FONTSIZE, 0, DARKGRAY);
+    line.y += FONTSIZE;
+    for(int counter = 0; counter < NUM_INSTR_COUNTERS; counter++) {
+        DrawTextEx(firaFont, TextFormat("%-14s %10llu", counterNames[counter], (unsigned long long)(average.counts[counter] / averageFrames)),
+            line, FONTSIZE, 0, BLACK);
+        line.y += FONTSIZE;
+    }
+    return size;
+}
+
+#endif // GAMEGIRL_PROFILE
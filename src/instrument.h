@@ -0,0 +1,93 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+#include "gb_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host side timers, nested ones are included in their parent's time too
+typedef enum {
+    INSTR_EMULATE,          // every executeInstruction call in a frame
+    INSTR_TIMER,            //   timerTick
+    INSTR_PPU,              //   ppuCycles
+    INSTR_OAM_DMA,          //   oamDmaCycle
+    INSTR_DRAW_SCREEN,
+    INSTR_DRAW_TILEMAPS,
+    INSTR_DRAW_OBJECTS,
+    INSTR_DRAW_TILEDATA,
+    INSTR_DRAW_MEMORY,
+    INSTR_DRAW_OTHER,       // controls, cpu state and emulator controls
+    INSTR_PRESENT,          // EndDrawing, including any wait for vsync
+    NUM_INSTR_TIMERS
+} InstrumentTimer;
+
+typedef enum {
+    INSTR_COUNT_INSTRUCTIONS,
+    INSTR_COUNT_CPU_CYCLES,
+    NUM_INSTR_COUNTERS
+} InstrumentCounter;
+
+#define INSTRUMENT_FRAMES       (600)   // ten seconds of history at 60fps
+#define INSTRUMENT_CSV_FILENAME "gamegirl-instrument.csv"
+
+// Only built with GAMEGIRL_PROFILE (premake5 --profile), otherwise it all compiles away.
+//  Timers read the TSC where there is one, so they're cheap enough to wrap every cpu cycle.
+#ifdef GAMEGIRL_PROFILE
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define INSTRUMENT_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define INSTRUMENT_TSC
+#else
+#include <time.h>
+#endif
+
+static inline uint64_t instrumentTicks(void)
+{
+#ifdef INSTRUMENT_TSC
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+extern uint64_t instrumentTimerTicks[NUM_INSTR_TIMERS];
+extern uint64_t instrumentCounts[NUM_INSTR_COUNTERS];
+
+#define INSTRUMENT_BEGIN(timer)         const uint64_t instrumentStart##timer = instrumentTicks()
+#define INSTRUMENT_END(timer)           (instrumentTimerTicks[timer] += instrumentTicks() - instrumentStart##timer)
+#define INSTRUMENT_COUNT(counter, n)    (instrumentCounts[counter] += (n))
+
+void instrumentEndFrame(void);
+Status instrumentWriteCsv(const char * const filename);
+Vector2 guiDrawInstrumentation(const Vector2 anchor);
+
+#else
+
+#define INSTRUMENT_BEGIN(timer)
+#define INSTRUMENT_END(timer)
+#define INSTRUMENT_COUNT(counter, n)
+
+#define instrumentEndFrame()
+#define instrumentWriteCsv(filename)
+#define guiDrawInstrumentation(anchor)  ((Vector2){ 0, 0 })
+
+#endif // GAMEGIRL_PROFILE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__INSTRUMENT_H__
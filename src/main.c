@@ -6,6 +6,13 @@
 
 #include "gb.h"
 #include "gui.h"
+#include "romdb.h"
+#include "profile.h"
+#include "trace.h"
+#include "doctorlog.h"
+#include "emulation.h"
+#include "breakpoints.h"
+#include "history.h"
 #include "raylib.h"
 #include <argp.h>
 
@@ -16,16 +23,41 @@ const char *argp_program_version = "gamegirl 0.1.0";
 static char argp_doc[] = "GameGirl, a GameBoy(tm) Emulator by Haley";
 // A description of the positional arguments we accept
 static char argp_positional_doc[] = "romImage";
+// Keys for long-only options
+#define ARG_KEY_INDEX   (0x100)
+#define ARG_KEY_VERIFY  (0x101)
+#define ARG_KEY_HOTSPOTS    (0x102)
+#define ARG_KEY_SAMPLE      (0x103)
+#define ARG_KEY_TRACE       (0x104)
+#define ARG_KEY_BINARY_LOG  (0x105)
+#define ARG_KEY_FAST_FORWARD    (0x106)
+#define ARG_KEY_WATCH       (0x107)
+#define ARG_KEY_HISTORY     (0x108)
+#define ARG_KEY_NO_HISTORY  (0x109)
+
 // The options we understand.
 static struct argp_option argp_options[] = {
   {"run",       'r', 0,      0,  "Automatically start in running state" },
   {"fastboot",  'f', 0,      0,  "Fastboot mode doesn't run GUI during bootrom"},
   {"console",   'c', 0,      0,  "Enable serial output to console" },
-  {"break",     'b', "ADDR", 0,  "Set Breakpoint at address [ADDR]"},
+  {"break",     'b', "ADDR", 0,  "Set Breakpoint at address [ADDR], optionally ADDR-END,CONDITION e.g. 0150,A==3F (may be repeated)"},
+  {"watch",     ARG_KEY_WATCH, "MODE:ADDR", 0,  "Set a r, w or rw watchpoint at [ADDR], optionally ADDR-END,CONDITION or io for all IO registers e.g. w:C000,VAL==0 (may be repeated)"},
   {"exitbreak", 'e', 0,      0,  "Exit when breakpoint or hung"},
+  {"history",   ARG_KEY_HISTORY, "FILE", 0,  "Write the instruction history to [FILE] whenever a breakpoint stops execution, or on a crash"},
+  {"nohistory", ARG_KEY_NO_HISTORY, 0,   0,  "Don't record the instruction history"},
   {"debugLog",  'd', "FILE", 0,  "Output Gameboy-Doctor compatible log to [FILE]" },
+  {"binaryLog", ARG_KEY_BINARY_LOG, "FILE", 0,  "Output a compact binary Gameboy-Doctor log to [FILE], convert with doctorlog" },
   {"mooneye",   'm', 0,      0,  "Enable mooneye test suite mode" },
   {"verbose",   'v', 0,      0,  "Enable verbose logging"},
+  {"scan",      's', "DIR",  0,  "Index all ROMs under [DIR] and exit"},
+  {"index",     ARG_KEY_INDEX,  "FILE", 0,  "Use [FILE] as the ROM index for --scan (default DIR/" ROMDB_DEFAULT_INDEX ")"},
+  {"verify",    ARG_KEY_VERIFY, 0,      0,  "Verify global checksums when loading or scanning ROMs"},
+  {"trace",     ARG_KEY_TRACE,  "FILE", 0,  "Write a Chrome trace-event timeline of the PPU, interrupts, DMA and host frames to [FILE]"},
+  {"fastForward", ARG_KEY_FAST_FORWARD, "SPEED", 0,  "Run at [SPEED] times normal while fast-forwarding (F key), 0 or max for unlimited (default 4)"},
+#ifdef GAMEGIRL_PROFILE
+  {"hotspots",  ARG_KEY_HOTSPOTS, "FILE", 0,  "Sample the guest PC and write collapsed stacks to [FILE] on exit"},
+  {"sample",    ARG_KEY_SAMPLE,   "N",    0,  "Take a hot spot sample every [N] cpu cycles (default 64)"},
+#endif
   { 0 }
 };
 
@@ -39,14 +71,22 @@ struct ArgResult
 {
   char *romFilename;
   bool console;
-  bool breakpointSet;
-  int breakpoint;
   bool exitOnBreak;
   bool autoRun;
   bool fastBoot;
   char *debugLog;
+  bool binaryLog;
   bool mooneye;
   bool verbose;
+  char *scanDir;
+  char *scanIndex;
+  bool scanVerify;
+  char *hotspots;
+  int sampleCycles;
+  char *traceFile;
+  int fastForwardSpeed;
+  char *historyFile;
+  bool noHistory;
 };
 
 // argp callback to process a single option
@@ -71,11 +111,36 @@ static error_t argpParser(int key, char *arg, struct argp_state *state)
       args->exitOnBreak = true;
       break;
     case 'b':
-      args->breakpointSet = true;
-      sscanf(arg,"%x", &args->breakpoint);
+      if( SUCCESS != breakpointAdd(BREAK_EXEC, arg) ) {
+        argp_error(state, "invalid breakpoint '%s'", arg);
+      }
+      break;
+    case ARG_KEY_WATCH:
+      {
+        uint8_t kinds = 0;
+        const char *spec = strchr(arg, ':');
+        for(const char *mode = arg; (NULL != spec) && (mode < spec); mode++) {
+          kinds |= ('r' == *mode)? BREAK_READ : ('w' == *mode)? BREAK_WRITE : 0xFF;
+        }
+        if( (NULL == spec) || (0 == kinds) || (0 != (kinds & ~(BREAK_READ | BREAK_WRITE)))
+         || (SUCCESS != breakpointAdd(kinds, spec+1)) ) {
+          argp_error(state, "invalid watchpoint '%s', expected r, w or rw:ADDR", arg);
+        }
+      }
+      break;
+    case ARG_KEY_HISTORY:
+      args->historyFile = arg;
+      break;
+    case ARG_KEY_NO_HISTORY:
+      args->noHistory = true;
       break;
     case 'd':
       args->debugLog = arg;
+      args->binaryLog = false;
+      break;
+    case ARG_KEY_BINARY_LOG:
+      args->debugLog = arg;
+      args->binaryLog = true;
       break;
     case 'm':
       args->mooneye = true;
@@ -83,6 +148,35 @@ static error_t argpParser(int key, char *arg, struct argp_state *state)
     case 'v':
       args->verbose = true;
       break;
+    case 's':
+      args->scanDir = arg;
+      break;
+    case ARG_KEY_INDEX:
+      args->scanIndex = arg;
+      break;
+    case ARG_KEY_VERIFY:
+      args->scanVerify = true;
+      break;
+    case ARG_KEY_HOTSPOTS:
+      args->hotspots = arg;
+      break;
+    case ARG_KEY_SAMPLE:
+      args->sampleCycles = atoi(arg);
+      break;
+    case ARG_KEY_TRACE:
+      args->traceFile = arg;
+      break;
+    case ARG_KEY_FAST_FORWARD:
+      if( 0 == strcmp("max", arg) ) {
+        args->fastForwardSpeed = 0;
+      } else {
+        char *end;
+        args->fastForwardSpeed = (int)strtol(arg, &end, 10);
+        if( ('\0' != *end) || (0 > args->fastForwardSpeed) ) {
+          argp_error(state, "fast-forward speed must be a multiplier or max, not '%s'", arg);
+        }
+      }
+      break;
     case ARGP_KEY_ARG:
       args->romFilename = arg;
       break;
@@ -96,25 +190,22 @@ static error_t argpParser(int key, char *arg, struct argp_state *state)
   return 0;
 }
 
-FILE *doctorLogFile = NULL;
-bool serialConsole = false;
-bool exitOnBreak = false;
-bool running = false;
-bool mooneye = false;
-bool fastBoot = false;
-
 int main(int argc, char **argv)
 {
     struct ArgResult args;
     memset(&args, 0, sizeof(args));
+    args.fastForwardSpeed = EMULATION_DEFAULT_FAST_FORWARD;
 
     // parse args
     argp_parse(&argp_config, argc, argv, 0, 0, &args);
 
+    if(0 != args.scanDir) {
+        exit(romDbScan(args.scanDir, args.scanIndex, args.scanVerify, args.verbose));
+    }
+
     if(0 != args.debugLog) {
-        printf("Enabling Gameboy-Doctor log output to '%s'\n", args.debugLog);
-        if( NULL == (doctorLogFile = fopen(args.debugLog, "w")) ) {
-            printf("Error opening debug log file!\n");
+        printf("Enabling %sGameboy-Doctor log output to '%s'\n", (args.binaryLog)? "binary " : "", args.debugLog);
+        if( SUCCESS != doctorLogOpen(args.debugLog, (args.binaryLog)? DOCTOR_LOG_BINARY : DOCTOR_LOG_TEXT) ) {
             exit(1);
         }
     }
@@ -151,18 +242,40 @@ int main(int argc, char **argv)
         mooneye = true;
     }
 
-    systemBreakpoint = (args.breakpointSet)? args.breakpoint : 0xFFFF;
+    if(true == args.scanVerify) {
+        verifyRomChecksum = true;
+    }
+
+    fastForwardSpeed = args.fastForwardSpeed;
 
     guiInit();
 
     gbInit(args.romFilename);
 
+    if(0 != args.hotspots) {
+        profileStartSampling((0 < args.sampleCycles)? args.sampleCycles : PROFILE_DEFAULT_SAMPLE_CYCLES);
+    }
+    if(0 != args.traceFile) {
+        traceStart(args.traceFile);
+    }
+#ifndef GAMEGIRL_NO_HISTORY
+    if(false == args.noHistory) {
+        historyStart();
+    }
+#endif
+    if(0 != args.historyFile) {
+        historyDumpOnBreak(args.historyFile);
+    }
+
     int result = gui();
 
-    gbDeinit();
-    if(NULL != doctorLogFile) {
-        fclose(doctorLogFile);
+    traceStop();
+    profileDump(stdout);
+    if(0 != args.hotspots) {
+        profileWriteHotspots(args.hotspots);
     }
+    gbDeinit();
+    doctorLogClose();
 
     if(mooneye) {
         if( 42 == result ) {
@@ -6,13 +6,18 @@
 
 #include "gb.h"
 #include "gui.h"
+#include "romfile.h"
+#include "history.h"
 
 #define BYTES_PER_LINE  (16)
 #define LINE_HEIGHT     (18)
 #define PADDING         (4)
 #define MAXVIEWS        (8)
+#define VISIBLE_LINES   (16+1)
+#define RECENT_FRAMES   (60)    // how long a changed byte stays highlighted
 
-typedef void (guiDrawMemLine)(Vector2 anchor, int view, int lineNum);
+// Copies a line's bytes, returns how many there are (0 past the end of the view)
+typedef int (memReadLine)(int view, int lineNum, uint8_t * const bytes);
 
 struct {
     memViewType type;
@@ -26,7 +31,7 @@ struct {
     int highlight_offset;
     int highlight_length;
     Vector2 scrollPosition;
-    guiDrawMemLine *lineDrawFunction;
+    memReadLine *lineReadFunction;
 } memView[MAXVIEWS];
 static int numMemViews = 0;
 static char memViewNames[128];
@@ -39,6 +44,54 @@ struct {
 static int numRegViews = 0;
 static char regViewNames[128];
 
+// The visible lines of the selected memory view, formatted once and only changed when their
+//  bytes do.  Lines live at lineNum % VISIBLE_LINES, so scrolling only loads the lines
+//  scrolled in.
+typedef struct {
+    int lineNum;            // -1 when empty
+    int length;
+    uint32_t lastChanged;   // frame any byte last changed, 0 for never
+    uint32_t changed[BYTES_PER_LINE];
+    uint8_t bytes[BYTES_PER_LINE];
+    uint8_t contentFlags[BYTES_PER_LINE];  // ROM views, named so the ROM_* macros work on a line
+    char header[8];
+} MemLine;
+
+static struct {
+    int view;
+    uint32_t frame;
+    bool romHighlight;
+    uint32_t romFlagsGeneration;
+    uint32_t revision;      // bumped whenever anything the lines are drawn from changes
+    MemLine lines[VISIBLE_LINES];
+} memLines;
+
+static char hexText[256][3];    // every byte's digits, formatted once
+static int memSelectedView = 0;
+
+// Copies of what the views show, taken by guiSnapshotMemRegViews with the emulation lock held
+//  so the views can be drawn without it.  Only the selected view's visible lines are copied,
+//  plus a page either side so scrolling has something to show until the next snapshot.  The
+//  CPU's view is copied a page at a time when the page may have changed.  ROM never changes so
+//  it's read in place, but its contentFlags do as code is found at runtime, so they're copied.
+#define SNAPSHOT_MARGIN (256/BYTES_PER_LINE)
+#define SNAPSHOT_LINES  (VISIBLE_LINES + 2*SNAPSHOT_MARGIN)
+
+static struct {
+    int view;                       // that the lines are from, -1 for none yet
+    int firstLine;
+    int numLines;
+    bool pageValid[256];
+    uint32_t generation[256];       // memPageGeneration as of each page's copy
+    uint32_t mapGeneration[256];    // memMapGeneration as of each page's copy
+    uint8_t cpu[65536];
+    uint8_t ram[SNAPSHOT_LINES * BYTES_PER_LINE];
+    bool romHighlight;              // only once the background analysis is done with contentFlags
+    uint32_t romFlagsGeneration;
+    uint8_t romFlags[SNAPSHOT_LINES * BYTES_PER_LINE];
+    uint8_t *regValues[MAXVIEWS];   // register view values, NULL for custom views
+} memSnapshot;
+
 static void updateMemViewNames(void)
 {
     int offset=0;
@@ -71,9 +124,9 @@ void setMemViewHighlight(int viewNum, int offset, int length)
 }
 
 
-static Color guiRomHighlightColor(const RomImage * const rom, int offset)
+static Color guiRomHighlightColor(const MemLine * const line, int offset)
 {
-    switch(ROM_CONTENTTYPE(rom, offset)) {
+    switch(ROM_CONTENTTYPE(line, offset)) {
         case ROM_CONTENT_INVALID:
             return ColorAlpha(RED, 0.3);
         case ROM_CONTENT_DATA:
@@ -94,63 +147,68 @@ static Color guiRomHighlightColor(const RomImage * const rom, int offset)
 }
 
 
-static void guiDrawRomLine(Vector2 anchor, int view, int lineNum)
+static void guiDrawRomHighlight(const MemLine * const line, const int index, const Vector2 anchor)
 {
-    const RomImage * const rom = memView[view].rom;
-    int offset = lineNum * BYTES_PER_LINE;
-    if( offset >= memView[view].rom->size) {
-        return;
+    Color highlightColor = guiRomHighlightColor(line, index);
+    Rectangle highlightRect = {anchor.x-FONTWIDTH/2, anchor.y-1, FONTWIDTH*3-1, LINE_HEIGHT-1};
+    if ( ROM_HAS_MOREBYTES(line, index) && ((BYTES_PER_LINE/2-1) != index) && ((BYTES_PER_LINE-1) != index) ) {
+        highlightRect.width += 1;
+    }
+    DrawRectangleRec(highlightRect, highlightColor);
+    if( ROM_IS_CODE(line, index) ) {
+        Color lineColor = ROM_IS_JUMPDEST(line, index)?GREEN:GRAY;
+        if( (ROM_CONTENT_OPCODE == ROM_CONTENTTYPE(line, index))
+            || ROM_CONTENT_PREFIX == ROM_CONTENTTYPE(line, index) ) {
+            DrawLine(highlightRect.x+1,highlightRect.y,
+                    highlightRect.x+1,highlightRect.y+highlightRect.height,
+                    lineColor);
+        }
+        DrawLine(highlightRect.x, highlightRect.y+1,
+                 highlightRect.x+highlightRect.width/2, highlightRect.y+1,
+                 lineColor);
+        DrawLine(highlightRect.x, highlightRect.y+highlightRect.height,
+                 highlightRect.x+highlightRect.width/2, highlightRect.y+highlightRect.height,
+                 lineColor);
+        lineColor = (ROM_IS_ENDCODE(line, index))? RED: GRAY;
+        DrawLine(highlightRect.x+highlightRect.width/2, highlightRect.y+1,
+                 highlightRect.x+highlightRect.width, highlightRect.y+1,
+                 lineColor);
+        DrawLine(highlightRect.x+highlightRect.width/2, highlightRect.y+highlightRect.height,
+                 highlightRect.x+highlightRect.width, highlightRect.y+highlightRect.height,
+                 lineColor);
+        if( ROM_HAS_MOREBYTES(line, index) ) {
+            // when using highlightcolor again here, it has the really nice effect of just
+            //  darkening the highlight a little bit since its drawing another line with alpha on top
+            //  of existing highlightcolor
+            lineColor = highlightColor;
+        }
+        DrawLine(highlightRect.x+highlightRect.width, highlightRect.y,
+                highlightRect.x+highlightRect.width, highlightRect.y+highlightRect.height,
+                lineColor);
     }
-    const int maxOffset = MIN(offset + BYTES_PER_LINE, rom->size);
+}
+
+static void guiDrawMemLine(Vector2 anchor, const int view, const MemLine * const line)
+{
     anchor.y += 1;
 
     // line header
-    DrawTextEx(firaFont, TextFormat("%04X |", offset + memView[view].addrOffset),  anchor, FONTSIZE, 0, BLACK);
+    DrawTextEx(firaFont, line->header, anchor, FONTSIZE, 0, BLACK);
     anchor.x += (FONTWIDTH*7);
 
-    for(int index=0; offset < maxOffset; index++, offset++) {
-        /* Disable memory type highlighting for now
-        Color highlightColor = guiRomHighlightColor(rom, offset);
-        Rectangle highlightRect = {anchor.x-FONTWIDTH/2, anchor.y-1, FONTWIDTH*3-1, LINE_HEIGHT-1};
-        if ( ROM_HAS_MOREBYTES(rom, offset) && ((BYTES_PER_LINE/2-1) != index) && ((BYTES_PER_LINE-1) != index) ) {
-            highlightRect.width += 1;
-        }
-        DrawRectangleRec(highlightRect, highlightColor);
-        if( ROM_IS_CODE(rom, offset) ) {
-            Color lineColor = ROM_IS_JUMPDEST(rom, offset)?GREEN:GRAY;
-            if( (ROM_CONTENT_OPCODE == ROM_CONTENTTYPE(rom, offset))
-                || ROM_CONTENT_PREFIX == ROM_CONTENTTYPE(rom, offset) ) {
-                DrawLine(highlightRect.x+1,highlightRect.y,
-                        highlightRect.x+1,highlightRect.y+highlightRect.height,
-                        lineColor);
-            }
-            DrawLine(highlightRect.x, highlightRect.y+1,
-                     highlightRect.x+highlightRect.width/2, highlightRect.y+1,
-                     lineColor);
-            DrawLine(highlightRect.x, highlightRect.y+highlightRect.height,
-                     highlightRect.x+highlightRect.width/2, highlightRect.y+highlightRect.height,
-                     lineColor);
-            lineColor = (ROM_IS_ENDCODE(rom, offset))? RED: GRAY;
-            DrawLine(highlightRect.x+highlightRect.width/2, highlightRect.y+1,
-                     highlightRect.x+highlightRect.width, highlightRect.y+1,
-                     lineColor);
-            DrawLine(highlightRect.x+highlightRect.width/2, highlightRect.y+highlightRect.height,
-                     highlightRect.x+highlightRect.width, highlightRect.y+highlightRect.height,
-                     lineColor);
-            if( ROM_HAS_MOREBYTES(rom, offset) ) {
-                // when using highlightcolor again here, it has the really nice effect of just
-                //  darkening the highlight a little bit since its drawing another line with alpha on top
-                //  of existing highlightcolor
-                lineColor = highlightColor;
-            }
-            DrawLine(highlightRect.x+highlightRect.width, highlightRect.y,
-                    highlightRect.x+highlightRect.width, highlightRect.y+highlightRect.height,
-                    lineColor);
-
-        } */
+    const bool romHighlight = (ROM_VIEW == memView[view].type) && memLines.romHighlight;
 
-        uint8_t data = rom->contents[offset];
-        DrawTextEx(firaFont, TextFormat("%02X", data), anchor, FONTSIZE, 0, BLACK);
+    for(int index=0; index < line->length; index++) {
+        if( romHighlight ) {
+            guiDrawRomHighlight(line, index, anchor);
+        }
+        const uint32_t age = memLines.frame - line->changed[index];
+        if( (0 != line->changed[index]) && (RECENT_FRAMES > age) ) {
+            // recently written, fading out
+            DrawRectangleRec((Rectangle){anchor.x-FONTWIDTH/2, anchor.y-1, FONTWIDTH*3-1, LINE_HEIGHT-1},
+                            ColorAlpha(ORANGE, 0.6f * (RECENT_FRAMES - age) / RECENT_FRAMES));
+        }
+        DrawTextEx(firaFont, hexText[line->bytes[index]], anchor, FONTSIZE, 0, BLACK);
         anchor.x += FONTWIDTH*3;
         if( (BYTES_PER_LINE/2-1) == index ) {
             DrawTextEx(firaFont, ":",  anchor, FONTSIZE, 0, BLACK);
@@ -159,51 +217,191 @@ static void guiDrawRomLine(Vector2 anchor, int view, int lineNum)
     }
 }
 
-static void guiDrawRamLine(Vector2 anchor, int view, int lineNum)
+// Whether the last snapshot has the line, lines scrolled past it show up with the next one
+static bool memSnapshotHasLine(const int view, const int lineNum)
+{
+    return (view == memSnapshot.view) && (lineNum >= memSnapshot.firstLine)
+        && (lineNum < memSnapshot.firstLine + memSnapshot.numLines);
+}
+
+static int memReadRomLine(int view, int lineNum, uint8_t * const bytes)
+{
+    const RomImage * const rom = memView[view].rom;
+    const int offset = lineNum * BYTES_PER_LINE;
+    if( offset >= rom->size ) {
+        return 0;
+    }
+    if( !memSnapshotHasLine(view, lineNum) ) {
+        return -1;  // for its contentFlags
+    }
+    const int length = MIN(BYTES_PER_LINE, rom->size - offset);
+    memcpy(bytes, &rom->contents[offset], length);
+    return length;
+}
+
+static int memReadRamLine(int view, int lineNum, uint8_t * const bytes)
 {
     const RamImage * const ram = memView[view].ram;
-    int offset = lineNum * BYTES_PER_LINE;
-    if( offset >= memView[view].rom->size) {
-        return;
+    const int offset = lineNum * BYTES_PER_LINE;
+    if( offset >= ram->size ) {
+        return 0;
     }
-    const int maxOffset = MIN(offset + BYTES_PER_LINE, ram->size);
-    anchor.y += 1;
+    if( !memSnapshotHasLine(view, lineNum) ) {
+        return -1;
+    }
+    const int length = MIN(BYTES_PER_LINE, ram->size - offset);
+    memcpy(bytes, &memSnapshot.ram[(lineNum - memSnapshot.firstLine) * BYTES_PER_LINE], length);
+    return length;
+}
 
-    // line header
-    DrawTextEx(firaFont, TextFormat("%04X |", offset + memView[view].addrOffset),  anchor, FONTSIZE, 0, BLACK);
-    anchor.x += (FONTWIDTH*7);
+static int memReadCpuLine(int view, int lineNum, uint8_t * const bytes)
+{
+    const int offset = lineNum * BYTES_PER_LINE;
+    if( offset >= 65536 ) {
+        return 0;
+    }
+    if( !memSnapshotHasLine(view, lineNum) ) {
+        return -1;
+    }
+    memcpy(bytes, &memSnapshot.cpu[offset], BYTES_PER_LINE);
+    return BYTES_PER_LINE;
+}
 
-    for(int index=0; offset < maxOffset; index++, offset++) {
-        uint8_t data = ram->contents[offset];
-        DrawTextEx(firaFont, TextFormat("%02X", data), anchor, FONTSIZE, 0, BLACK);
-        anchor.x += FONTWIDTH*3;
-        if( (BYTES_PER_LINE/2-1) == index ) {
-            DrawTextEx(firaFont, ":",  anchor, FONTSIZE, 0, BLACK);
-            anchor.x += FONTWIDTH*2;
+// Pages that change without the CPU writing them: cartridge RAM (RTC), OAM (DMA) and IO
+static bool memPageVolatile(const int page)
+{
+    return ((0xA0 <= page) && (0xBF >= page)) || (0xFE <= page);
+}
+
+// Pages a bank switch (or the boot ROM) changes: ROM and cartridge RAM
+static bool memPageBanked(const int page)
+{
+    return (0x80 > page) || ((0xA0 <= page) && (0xBF >= page));
+}
+
+static int memViewStartLine(const int view)
+{
+    const int scrollY = floor(memView[view].scrollPosition.y);
+    return -(scrollY/LINE_HEIGHT);
+}
+
+// With the emulation lock held, see memSnapshot
+void guiSnapshotMemRegViews(void)
+{
+    const int selected = memSelectedView;
+    memSnapshot.view = selected;
+    memSnapshot.firstLine = MAX(0, memViewStartLine(selected) - SNAPSHOT_MARGIN);
+    memSnapshot.numLines = MAX(0, MIN(SNAPSHOT_LINES, (int)ceilf(memView[selected].lines) - memSnapshot.firstLine));
+    const int offset = memSnapshot.firstLine * BYTES_PER_LINE;
+    const int length = memSnapshot.numLines * BYTES_PER_LINE;
+
+    if( (MEM_VIEW == memView[selected].type) && (0 < length) ) {
+        for(int page = (offset >> 8); page <= ((offset + length - 1) >> 8); page++) {
+            if( !memSnapshot.pageValid[page] || memPageVolatile(page)
+                || (memPageGeneration[page] != memSnapshot.generation[page])
+                || (memPageBanked(page) && (memMapGeneration != memSnapshot.mapGeneration[page])) ) {
+                memSnapshot.pageValid[page] = true;
+                memSnapshot.generation[page] = memPageGeneration[page];
+                memSnapshot.mapGeneration[page] = memMapGeneration;
+                for(int index = 0; index < 256; index++) {
+                    memSnapshot.cpu[(page << 8) + index] = getMem8((page << 8) + index);
+                }
+            }
+        }
+    } else if( (RAM_VIEW == memView[selected].type) && (0 < length) ) {
+        const RamImage * const ram = memView[selected].ram;
+        memcpy(memSnapshot.ram, &ram->contents[offset], MAX(0, MIN(length, ram->size - offset)));
+    } else if( ROM_VIEW == memView[selected].type ) {
+        // runtime code discovery changes contentFlags on the emulation thread
+        const RomImage * const rom = memView[selected].rom;
+        memSnapshot.romHighlight = romAnalysisDone(rom);
+        memSnapshot.romFlagsGeneration = rom->flagsGeneration;
+        if( memSnapshot.romHighlight && (0 < length) ) {
+            memcpy(memSnapshot.romFlags, &rom->contentFlags[offset], MAX(0, MIN(length, rom->size - offset)));
+        }
+    }
+
+    for(int view = 0; view < numRegViews; view++) {
+        const RegViewList * const list = regView[view].view;
+        if( NULL != list->guiDrawCustomRegLine ) {
+            continue;   // draws from its own copy
+        }
+        if( NULL == memSnapshot.regValues[view] ) {
+            memSnapshot.regValues[view] = (uint8_t *)MemAlloc(list->regCount);
+        }
+        if( NULL != memSnapshot.regValues[view] ) {
+            for(int reg = 0; reg < list->regCount; reg++) {
+                if( NULL != list->regs[reg].value ) {
+                    memSnapshot.regValues[view][reg] = *list->regs[reg].value;
+                }
+            }
         }
     }
+
+    guiSnapshotHistoryView();
 }
 
-static void guiDrawCpuMemLine(Vector2 anchor, int view, int lineNum)
+// Brings the visible lines up to date from memSnapshot, bumping memLines.revision if anything changed
+static void memUpdateLines(const int view, const int startLine)
 {
-    int offset = lineNum * BYTES_PER_LINE;
-    if( offset >= 65536) {
-        return;
+    memLines.frame++;
+    if( view != memLines.view ) {
+        memLines.view = view;
+        for(int row = 0; row < VISIBLE_LINES; row++) {
+            memLines.lines[row].lineNum = -1;
+        }
+        memLines.revision++;
+    }
+    const bool romView = (ROM_VIEW == memView[view].type);
+    bool romFlagsChanged = false;
+    if( romView && ((memSnapshot.romHighlight != memLines.romHighlight)
+                    || (memSnapshot.romFlagsGeneration != memLines.romFlagsGeneration)) ) {
+        memLines.romHighlight = memSnapshot.romHighlight;
+        memLines.romFlagsGeneration = memSnapshot.romFlagsGeneration;
+        romFlagsChanged = true;
+        memLines.revision++;
     }
-    const int maxOffset = MIN(offset + BYTES_PER_LINE, 65536);
-    anchor.y += 1;
 
-    // line header
-    DrawTextEx(firaFont, TextFormat("%04X |", offset),  anchor, FONTSIZE, 0, BLACK);
-    anchor.x += (FONTWIDTH*7);
+    for( int viewRow = 0; viewRow < VISIBLE_LINES; viewRow++ ) {
+        const int lineNum = startLine + viewRow;
+        MemLine * const line = &memLines.lines[lineNum % VISIBLE_LINES];
+
+        if( lineNum != line->lineNum ) {
+            // scrolled in
+            line->length = memView[view].lineReadFunction(view, lineNum, line->bytes);
+            line->lastChanged = 0;
+            memset(line->changed, 0, sizeof(line->changed));
+            if( 0 > line->length ) {
+                // not in the snapshot yet, left empty until it is
+                line->lineNum = -1;
+                line->length = 0;
+                line->header[0] = '\0';
+            } else {
+                line->lineNum = lineNum;
+                snprintf(line->header, sizeof(line->header), "%04X |", (lineNum * BYTES_PER_LINE + memView[view].addrOffset) & 0xFFFF);
+                if( romView ) {
+                    memcpy(line->contentFlags, &memSnapshot.romFlags[(lineNum - memSnapshot.firstLine) * BYTES_PER_LINE], line->length);
+                }
+            }
+            memLines.revision++;
+            continue;
+        }
+        if( romFlagsChanged && memSnapshotHasLine(view, lineNum) ) {
+            memcpy(line->contentFlags, &memSnapshot.romFlags[(lineNum - memSnapshot.firstLine) * BYTES_PER_LINE], line->length);
+        }
 
-    for(int index=0; offset < maxOffset; index++, offset++) {
-        uint8_t data = getMem8(offset);
-        DrawTextEx(firaFont, TextFormat("%02X", data), anchor, FONTSIZE, 0, BLACK);
-        anchor.x += FONTWIDTH*3;
-        if( (BYTES_PER_LINE/2-1) == index ) {
-            DrawTextEx(firaFont, ":",  anchor, FONTSIZE, 0, BLACK);
-            anchor.x += FONTWIDTH*2;
+        uint8_t bytes[BYTES_PER_LINE];
+        const int length = memView[view].lineReadFunction(view, lineNum, bytes);
+        for(int index = 0; index < length; index++) {
+            if( bytes[index] != line->bytes[index] ) {
+                line->bytes[index] = bytes[index];
+                line->changed[index] = memLines.frame;
+                line->lastChanged = memLines.frame;
+            }
+        }
+        if( (0 != line->lastChanged) && (RECENT_FRAMES >= (memLines.frame - line->lastChanged)) ) {
+            // new or still fading
+            memLines.revision++;
         }
     }
 }
@@ -216,7 +414,7 @@ void addRomView(RomImage *rom, const char * const name, uint16_t addrOffset)
     memView[numMemViews].name = name;
     memView[numMemViews].addrOffset = addrOffset;
     memView[numMemViews].highlight_length = 0;
-    memView[numMemViews].lineDrawFunction = guiDrawRomLine;
+    memView[numMemViews].lineReadFunction = memReadRomLine;
     numMemViews++;
     updateMemViewNames();
 }
@@ -229,7 +427,7 @@ void addRamView(RamImage *ram, const char * const name, uint16_t addrOffset)
     memView[numMemViews].name = name;
     memView[numMemViews].addrOffset = addrOffset;
     memView[numMemViews].highlight_length = 0;
-    memView[numMemViews].lineDrawFunction = guiDrawRamLine;
+    memView[numMemViews].lineReadFunction = memReadRamLine;
     numMemViews++;
     updateMemViewNames();
 }
@@ -245,9 +443,9 @@ void addRegView(const RegViewList *view, const char * const name)
 
 Vector2 guiDrawMemView(const Vector2 viewAnchor)
 {
-    static int selectedView = 0;
-
+    int selectedView = memSelectedView;
     GuiToggleGroup(ANCHOR_RECT(viewAnchor, 0, 0, 50, 20), memViewNames, &selectedView);
+    memSelectedView = selectedView;
 
     Rectangle contentSize = {
         0, 0,
@@ -260,17 +458,27 @@ Vector2 guiDrawMemView(const Vector2 viewAnchor)
                     NULL, contentSize, &memView[selectedView].scrollPosition, &viewPort);
 
     int scrollY = floor(memView[selectedView].scrollPosition.y);
-    int startLine = -(scrollY/LINE_HEIGHT);
+    int startLine = memViewStartLine(selectedView);
     float scrollOffset = scrollY % LINE_HEIGHT;
 
     //DrawText(TextFormat("[%f, %d, %d]", memView[selectedView].scrollPosition.y, scrollY, startLine), 4, 4, 20, RED);
 
-    BeginScissorMode(viewPort.x, viewPort.y, viewPort.width, viewPort.height);
-        for( int viewRow = 0 ; viewRow < 16+1; viewRow++ ) {
-            Vector2 lineAnchor = {viewAnchor.x+PADDING, viewPort.y+PADDING+scrollOffset+viewRow*LINE_HEIGHT};
-            memView[selectedView].lineDrawFunction(lineAnchor, selectedView, startLine+viewRow);
+    // The lines are drawn relative to the viewport into a cache, which clips them the way
+    //  a scissor would, and only redrawn when the bytes they show change
+    memUpdateLines(selectedView, startLine);
+    static PanelCache cache;
+    uint64_t key = guiPanelHash(PANEL_HASH_SEED, &memLines.revision, sizeof(memLines.revision));
+    key = guiPanelHash(key, &memLines.romFlagsGeneration, sizeof(memLines.romFlagsGeneration));
+    key = guiPanelHash(key, &startLine, sizeof(startLine));
+    key = guiPanelHash(key, &scrollOffset, sizeof(scrollOffset));
+    if( guiPanelCacheBegin(&cache, (Vector2){ viewPort.width, viewPort.height }, key, GetColor(GuiGetStyle(DEFAULT, BACKGROUND_COLOR))) ) {
+        for( int viewRow = 0 ; viewRow < VISIBLE_LINES; viewRow++ ) {
+            Vector2 lineAnchor = {viewAnchor.x+PADDING-viewPort.x, PADDING+scrollOffset+viewRow*LINE_HEIGHT};
+            guiDrawMemLine(lineAnchor, selectedView, &memLines.lines[(startLine+viewRow) % VISIBLE_LINES]);
         }
-    EndScissorMode();
+        guiPanelCacheEnd();
+    }
+    guiPanelCacheDraw(&cache, (Vector2){ viewPort.x, viewPort.y });
 
     return (Vector2){480, 16*LINE_HEIGHT+PADDING*2 + 24};
 }
@@ -311,7 +519,7 @@ Status loadRom(RomImage * const rom, const char * const filename, int entrypoint
 {
     memset(rom, 0, sizeof(RomImage));
 
-    rom->contents = LoadFileData(filename, &(rom->size));
+    rom->contents = loadRomFileData(filename, &(rom->size));
     if( NULL == rom->contents ) {
         return FAILURE;
     }
@@ -325,6 +533,7 @@ Status loadRom(RomImage * const rom, const char * const filename, int entrypoint
 
 void unloadRom(RomImage * const rom)
 {
+    romAnalysisWait(rom);
     UnloadFileData(rom->contents);
     MemFree(rom->contentFlags);
     memset(rom, 0, sizeof(RomImage));
@@ -334,17 +543,33 @@ void unloadRom(RomImage * const rom)
 
 void memInit(void)
 {
+    for(int view = 0; view < MAXVIEWS; view++) {
+        if( NULL != memSnapshot.regValues[view] ) {
+            MemFree(memSnapshot.regValues[view]);
+        }
+    }
+    memset(&memSnapshot, 0, sizeof(memSnapshot));
+    memSnapshot.view = -1;
+    memSelectedView = 0;
     memset(memView, 0, sizeof(memView));
     memset(memViewNames, 0, sizeof(memViewNames));
     memset(regView, 0, sizeof(regView));
     memset(regViewNames, 0, sizeof(regViewNames));
+    numMemViews = 0;
+    numRegViews = 0;
+
+    memset(&memLines, 0, sizeof(memLines));
+    memLines.view = -1;
+    for(int value = 0; value < 256; value++) {
+        snprintf(hexText[value], sizeof(hexText[value]), "%02X", value);
+    }
 
     // Add main cpu memory view
     memView[0].type = MEM_VIEW;
     memView[0].lines = (float)65536 / BYTES_PER_LINE;
     memView[0].name = "MEM";
     memView[0].highlight_length = 0;
-    memView[0].lineDrawFunction = guiDrawCpuMemLine;
+    memView[0].lineReadFunction = memReadCpuLine;
     numMemViews++;
     updateMemViewNames();
 }
@@ -414,7 +639,7 @@ Vector2 guiDrawHexReg(const Vector2 viewAnchor, const RegViewFields regFields, i
 }
 
 // Draws a line representing a register's name, its offset, and all of its fields
-Vector2 guiDrawHexRegLine(const Vector2 viewAnchor, RegView regv)
+Vector2 guiDrawHexRegLine(const Vector2 viewAnchor, RegView regv, const uint8_t value)
 {
     Vector2 anchor = viewAnchor;
     Vector2 size;
@@ -440,7 +665,7 @@ Vector2 guiDrawHexRegLine(const Vector2 viewAnchor, RegView regv)
 
         anchor.x += (FONTWIDTH*6);
         anchor.y = viewAnchor.y;
-        size = guiDrawHexReg(anchor, regv.fields, *regv.value);
+        size = guiDrawHexReg(anchor, regv.fields, value);
 
         anchor.x += size.x;
     }
@@ -467,19 +692,39 @@ Vector2 guiDrawRegView(const Vector2 viewAnchor)
     int startView = -(scrollY/currentView->lineHeight);
     float scrollOffset = scrollY % ((int)(currentView->lineHeight));
 
-    BeginScissorMode(viewPort.x, viewPort.y, viewPort.width, viewPort.height);
-        for( int viewRow = 0 ; viewRow < 16+1; viewRow++ ) {
-            Vector2 lineAnchor = {viewAnchor.x+PADDING, viewPort.y+PADDING+scrollOffset+viewRow*currentView->lineHeight};
-            if( startView + viewRow < currentView->regCount ) {
-                if( NULL != currentView->guiDrawCustomRegLine ) {
+    if( NULL != currentView->guiDrawCustomRegLine ) {
+        // custom lines can show anything, so they're always drawn
+        BeginScissorMode(viewPort.x, viewPort.y, viewPort.width, viewPort.height);
+            for( int viewRow = 0 ; viewRow < 16+1; viewRow++ ) {
+                Vector2 lineAnchor = {viewAnchor.x+PADDING, viewPort.y+PADDING+scrollOffset+viewRow*currentView->lineHeight};
+                if( startView + viewRow < currentView->regCount ) {
                     currentView->guiDrawCustomRegLine(lineAnchor, startView+viewRow);
-                } else {
-                    RegView regv = currentView->regs[startView+viewRow];
-                    guiDrawHexRegLine(lineAnchor, regv);
                 }
             }
+        EndScissorMode();
+    } else if( NULL != memSnapshot.regValues[selectedView] ) {
+        // otherwise cached like the memory views, and redrawn when a visible register changes
+        const uint8_t * const values = memSnapshot.regValues[selectedView];
+        static PanelCache cache;
+        uint64_t key = guiPanelHash(PANEL_HASH_SEED, &selectedView, sizeof(selectedView));
+        key = guiPanelHash(key, &startView, sizeof(startView));
+        key = guiPanelHash(key, &scrollOffset, sizeof(scrollOffset));
+        for( int viewRow = 0 ; (viewRow < 16+1) && (startView + viewRow < currentView->regCount); viewRow++ ) {
+            if( NULL != currentView->regs[startView+viewRow].value ) {
+                key = guiPanelHash(key, &values[startView+viewRow], 1);
+            }
         }
-    EndScissorMode();
+        if( guiPanelCacheBegin(&cache, (Vector2){ viewPort.width, viewPort.height }, key, GetColor(GuiGetStyle(DEFAULT, BACKGROUND_COLOR))) ) {
+            for( int viewRow = 0 ; viewRow < 16+1; viewRow++ ) {
+                Vector2 lineAnchor = {viewAnchor.x+PADDING-viewPort.x, PADDING+scrollOffset+viewRow*currentView->lineHeight};
+                if( startView + viewRow < currentView->regCount ) {
+                    guiDrawHexRegLine(lineAnchor, currentView->regs[startView+viewRow], values[startView+viewRow]);
+                }
+            }
+            guiPanelCacheEnd();
+        }
+        guiPanelCacheDraw(&cache, (Vector2){ viewPort.x, viewPort.y });
+    }
 
     return (Vector2){480, 9*FONTSIZE*2+PADDING*2 + 24};
 }
@@ -488,14 +733,16 @@ Vector2 guiDrawMemRegViews(const Vector2 viewAnchor)
 {
     static int selectedView = 0;
 
-    GuiToggleGroup(ANCHOR_RECT(viewAnchor, 0, 0, 100, 20), "MEMORY;REGISTERS", &selectedView);
+    GuiToggleGroup(ANCHOR_RECT(viewAnchor, 0, 0, 100, 20), "MEMORY;REGISTERS;HISTORY", &selectedView);
 
     Vector2 anchor = { viewAnchor.x, viewAnchor.y+24 };
     Vector2 size;
     if(0 == selectedView) {
         size = guiDrawMemView(anchor);
-    } else {
+    } else if(1 == selectedView) {
         size = guiDrawRegView(anchor);
+    } else {
+        size = guiDrawHistoryView(anchor);
     }
 
     return (Vector2){size.x, size.y+24};
@@ -58,6 +58,7 @@ void addRamView(RamImage *ram, const char * const name, uint16_t addrOffset);
 void addRegView(const RegViewList *view, const char * const name);
 
 void setMemViewHighlight(int viewNum, int offset, int length);
+void guiSnapshotMemRegViews(void);
 Vector2 guiDrawMemView(const Vector2 anchor);
 Vector2 guiDrawRegView(const Vector2 viewAnchor);
 Vector2 guiDrawMemRegViews(const Vector2 viewAnchor);
@@ -73,7 +74,7 @@ void unloadRom(RomImage * const rom);
 
 Vector2 guiDrawRegField(const Vector2 anchor, float minCharWidth, const char *label, const char *content);
 Vector2 guiDrawHexReg(const Vector2 viewAnchor, const RegViewFields regView, int value);
-Vector2 guiDrawHexRegLine(const Vector2 viewAnchor, RegView regv);
+Vector2 guiDrawHexRegLine(const Vector2 viewAnchor, RegView regv, const uint8_t value);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,224 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "profile.h"
+
+#ifdef GAMEGIRL_PROFILE
+
+#define PROFILE_PLAIN       (0)
+#define PROFILE_PREFIXED    (1)
+
+static struct {
+    uint64_t count[2][256];
+    uint64_t cycles[2][256];
+    uint64_t haltedCycles;
+} profile;
+
+// Called once per executed instruction, clocks covers everything from decode through
+//  fetching the next opcode.  CB prefixed instructions are counted once, under the
+//  prefixed opcode, including the cycles of the prefix itself.
+void profileOpcode(const uint8_t opcode, const uint8_t cbOpcode, const uint64_t clocks)
+{
+    const int table = (0xCB == opcode)? PROFILE_PREFIXED : PROFILE_PLAIN;
+    const uint8_t index = (PROFILE_PREFIXED == table)? cbOpcode : opcode;
+    profile.count[table][index]++;
+    profile.cycles[table][index] += clocks / MAIN_CLOCKS_PER_CPU_CYCLE;
+}
+
+void profileHalted(void)
+{
+    profile.haltedCycles++;
+}
+
+void profileReset(void)
+{
+    memset(&profile, 0, sizeof(profile));
+}
+
+typedef struct {
+    uint16_t opcode;    // CB prefixed opcodes are 0xCB00 | op
+    uint64_t count;
+    uint64_t cycles;
+} ProfileRow;
+
+static int compareRows(const void *a, const void *b)
+{
+    const ProfileRow *rowA = (const ProfileRow *)a;
+    const ProfileRow *rowB = (const ProfileRow *)b;
+    if( rowA->cycles != rowB->cycles ) {
+        return (rowA->cycles < rowB->cycles)? 1 : -1;
+    }
+    return (rowA->count < rowB->count)? 1 : (rowA->count > rowB->count)? -1 : 0;
+}
+
+// Prints every opcode that ran, most cycles first
+void profileDump(FILE *file)
+{
+    static ProfileRow rows[512];
+    int numRows = 0;
+    uint64_t totalCount = 0;
+    uint64_t totalCycles = profile.haltedCycles;
+
+    for(int table = PROFILE_PLAIN; table <= PROFILE_PREFIXED; table++) {
+        for(int index = 0; index < 256; index++) {
+            if( 0 != profile.count[table][index] ) {
+                rows[numRows].opcode = (PROFILE_PREFIXED == table)? (0xCB00 | index) : index;
+                rows[numRows].count = profile.count[table][index];
+                rows[numRows].cycles = profile.cycles[table][index];
+                totalCount += rows[numRows].count;
+                totalCycles += rows[numRows].cycles;
+                numRows++;
+            }
+        }
+    }
+    qsort(rows, numRows, sizeof(ProfileRow), compareRows);
+
+    fprintf(file, "Opcode profile: %llu instructions, %llu cycles (%llu halted)\n",
+        (unsigned long long)totalCount, (unsigned long long)totalCycles, (unsigned long long)profile.haltedCycles);
+    fprintf(file, "%-6s %-16s %14s %7s %14s %7s %8s\n", "op", "instruction", "count", "%", "cycles", "%", "cyc/op");
+    for(int row = 0; row < numRows; row++) {
+        // operands are shown as zero, only the mnemonic matters here
+        const bool prefixed = (0xFF < rows[row].opcode);
+        const uint8_t code[3] = { (prefixed)? 0xCB : (uint8_t)rows[row].opcode, (prefixed)? (uint8_t)rows[row].opcode : 0, 0 };
+        char name[32];
+        disassemble2(name, code, 0);
+        fprintf(file, "%-6.*X %-16s %14llu %6.2f%% %14llu %6.2f%% %8.2f\n",
+            (prefixed)? 4 : 2, rows[row].opcode, name,
+            (unsigned long long)rows[row].count, 100.0 * rows[row].count / MAX(1, totalCount),
+            (unsigned long long)rows[row].cycles, 100.0 * rows[row].cycles / MAX(1, totalCycles),
+            (double)rows[row].cycles / rows[row].count);
+    }
+}
+
+// Guest hot spots
+//
+// Every `interval` main clocks the executing PC is charged one sample.  Cartridge code is
+//  kept by rom offset so the same address in different banks stays apart, everything else
+//  (boot rom, code running from RAM) by cpu address.
+
+extern RomImage bootrom;
+
+static struct {
+    uint64_t interval;          // main clocks between samples, 0 when not sampling
+    uint64_t nextClock;
+    uint32_t *rom;              // per cartridge rom offset
+    int romSize;
+    uint32_t boot[0x100];
+    uint32_t bus[0x10000];      // by cpu address, for anything that isn't cartridge rom
+} samples;
+
+void profileStartSampling(const int cycles)
+{
+    samples.interval = (uint64_t)MAX(1, cycles) * MAIN_CLOCKS_PER_CPU_CYCLE;
+    samples.nextClock = mainClock + samples.interval;
+}
+
+// Called with the PC of every executed instruction (and while halted)
+void profileSample(const uint16_t pc)
+{
+    if( (0 == samples.interval) || (mainClock < samples.nextClock) ) {
+        return;
+    }
+    // weight by however many intervals this instruction spanned
+    const uint32_t count = 1 + (mainClock - samples.nextClock) / samples.interval;
+    samples.nextClock += count * samples.interval;
+
+    if( bootRomActive && (pc < 0x100) ) {
+        samples.boot[pc] += count;
+        return;
+    }
+    const int offset = cartRomOffset(pc);
+    if( 0 <= offset ) {
+        if( NULL == samples.rom ) {
+            samples.romSize = cartRomImage()->size;
+            samples.rom = (uint32_t *)MemAlloc(samples.romSize * sizeof(uint32_t));
+            memset(samples.rom, 0, samples.romSize * sizeof(uint32_t));
+        }
+        if( offset < samples.romSize ) {
+            samples.rom[offset] += count;
+            return;
+        }
+    }
+    samples.bus[pc] += count;
+}
+
+// nearest label at or before offset without leaving its 16K bank, -1 if there isn't one
+static int labelForOffset(const RomImage * const rom, const int offset)
+{
+    // labels come from the background analysis, don't race it
+    if( (NULL == rom) || !romAnalysisDone(rom) || (offset >= rom->size) ) {
+        return -1;
+    }
+    for(int label = offset; label >= (offset & ~0x3FFF); label--) {
+        if( ROM_IS_JUMPDEST(rom, label) ) {
+            return label;
+        }
+    }
+    return -1;
+}
+
+static const char *busRegionName(const uint16_t addr)
+{
+    if( addr <= 0x7FFF ) { return "OPENBUS"; }
+    if( addr <= 0x9FFF ) { return "VRAM"; }
+    if( addr <= 0xBFFF ) { return "CARTRAM"; }
+    if( addr <= 0xFDFF ) { return "WRAM"; }
+    if( addr <= 0xFEFF ) { return "OAM"; }
+    if( addr <= 0xFF7F ) { return "IO"; }
+    return "HRAM";
+}
+
+// Writes the samples as collapsed stacks, one "region;label;pc count" line per sampled PC,
+//  ready for flamegraph.pl, speedscope or inferno.  Labels match disassembleRom's LABEL_xxxx.
+Status profileWriteHotspots(const char * const filename)
+{
+    FILE *file = fopen(filename, "w");
+    if( NULL == file ) {
+        printf("Unable to write hot spots to '%s'\n", filename);
+        return FAILURE;
+    }
+
+    for(int pc = 0; pc < NUM_ELEMENTS(samples.boot); pc++) {
+        if( 0 != samples.boot[pc] ) {
+            const int label = labelForOffset(&bootrom, pc);
+            if( 0 <= label ) {
+                fprintf(file, "BOOT;LABEL_%04X;%04X %u\n", label, pc, samples.boot[pc]);
+            } else {
+                fprintf(file, "BOOT;%04X %u\n", pc, samples.boot[pc]);
+            }
+        }
+    }
+
+    const RomImage * const rom = cartRomImage();
+    for(int offset = 0; offset < samples.romSize; offset++) {
+        if( 0 != samples.rom[offset] ) {
+            // same address mapping disassembleRom uses for its labels
+            const uint16_t addr = (offset < 0x4000)? offset : (0x4000 | (offset & 0x3FFF));
+            const int label = labelForOffset(rom, offset);
+            if( 0 <= label ) {
+                const uint16_t labelAddr = (label < 0x4000)? label : (0x4000 | (label & 0x3FFF));
+                fprintf(file, "ROM%02X;LABEL_%04X;%04X %u\n", offset >> 14, labelAddr, addr, samples.rom[offset]);
+            } else {
+                fprintf(file, "ROM%02X;%04X %u\n", offset >> 14, addr, samples.rom[offset]);
+            }
+        }
+    }
+
+    for(int pc = 0; pc < NUM_ELEMENTS(samples.bus); pc++) {
+        if( 0 != samples.bus[pc] ) {
+            fprintf(file, "%s;%04X %u\n", busRegionName(pc), pc, samples.bus[pc]);
+        }
+    }
+
+    fclose(file);
+    MemFree(samples.rom);
+    memset(&samples, 0, sizeof(samples));
+    printf("Hot spot samples written to '%s'\n", filename);
+    return SUCCESS;
+}
+
+#endif // GAMEGIRL_PROFILE
@@ -0,0 +1,45 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include "gb_types.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROFILE_DEFAULT_SAMPLE_CYCLES   (64)
+
+// Per-opcode execution counts and cycles plus guest PC sampling, only built with
+//  GAMEGIRL_PROFILE (premake5 --profile).  Without it every call compiles away to nothing.
+#ifdef GAMEGIRL_PROFILE
+void profileOpcode(const uint8_t opcode, const uint8_t cbOpcode, const uint64_t clocks);
+void profileHalted(void);
+void profileReset(void);
+void profileDump(FILE *file);
+
+void profileStartSampling(const int cycles);
+void profileSample(const uint16_t pc);
+Status profileWriteHotspots(const char * const filename);
+#else
+#define profileOpcode(opcode, cbOpcode, clocks)
+#define profileHalted()
+#define profileReset()
+#define profileDump(file)
+
+#define profileStartSampling(cycles)
+#define profileSample(pc)
+#define profileWriteHotspots(filename)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PROFILE_H__
@@ -0,0 +1,344 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "rewind.h"
+#include "doctorlog.h"
+#include "history.h"
+#include <time.h>
+
+// Reverse execution
+//
+// While the emulation thread runs it copies every registered piece of machine state into a
+//  ring of checkpoints, one every rewindState.spacing instructions.  Going back restores the
+//  nearest checkpoint before the target and runs forward again to it, replaying the joypad
+//  changes logged along the way, so the machine ends up exactly where it was.  instructionCount
+//  is the timeline, a target is a number of executeInstruction calls since reset.
+//
+// The spacing is however many instructions the emulator gets through in REWIND_LATENCY_NS,
+//  measured on every frame it runs, so stepping back never takes much more than half a frame.
+//  Continuing back replays one checkpoint's worth at a time, newest first, until it finds an
+//  instruction a breakpoint stopped after.
+//
+// screenData isn't part of a checkpoint, the screen keeps showing the last frame presented.
+
+#define REWIND_REGIONS          (64)
+#define REWIND_CHECKPOINTS      (256)
+#define REWIND_CONTROL_LOG      (4096)
+#define REWIND_LATENCY_NS       (8000000)   // about half a frame
+#define REWIND_DEFAULT_SPACING  (100000)    // until the first frame has been measured
+#define REWIND_MIN_SPACING      (1000)
+#define REWIND_MIN_SAMPLE       (1000)      // shorter runs than this are too noisy to measure
+
+typedef struct {
+    void *data;
+    size_t size;
+} RewindRegion;
+
+typedef struct {
+    uint64_t instruction;
+    uint8_t *state;
+} Checkpoint;
+
+typedef struct {
+    uint64_t instruction;   // applied before this instruction is executed
+    ControlState controls;
+} ControlChange;
+
+bool rewindReplaying = false;
+
+static struct {
+    RewindRegion regions[REWIND_REGIONS];
+    int numRegions;
+    size_t stateSize;
+
+    Checkpoint checkpoints[REWIND_CHECKPOINTS];     // ring, oldest first
+    int firstCheckpoint;
+    int numCheckpoints;
+
+    ControlChange controls[REWIND_CONTROL_LOG];     // ring, oldest first
+    int firstControl;
+    int numControls;
+
+    uint64_t spacing;
+    double nsPerInstruction;    // 0 until measured
+    uint64_t frameStartNs;
+    uint64_t frameStartInstruction;
+} rewindState;
+
+static uint64_t rewindNowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static Checkpoint *rewindCheckpointAt(const int index)
+{
+    return &rewindState.checkpoints[(rewindState.firstCheckpoint + index) % REWIND_CHECKPOINTS];
+}
+
+static ControlChange *rewindControlAt(const int index)
+{
+    return &rewindState.controls[(rewindState.firstControl + index) % REWIND_CONTROL_LOG];
+}
+
+void addRewindState(void * const data, const size_t size)
+{
+    for(int index = 0; index < rewindState.numRegions; index++) {
+        if( data == rewindState.regions[index].data ) {
+            return;
+        }
+    }
+    if( REWIND_REGIONS <= rewindState.numRegions ) {
+        printf("Too much rewind state, only %d regions can be added\n", REWIND_REGIONS);
+        return;
+    }
+    // checkpoints taken so far don't have it
+    rewindReset();
+    rewindState.regions[rewindState.numRegions].data = data;
+    rewindState.regions[rewindState.numRegions].size = size;
+    rewindState.numRegions++;
+    rewindState.stateSize += size;
+}
+
+void rewindReset(void)
+{
+    for(int index = 0; index < REWIND_CHECKPOINTS; index++) {
+        if( NULL != rewindState.checkpoints[index].state ) {
+            MemFree(rewindState.checkpoints[index].state);
+        }
+        rewindState.checkpoints[index].state = NULL;
+    }
+    rewindState.firstCheckpoint = 0;
+    rewindState.numCheckpoints = 0;
+    rewindState.firstControl = 0;
+    rewindState.numControls = 0;
+}
+
+void rewindInit(void)
+{
+    rewindReset();
+    memset(rewindState.regions, 0, sizeof(rewindState.regions));
+    rewindState.numRegions = 0;
+    rewindState.stateSize = 0;
+    rewindState.spacing = REWIND_DEFAULT_SPACING;
+    rewindState.nsPerInstruction = 0;
+    rewindReplaying = false;
+}
+
+void rewindDeinit(void)
+{
+    rewindReset();
+}
+
+// Folds a timed run of instructions into the spacing
+static void rewindMeasure(const uint64_t instructions, const uint64_t ns)
+{
+    if( REWIND_MIN_SAMPLE > instructions ) {
+        return;
+    }
+    const double sample = (double)ns / instructions;
+    if( 0 == rewindState.nsPerInstruction ) {
+        rewindState.nsPerInstruction = sample;
+    } else {
+        rewindState.nsPerInstruction += (sample - rewindState.nsPerInstruction) / 8;
+    }
+    rewindState.spacing = MAX(REWIND_MIN_SPACING, (uint64_t)(REWIND_LATENCY_NS / rewindState.nsPerInstruction));
+}
+
+void rewindBeginFrame(void)
+{
+    rewindState.frameStartNs = rewindNowNs();
+    rewindState.frameStartInstruction = instructionCount;
+}
+
+// Drops the joypad changes from before the oldest checkpoint, nothing will replay them
+static void rewindTrimControls(void)
+{
+    const uint64_t oldest = rewindCheckpointAt(0)->instruction;
+    while( (0 < rewindState.numControls) && (rewindControlAt(0)->instruction < oldest) ) {
+        rewindState.firstControl = (rewindState.firstControl + 1) % REWIND_CONTROL_LOG;
+        rewindState.numControls--;
+    }
+}
+
+static void rewindDropOldest(void)
+{
+    rewindState.firstCheckpoint = (rewindState.firstCheckpoint + 1) % REWIND_CHECKPOINTS;
+    rewindState.numCheckpoints--;
+}
+
+void rewindCheckpoint(void)
+{
+    if( instructionCount > rewindState.frameStartInstruction ) {
+        rewindMeasure(instructionCount - rewindState.frameStartInstruction, rewindNowNs() - rewindState.frameStartNs);
+    }
+
+    if( 0 < rewindState.numCheckpoints ) {
+        const uint64_t newest = rewindCheckpointAt(rewindState.numCheckpoints-1)->instruction;
+        if( instructionCount < newest ) {
+            // the cpu was reset under us
+            rewindReset();
+        } else if( instructionCount < (newest + rewindState.spacing) ) {
+            return;
+        }
+    }
+
+    if( REWIND_CHECKPOINTS == rewindState.numCheckpoints ) {
+        rewindDropOldest();
+    }
+    Checkpoint * const checkpoint = rewindCheckpointAt(rewindState.numCheckpoints);
+    if( NULL == checkpoint->state ) {
+        checkpoint->state = (uint8_t *)MemAlloc(rewindState.stateSize);
+        if( NULL == checkpoint->state ) {
+            printf("Unable to allocate a rewind checkpoint\n");
+            return;
+        }
+    }
+    checkpoint->instruction = instructionCount;
+    uint8_t *state = checkpoint->state;
+    for(int index = 0; index < rewindState.numRegions; index++) {
+        memcpy(state, rewindState.regions[index].data, rewindState.regions[index].size);
+        state += rewindState.regions[index].size;
+    }
+    rewindState.numCheckpoints++;
+    rewindTrimControls();
+}
+
+void rewindRecordControls(const ControlState controls)
+{
+    if( rewindReplaying || (0 == rewindState.numCheckpoints) ) {
+        return;
+    }
+    if( REWIND_CONTROL_LOG == rewindState.numControls ) {
+        // history from before the oldest change left can't be replayed any more
+        const uint64_t lost = rewindControlAt(0)->instruction;
+        while( (0 < rewindState.numCheckpoints) && (rewindCheckpointAt(0)->instruction <= lost) ) {
+            rewindDropOldest();
+        }
+        rewindState.firstControl = (rewindState.firstControl + 1) % REWIND_CONTROL_LOG;
+        rewindState.numControls--;
+    }
+    ControlChange * const change = rewindControlAt(rewindState.numControls);
+    change->instruction = instructionCount;
+    change->controls = controls;
+    rewindState.numControls++;
+}
+
+static void rewindRestore(const Checkpoint * const checkpoint)
+{
+    historyRewound();
+    const uint8_t *state = checkpoint->state;
+    for(int index = 0; index < rewindState.numRegions; index++) {
+        memcpy(rewindState.regions[index].data, state, rewindState.regions[index].size);
+        state += rewindState.regions[index].size;
+    }
+    // nothing cached from before can be trusted
+    for(int page = 0; page < 256; page++) {
+        memPageGeneration[page]++;
+    }
+    memMapGeneration++;
+    displayStateRestored();
+}
+
+// Runs forward from a restored checkpoint to target.  Returns the last instruction a
+//  breakpoint stopped after on the way, 0 if none did.  An invalid opcode hanging the cpu
+//  isn't a breakpoint, the timeline already ran on past it, so replay does too.
+static uint64_t rewindReplay(const uint64_t target)
+{
+    int control = 0;
+    while( (control < rewindState.numControls) && (rewindControlAt(control)->instruction < instructionCount) ) {
+        control++;
+    }
+
+    const bool logging = doctorLogEnabled;
+    doctorLogEnabled = false;
+    displaySkipFrame = true;
+    rewindReplaying = true;
+
+    const uint64_t start = instructionCount;
+    const uint64_t startNs = rewindNowNs();
+    uint64_t lastBreak = 0;
+    while( instructionCount < target ) {
+        while( (control < rewindState.numControls) && (rewindControlAt(control)->instruction <= instructionCount) ) {
+            updateControls(rewindControlAt(control)->controls);
+            control++;
+        }
+        if( executeInstruction() && !cpuHung ) {
+            lastBreak = instructionCount;
+        }
+    }
+    rewindMeasure(instructionCount - start, rewindNowNs() - startNs);
+
+    rewindReplaying = false;
+    displaySkipFrame = false;
+    doctorLogEnabled = logging;
+    // only half a frame was drawn, don't present it
+    guiUpdateScreen = false;
+    return lastBreak;
+}
+
+// Forgets the future, running on from here may not go the same way
+static void rewindTruncate(void)
+{
+    while( (0 < rewindState.numCheckpoints)
+        && (rewindCheckpointAt(rewindState.numCheckpoints-1)->instruction > instructionCount) ) {
+        rewindState.numCheckpoints--;
+    }
+    while( (0 < rewindState.numControls)
+        && (rewindControlAt(rewindState.numControls-1)->instruction >= instructionCount) ) {
+        rewindState.numControls--;
+    }
+}
+
+Status rewindStep(void)
+{
+    if( 0 == instructionCount ) {
+        return FAILURE;
+    }
+    const uint64_t target = instructionCount - 1;
+    for(int index = rewindState.numCheckpoints-1; index >= 0; index--) {
+        const Checkpoint * const checkpoint = rewindCheckpointAt(index);
+        if( checkpoint->instruction <= target ) {
+            rewindRestore(checkpoint);
+            rewindReplay(target);
+            rewindTruncate();
+            return SUCCESS;
+        }
+    }
+    printf("No history to step back into\n");
+    return FAILURE;
+}
+
+Status rewindContinue(void)
+{
+    if( 0 == rewindState.numCheckpoints ) {
+        printf("No history to continue back into\n");
+        return FAILURE;
+    }
+    // each checkpoint covers the instructions up to and including the next one's
+    uint64_t end = instructionCount - 1;
+    for(int index = rewindState.numCheckpoints-1; index >= 0; index--) {
+        const Checkpoint * const checkpoint = rewindCheckpointAt(index);
+        if( checkpoint->instruction > end ) {
+            continue;
+        }
+        rewindRestore(checkpoint);
+        const uint64_t hit = rewindReplay(end);
+        if( 0 != hit ) {
+            rewindRestore(checkpoint);
+            rewindReplay(hit);
+            rewindTruncate();
+            return SUCCESS;
+        }
+        end = checkpoint->instruction;
+    }
+    printf("No earlier breakpoint, stopped at the oldest checkpoint\n");
+    rewindRestore(rewindCheckpointAt(0));
+    rewindTruncate();
+    return SUCCESS;
+}
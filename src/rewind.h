@@ -0,0 +1,45 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __REWIND_H__
+#define __REWIND_H__
+
+#include "gb_types.h"
+#include "controls.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Machine state a checkpoint copies, each module adds its own from its init.  Adding the same
+//  data again is ignored.
+void addRewindState(void * const data, const size_t size);
+#define ADD_REWIND_STATE(var)   addRewindState(&(var), sizeof(var))
+
+void rewindInit(void);
+void rewindDeinit(void);
+// Forgets all history, for when the machine is changed other than by running it
+void rewindReset(void);
+
+// The emulation thread brackets everything it runs with these, with the lock held
+void rewindBeginFrame(void);
+void rewindCheckpoint(void);
+// Every change of the joypad, so history can be re-executed with the same input
+void rewindRecordControls(const ControlState controls);
+
+// Set while history is being re-executed, anything that reaches outside the machine (the
+//  serial console, breakpoint reports) should keep quiet
+extern bool rewindReplaying;
+
+// Back one instruction, or back to the previous instruction a breakpoint stopped after
+Status rewindStep(void);
+Status rewindContinue(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__REWIND_H__
@@ -0,0 +1,177 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "romcache.h"
+#include "romdb.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Code/data analysis cache
+//
+// A sidecar file next to the ROM holds its contentFlags, keyed by a hash of the ROM contents.
+//  The file is memory mapped and used as the contentFlags array directly, so anything the
+//  analysis or the running cpu marks is persisted without an explicit save.  Windows has no
+//  mmap, so there the cache is read into memory and written back once the analysis finishes
+//  and again when the ROM is unloaded.
+
+#define ROMCACHE_MAGIC      (0x43434747)   // "GGCC"
+#define ROMCACHE_VERSION    (1)
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash;
+    uint32_t size;
+    uint32_t analyzed;      // static analysis ran to completion
+} RomCacheHeader;
+
+static struct {
+    RomImage *rom;          // atomic, every ROM's analysis thread checks it
+    RomCacheHeader *header;
+    size_t length;
+#ifdef _WIN32
+    char filename[1024];
+#endif
+} cache;
+
+#ifdef _WIN32
+// Reads the whole cache file into memory, valid is false if it is missing or the wrong size
+static RomCacheHeader *romCacheRead(const char * const filename, const size_t length, bool * const valid)
+{
+    RomCacheHeader *header = (RomCacheHeader *)MemAlloc(length);
+    FILE *file = fopen(filename, "rb");
+    *valid = (NULL != file) && (1 == fread(header, length, 1, file)) && (EOF == fgetc(file));
+    if( NULL != file ) {
+        fclose(file);
+    }
+    return header;
+}
+
+static void romCacheWrite(void)
+{
+    FILE *file = fopen(cache.filename, "wb");
+    if( (NULL == file) || (1 != fwrite(cache.header, cache.length, 1, file)) ) {
+        printf("Unable to write the analysis cache '%s'\n", cache.filename);
+    }
+    if( NULL != file ) {
+        fclose(file);
+    }
+}
+#else
+// Maps the cache file, creating it at the right size if needed
+static RomCacheHeader *romCacheMap(const char * const filename, const size_t length, bool * const valid)
+{
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if( 0 > fd ) {
+        return NULL;
+    }
+
+    struct stat st;
+    *valid = (0 == fstat(fd, &st)) && (length == (size_t)st.st_size);
+    if( !*valid && (0 != ftruncate(fd, length)) ) {
+        close(fd);
+        return NULL;
+    }
+
+    RomCacheHeader *header = (RomCacheHeader *)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (MAP_FAILED == header)? NULL : header;
+}
+#endif
+
+// Switches rom->contentFlags over to the mapped cache for this ROM.
+// Returns true if the cache already holds a complete analysis
+bool romCacheAttach(RomImage * const rom, const char * const romFilename)
+{
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%s%s", romFilename, ROMCACHE_EXTENSION);
+
+    if( NULL != cache.rom ) {
+        romCacheDetach(cache.rom);
+    }
+
+    const uint64_t hash = romDbHash(ROMDB_HASH_SEED, rom->contents, rom->size);
+    const size_t length = sizeof(RomCacheHeader) + rom->size;
+
+    bool valid = false;
+#ifdef _WIN32
+    RomCacheHeader *header = romCacheRead(filename, length, &valid);
+    snprintf(cache.filename, sizeof(cache.filename), "%s", filename);
+#else
+    RomCacheHeader *header = romCacheMap(filename, length, &valid);
+#endif
+    if( NULL == header ) {
+        printf("    analysis cache...UNAVAILABLE\n");
+        return false;
+    }
+
+    valid = valid && (ROMCACHE_MAGIC == header->magic) && (ROMCACHE_VERSION == header->version)
+                  && (hash == header->hash) && (rom->size == header->size);
+    uint8_t * const flags = (uint8_t *)&header[1];
+    if( !valid ) {
+        // stale or new, start over from the flags loadRom set up
+        header->magic = ROMCACHE_MAGIC;
+        header->version = ROMCACHE_VERSION;
+        header->hash = hash;
+        header->size = rom->size;
+        header->analyzed = 0;
+        memcpy(flags, rom->contentFlags, rom->size);
+    }
+
+    MemFree(rom->contentFlags);
+    rom->contentFlags = flags;
+    cache.header = header;
+    cache.length = length;
+    __atomic_store_n(&cache.rom, rom, __ATOMIC_RELEASE);
+
+    printf("    analysis cache...%s\n", (header->analyzed)? "HIT" : "MISS");
+    return (0 != header->analyzed);
+}
+
+// Hands rom->contentFlags back to a regular allocation and unmaps the cache
+void romCacheDetach(RomImage * const rom)
+{
+    if( rom != cache.rom ) {
+        return;
+    }
+
+    // the analysis thread must be finished with the mapping before it goes away
+    romAnalysisWait(rom);
+
+    uint8_t *flags = (uint8_t *)MemAlloc(rom->size);
+    memcpy(flags, rom->contentFlags, rom->size);
+    rom->contentFlags = flags;
+
+#ifdef _WIN32
+    romCacheWrite();
+    MemFree(cache.header);
+#else
+    msync(cache.header, cache.length, MS_ASYNC);
+    munmap(cache.header, cache.length);
+#endif
+    __atomic_store_n(&cache.rom, NULL, __ATOMIC_RELEASE);
+    cache.header = NULL;
+    cache.length = 0;
+}
+
+// Called by the analysis thread as it finishes, so a crash later on doesn't lose the result
+void romCacheAnalyzed(const RomImage * const rom)
+{
+    if( rom != __atomic_load_n(&cache.rom, __ATOMIC_ACQUIRE) ) {
+        return;
+    }
+    cache.header->analyzed = 1;
+#ifdef _WIN32
+    romCacheWrite();
+#else
+    msync(cache.header, cache.length, MS_ASYNC);
+#endif
+}
@@ -0,0 +1,26 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __ROMCACHE_H__
+#define __ROMCACHE_H__
+
+#include "gb_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ROMCACHE_EXTENSION  ".ggcache"
+
+bool romCacheAttach(RomImage * const rom, const char * const romFilename);
+void romCacheDetach(RomImage * const rom);
+void romCacheAnalyzed(const RomImage * const rom);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ROMCACHE_H__
@@ -0,0 +1,441 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "romdb.h"
+#include "romfile.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+// Library scanning
+//
+// Walks a directory tree for ROM images and keeps a compact index of their headers on disk.
+// Only the 0x150 byte header of each file is read, and only for files whose mtime or size
+//  changed since the index was last written, so rescanning a large unchanged library is
+//  mostly just the cost of walking the directories.
+// Windows has no pread, so there each worker seeks the descriptor it opened and reads with
+//  _read instead.
+
+#define ROMDB_MAGIC         (0x42444747)   // "GGDB"
+#define ROMDB_VERSION       (1)
+#define ROMDB_MAX_THREADS   (32)
+#define ROMDB_READ_CHUNK    (64*1024)
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+} RomDbFileHeader;
+
+typedef struct {
+    RomDbRecord record;
+    char *path;
+    bool valid;
+    bool updated;
+} RomDbEntry;
+
+typedef struct {
+    RomDbEntry *entries;
+    int count;
+    int capacity;
+} RomDbList;
+
+typedef struct {
+    RomDbList *found;
+    const RomDbList *previous;
+    bool verify;
+    int next;
+} RomDbScanJob;
+
+
+uint64_t romDbHash(uint64_t hash, const uint8_t * const data, const size_t size)
+{
+    // FNV-1a
+    for(size_t offset = 0; offset < size; offset++) {
+        hash ^= data[offset];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#ifdef _WIN32
+#define ROMDB_OPEN_FLAGS    (_O_RDONLY | _O_BINARY)
+#define romDbOpen           _open
+#define romDbClose          _close
+#else
+#define ROMDB_OPEN_FLAGS    (O_RDONLY)
+#define romDbOpen           open
+#define romDbClose          close
+#endif
+
+// pread, without moving a file position another thread might share
+static int64_t romDbRead(const int fd, void * const buffer, const uint32_t size, const int64_t offset)
+{
+#ifdef _WIN32
+    if( offset != _lseeki64(fd, offset, SEEK_SET) ) {
+        return -1;
+    }
+    return _read(fd, buffer, size);
+#else
+    return pread(fd, buffer, size, offset);
+#endif
+}
+
+static double elapsedMs(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec)*1000.0 + (now.tv_nsec - start->tv_nsec)/1000000.0;
+}
+
+static RomDbEntry *romDbAppend(RomDbList *list)
+{
+    if( list->count == list->capacity ) {
+        list->capacity = MAX(256, list->capacity*2);
+        list->entries = (RomDbEntry *)realloc(list->entries, list->capacity * sizeof(RomDbEntry));
+    }
+    RomDbEntry *entry = &list->entries[list->count++];
+    memset(entry, 0, sizeof(RomDbEntry));
+    return entry;
+}
+
+static void romDbFree(RomDbList *list)
+{
+    for(int index = 0; index < list->count; index++) {
+        free(list->entries[index].path);
+    }
+    free(list->entries);
+    memset(list, 0, sizeof(RomDbList));
+}
+
+static int romDbComparePath(const void *a, const void *b)
+{
+    return strcmp(((const RomDbEntry *)a)->path, ((const RomDbEntry *)b)->path);
+}
+
+static char *romDbJoinPath(const char * const directory, const char * const name)
+{
+    const size_t pathLength = strlen(directory) + 1 + strlen(name) + 1;
+    char *path = (char *)malloc(pathLength);
+    snprintf(path, pathLength, "%s/%s", directory, name);
+    return path;
+}
+
+#ifdef _WIN32
+static void romDbWalk(RomDbList *found, const char * const directory)
+{
+    char *pattern = romDbJoinPath(directory, "*");
+    struct _finddata_t findData;
+    const intptr_t find = _findfirst(pattern, &findData);
+    free(pattern);
+    if( -1 == find ) {
+        printf("Unable to open directory '%s'\n", directory);
+        return;
+    }
+
+    do {
+        if( '.' == findData.name[0] ) {
+            continue;  // hidden files, '.' and '..'
+        }
+        char *path = romDbJoinPath(directory, findData.name);
+        if( findData.attrib & _A_SUBDIR ) {
+            romDbWalk(found, path);
+            free(path);
+        } else if( isRomFilename(findData.name) ) {
+            romDbAppend(found)->path = path;
+        } else {
+            free(path);
+        }
+    } while( 0 == _findnext(find, &findData) );
+    _findclose(find);
+}
+#else
+static void romDbWalk(RomDbList *found, const char * const directory)
+{
+    DIR *dir = opendir(directory);
+    if( NULL == dir ) {
+        printf("Unable to open directory '%s'\n", directory);
+        return;
+    }
+
+    struct dirent *dirEntry;
+    while( NULL != (dirEntry = readdir(dir)) ) {
+        if( '.' == dirEntry->d_name[0] ) {
+            continue;  // hidden files, '.' and '..'
+        }
+        char *path = romDbJoinPath(directory, dirEntry->d_name);
+
+        bool isDir = (DT_DIR == dirEntry->d_type);
+        bool isFile = (DT_REG == dirEntry->d_type);
+        bool isLink = (DT_LNK == dirEntry->d_type);
+        struct stat st;
+        if( (DT_UNKNOWN == dirEntry->d_type) && (0 == lstat(path, &st)) ) {
+            isLink = S_ISLNK(st.st_mode);
+            isDir = S_ISDIR(st.st_mode);
+            isFile = S_ISREG(st.st_mode);
+        }
+        if( isLink && (0 == stat(path, &st)) ) {
+            isDir = S_ISDIR(st.st_mode);
+            isFile = S_ISREG(st.st_mode);
+        }
+
+        if( isDir && isLink ) {
+            // linked directories can lead back up the tree, only linked files are followed
+            free(path);
+        } else if( isDir ) {
+            romDbWalk(found, path);
+            free(path);
+        } else if( isFile && isRomFilename(dirEntry->d_name) ) {
+            romDbAppend(found)->path = path;
+        } else {
+            free(path);
+        }
+    }
+    closedir(dir);
+}
+#endif
+
+static Status romDbLoadIndex(RomDbList *list, const char * const filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if( NULL == file ) {
+        return FAILURE;
+    }
+
+    RomDbFileHeader header;
+    if( (1 != fread(&header, sizeof(header), 1, file))
+     || (ROMDB_MAGIC != header.magic) || (ROMDB_VERSION != header.version) ) {
+        printf("Ignoring incompatible index '%s'\n", filename);
+        fclose(file);
+        return FAILURE;
+    }
+
+    for(uint32_t index = 0; index < header.count; index++) {
+        RomDbEntry *entry = romDbAppend(list);
+        if( 1 != fread(&entry->record, sizeof(RomDbRecord), 1, file) ) {
+            list->count--;
+            break;
+        }
+        entry->path = (char *)malloc(entry->record.pathLength + 1);
+        if( entry->record.pathLength != fread(entry->path, 1, entry->record.pathLength, file) ) {
+            free(entry->path);
+            list->count--;
+            break;
+        }
+        entry->path[entry->record.pathLength] = '\0';
+        entry->valid = true;
+    }
+    fclose(file);
+
+    qsort(list->entries, list->count, sizeof(RomDbEntry), romDbComparePath);
+    return SUCCESS;
+}
+
+static Status romDbWriteIndex(const RomDbList *list, const char * const filename)
+{
+    char tempFilename[1024];
+    snprintf(tempFilename, sizeof(tempFilename), "%s.tmp", filename);
+
+    FILE *file = fopen(tempFilename, "wb");
+    if( NULL == file ) {
+        printf("Unable to write index '%s'\n", tempFilename);
+        return FAILURE;
+    }
+
+    RomDbFileHeader header = { ROMDB_MAGIC, ROMDB_VERSION, 0 };
+    for(int index = 0; index < list->count; index++) {
+        header.count += (list->entries[index].valid)? 1 : 0;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    for(int index = 0; index < list->count; index++) {
+        const RomDbEntry *entry = &list->entries[index];
+        if( entry->valid ) {
+            fwrite(&entry->record, sizeof(RomDbRecord), 1, file);
+            fwrite(entry->path, 1, entry->record.pathLength, file);
+        }
+    }
+    fclose(file);
+
+    // replace the old index in one step so an interrupted scan never leaves a partial index behind
+#ifdef _WIN32
+    remove(filename);   // rename won't replace an existing file here
+#endif
+    if( 0 != rename(tempFilename, filename) ) {
+        printf("Unable to replace index '%s'\n", filename);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+static void romDbReadEntry(RomDbEntry *entry, const struct stat *st, bool verify)
+{
+    uint8_t image[CART_HEADER_END];
+    const CartridgeHeader *header = (const CartridgeHeader *)&image[CART_HEADER_OFFSET];
+
+    int fd = romDbOpen(entry->path, ROMDB_OPEN_FLAGS);
+    if( 0 > fd ) {
+        return;
+    }
+    if( sizeof(image) != romDbRead(fd, image, sizeof(image), 0) ) {
+        romDbClose(fd);
+        return;  // too small to be a ROM
+    }
+
+    RomDbRecord *record = &entry->record;
+    memset(record, 0, sizeof(RomDbRecord));
+    record->mtime = st->st_mtime;
+    record->size = st->st_size;
+    record->globalChecksum = (header->globalChecksum >> 8) | (header->globalChecksum << 8);  // big endian
+    record->newLicensee = header->newLicensee;
+    record->oldLicensee = header->oldLicensee;
+    record->cartridgeType = header->cartridgeType;
+    record->romSize = header->romSize;
+    record->ramSize = header->ramSize;
+    if( CART_CGB_SUPPORTS_COLOR_MASK == (header->title.v2.cgbMode & CART_CGB_SUPPORTS_COLOR_MASK) ) {
+        record->cgbMode = header->title.v2.cgbMode;
+        memcpy(record->title, header->title.v2.title, sizeof(header->title.v2.title));
+    } else {
+        memcpy(record->title, header->title.v1.title, sizeof(header->title.v1.title));
+    }
+    if( cartHeaderChecksum(image) == header->headerChecksum ) {
+        record->flags |= ROMDB_FLAG_HEADER_OK;
+    }
+
+    if( verify ) {
+        // whole file pass for the global checksum and content hash
+        static __thread uint8_t chunk[ROMDB_READ_CHUNK];
+        uint64_t hash = ROMDB_HASH_SEED;
+        uint16_t checksum = 0;
+        int64_t offset = 0;
+        int64_t bytesRead;
+        while( 0 < (bytesRead = romDbRead(fd, chunk, sizeof(chunk), offset)) ) {
+            hash = romDbHash(hash, chunk, bytesRead);
+            for(int64_t index = 0; index < bytesRead; index++) {
+                checksum += chunk[index];
+            }
+            offset += bytesRead;
+        }
+        // the checksum bytes themselves are not part of the sum
+        checksum -= image[CART_GLOBAL_CHECKSUM_OFFSET] + image[CART_GLOBAL_CHECKSUM_OFFSET+1];
+        record->hash = hash;
+        record->computedChecksum = checksum;
+        record->flags |= ROMDB_FLAG_VERIFIED;
+        if( checksum == record->globalChecksum ) {
+            record->flags |= ROMDB_FLAG_GLOBAL_OK;
+        }
+    }
+    romDbClose(fd);
+
+    record->pathLength = strlen(entry->path);
+    entry->valid = true;
+    entry->updated = true;
+}
+
+static void *romDbWorker(void *arg)
+{
+    RomDbScanJob *job = (RomDbScanJob *)arg;
+    int index;
+
+    while( (index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->found->count ) {
+        RomDbEntry *entry = &job->found->entries[index];
+        struct stat st;
+        if( 0 != stat(entry->path, &st) ) {
+            continue;
+        }
+
+        // reuse the previous record if the file hasn't changed since it was indexed
+        const RomDbEntry *previous = (const RomDbEntry *)bsearch(entry, job->previous->entries,
+                                        job->previous->count, sizeof(RomDbEntry), romDbComparePath);
+        if( (NULL != previous)
+         && (previous->record.mtime == st.st_mtime) && (previous->record.size == st.st_size)
+         && (!job->verify || (0 != (previous->record.flags & ROMDB_FLAG_VERIFIED))) ) {
+            entry->record = previous->record;
+            entry->valid = true;
+        } else {
+            romDbReadEntry(entry, &st, job->verify);
+        }
+    }
+    return NULL;
+}
+
+// Scans directory for ROMs, updating indexFilename (created in directory if NULL).
+// Returns 0 on success
+int romDbScan(const char * const directory, const char * const indexFilename, bool verify, bool verbose)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    char defaultIndex[1024];
+    const char *index = indexFilename;
+    if( NULL == index ) {
+        snprintf(defaultIndex, sizeof(defaultIndex), "%s/%s", directory, ROMDB_DEFAULT_INDEX);
+        index = defaultIndex;
+    }
+
+    RomDbList previous = {0};
+    RomDbList found = {0};
+    romDbLoadIndex(&previous, index);
+    romDbWalk(&found, directory);
+
+    RomDbScanJob job = { &found, &previous, verify, 0 };
+#ifdef _WIN32
+    const long cpuCount = pthread_num_processors_np();
+#else
+    const long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    int threadCount = MAX(1, MIN(ROMDB_MAX_THREADS, (int)cpuCount));
+    threadCount = MIN(threadCount, MAX(1, found.count));
+
+    pthread_t threads[ROMDB_MAX_THREADS];
+    int started = 0;
+    while( (started < threadCount) && (0 == pthread_create(&threads[started], NULL, romDbWorker, &job)) ) {
+        started++;
+    }
+    if( 0 == started ) {
+        // no threads available, just do it now
+        romDbWorker(&job);
+    }
+    for(int thread = 0; thread < started; thread++) {
+        pthread_join(threads[thread], NULL);
+    }
+
+    qsort(found.entries, found.count, sizeof(RomDbEntry), romDbComparePath);
+
+    int valid = 0;
+    int updated = 0;
+    for(int entry = 0; entry < found.count; entry++) {
+        const RomDbEntry *rom = &found.entries[entry];
+        if( !rom->valid ) {
+            continue;
+        }
+        valid++;
+        updated += (rom->updated)? 1 : 0;
+        if( verbose ) {
+            printf("%-16.16s  type:%02X  rom:%02X  ram:%02X  %s%s  %s\n",
+                rom->record.title, rom->record.cartridgeType, rom->record.romSize, rom->record.ramSize,
+                (rom->record.flags & ROMDB_FLAG_HEADER_OK)? "hdr:OK  " : "hdr:BAD ",
+                (rom->record.flags & ROMDB_FLAG_VERIFIED)?
+                    ((rom->record.flags & ROMDB_FLAG_GLOBAL_OK)? "sum:OK " : "sum:BAD") : "sum:-- ",
+                rom->path);
+        }
+    }
+
+    Status status = romDbWriteIndex(&found, index);
+    printf("Indexed %d ROMs in '%s' (%d updated, %d unchanged) using %d threads in %.1f ms\n",
+        valid, directory, updated, valid - updated, MAX(1, started), elapsedMs(&start));
+
+    romDbFree(&previous);
+    romDbFree(&found);
+    return (SUCCESS == status)? 0 : 1;
+}
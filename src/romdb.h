@@ -0,0 +1,49 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __ROMDB_H__
+#define __ROMDB_H__
+
+#include "gb_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ROMDB_DEFAULT_INDEX     "gamegirl.romdb"
+
+#define ROMDB_FLAG_HEADER_OK    (0x01)  // header checksum matched
+#define ROMDB_FLAG_VERIFIED     (0x02)  // whole file was read, checksum & hash are valid
+#define ROMDB_FLAG_GLOBAL_OK    (0x04)  // computed global checksum matches the header
+
+// One entry per ROM in the on-disk index, followed directly by pathLength bytes of path
+typedef struct __attribute__((packed)) {
+    int64_t mtime;
+    int64_t size;
+    uint64_t hash;              // FNV-1a of the whole file, only if ROMDB_FLAG_VERIFIED
+    uint16_t globalChecksum;    // as stored in the header
+    uint16_t computedChecksum;  // only if ROMDB_FLAG_VERIFIED
+    uint16_t newLicensee;
+    uint8_t oldLicensee;
+    uint8_t cartridgeType;
+    uint8_t romSize;
+    uint8_t ramSize;
+    uint8_t cgbMode;
+    uint8_t flags;
+    char title[16];
+    uint16_t pathLength;
+} RomDbRecord;
+
+uint64_t romDbHash(uint64_t hash, const uint8_t * const data, const size_t size);
+#define ROMDB_HASH_SEED     (0xcbf29ce484222325ULL)
+
+int romDbScan(const char * const directory, const char * const indexFilename, bool verify, bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ROMDB_H__
@@ -0,0 +1,343 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "romfile.h"
+#include <strings.h>
+#ifdef GAMEGIRL_ZLIB
+#include <zlib.h>
+#endif
+#ifdef GAMEGIRL_ZSTD
+#include <zstd.h>
+#endif
+
+// Compressed ROM input
+//
+// Compressed images are decoded in a single pass directly into the ROM buffer.  The first
+//  0x150 bytes are decoded on their own so the cartridge header can be checked, and the
+//  buffer sized from it, before the rest of the file is touched.  Apart from the ROM itself
+//  the only memory used is one input chunk plus the decompressor state.
+
+#define ROMFILE_CHUNK       (64*1024)
+
+#define ZIP_LOCAL_HEADER_SIG    (0x04034b50)
+#define ZIP_LOCAL_HEADER_SIZE   (30)
+#define ZIP_FLAG_DESCRIPTOR     (0x0008)
+#define ZIP_METHOD_STORED       (0)
+#define ZIP_METHOD_DEFLATE      (8)
+
+typedef enum {
+    ROMFILE_RAW,
+    ROMFILE_GZIP,
+    ROMFILE_ZIP,
+    ROMFILE_ZSTD,
+} RomFileFormat;
+
+typedef struct RomDecoder RomDecoder;
+// Decodes up to length bytes into out, returns the number of bytes produced or -1 on error.
+//  Only returns less than length at the end of the stream
+typedef int (RomDecodeRead)(RomDecoder * const decoder, uint8_t * const out, const int length);
+
+struct RomDecoder {
+    RomDecodeRead *read;
+    FILE *file;
+    long remaining;     // compressed bytes left in the stream, -1 if unknown
+    bool finished;
+#ifdef GAMEGIRL_ZLIB
+    z_stream zstream;
+#endif
+#ifdef GAMEGIRL_ZSTD
+    ZSTD_DStream *zstd;
+    ZSTD_inBuffer zstdIn;
+#endif
+    uint8_t input[ROMFILE_CHUNK];
+};
+
+
+bool isRomFilename(const char * const name)
+{
+    static const char * const extensions[] = { ".gb", ".gbc", ".sgb" };
+    const char *ext = strrchr(name, '.');
+    if( NULL == ext ) {
+        return false;
+    }
+    for(int index = 0; index < NUM_ELEMENTS(extensions); index++) {
+        if( 0 == strcasecmp(ext, extensions[index]) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint16_t le16(const uint8_t * const bytes)
+{
+    return bytes[0] | (bytes[1] << 8);
+}
+
+static uint32_t le32(const uint8_t * const bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static RomFileFormat detectFormat(const uint8_t * const magic, const size_t length)
+{
+    if( 4 > length ) {
+        return ROMFILE_RAW;
+    } else if( (0x1f == magic[0]) && (0x8b == magic[1]) ) {
+        return ROMFILE_GZIP;
+    } else if( ZIP_LOCAL_HEADER_SIG == le32(magic) ) {
+        return ROMFILE_ZIP;
+    } else if( 0xfd2fb528 == le32(magic) ) {
+        return ROMFILE_ZSTD;
+    }
+    return ROMFILE_RAW;
+}
+
+// Refills the input chunk, returning the number of bytes available
+static size_t fillInput(RomDecoder * const decoder)
+{
+    size_t length = sizeof(decoder->input);
+    if( (0 <= decoder->remaining) && (decoder->remaining < length) ) {
+        length = decoder->remaining;
+    }
+    size_t bytesRead = fread(decoder->input, 1, length, decoder->file);
+    if( 0 <= decoder->remaining ) {
+        decoder->remaining -= bytesRead;
+    }
+    return bytesRead;
+}
+
+// zip entries that aren't compressed at all are read straight into the output
+static int storedRead(RomDecoder * const decoder, uint8_t * const out, const int length)
+{
+    int wanted = MIN(length, (int)decoder->remaining);
+    int bytesRead = fread(out, 1, wanted, decoder->file);
+    decoder->remaining -= bytesRead;
+    return bytesRead;
+}
+
+#ifdef GAMEGIRL_ZLIB
+static int inflateRead(RomDecoder * const decoder, uint8_t * const out, const int length)
+{
+    z_stream *zs = &decoder->zstream;
+    zs->next_out = out;
+    zs->avail_out = length;
+    while( (0 < zs->avail_out) && !decoder->finished ) {
+        if( 0 == zs->avail_in ) {
+            zs->next_in = decoder->input;
+            zs->avail_in = fillInput(decoder);
+            if( 0 == zs->avail_in ) {
+                printf("Compressed ROM is truncated\n");
+                return -1;
+            }
+        }
+        int result = inflate(zs, Z_NO_FLUSH);
+        if( Z_STREAM_END == result ) {
+            decoder->finished = true;
+        } else if( Z_OK != result ) {
+            printf("Error decompressing ROM: %s\n", (NULL != zs->msg)? zs->msg : "unknown");
+            return -1;
+        }
+    }
+    return length - zs->avail_out;
+}
+#endif
+
+#ifdef GAMEGIRL_ZSTD
+static int zstdRead(RomDecoder * const decoder, uint8_t * const out, const int length)
+{
+    ZSTD_outBuffer zstdOut = { out, (size_t)length, 0 };
+    while( (zstdOut.pos < zstdOut.size) && !decoder->finished ) {
+        if( decoder->zstdIn.pos == decoder->zstdIn.size ) {
+            decoder->zstdIn.src = decoder->input;
+            decoder->zstdIn.size = fillInput(decoder);
+            decoder->zstdIn.pos = 0;
+            if( 0 == decoder->zstdIn.size ) {
+                printf("Compressed ROM is truncated\n");
+                return -1;
+            }
+        }
+        size_t result = ZSTD_decompressStream(decoder->zstd, &zstdOut, &decoder->zstdIn);
+        if( ZSTD_isError(result) ) {
+            printf("Error decompressing ROM: %s\n", ZSTD_getErrorName(result));
+            return -1;
+        } else if( 0 == result ) {
+            decoder->finished = true;
+        }
+    }
+    return zstdOut.pos;
+}
+#endif
+
+// Finds the first ROM in a zip archive and leaves the file positioned at its data
+static Status zipSelectEntry(RomDecoder * const decoder, int * const method)
+{
+    uint8_t header[ZIP_LOCAL_HEADER_SIZE];
+    char name[256];
+
+    while( sizeof(header) == fread(header, 1, sizeof(header), decoder->file) ) {
+        if( ZIP_LOCAL_HEADER_SIG != le32(&header[0]) ) {
+            break;  // reached the central directory
+        }
+        uint16_t flags = le16(&header[6]);
+        uint32_t compressedSize = le32(&header[18]);
+        uint16_t nameLength = le16(&header[26]);
+        uint16_t extraLength = le16(&header[28]);
+
+        int nameRead = MIN(nameLength, sizeof(name)-1);
+        if( nameRead != fread(name, 1, nameRead, decoder->file) ) {
+            break;
+        }
+        name[nameRead] = '\0';
+        fseek(decoder->file, (nameLength - nameRead) + extraLength, SEEK_CUR);
+
+        if( isRomFilename(name) ) {
+            printf("    using '%s' from archive\n", name);
+            *method = le16(&header[8]);
+            decoder->remaining = (flags & ZIP_FLAG_DESCRIPTOR)? -1 : compressedSize;
+            return SUCCESS;
+        }
+        if( flags & ZIP_FLAG_DESCRIPTOR ) {
+            printf("Unable to skip streamed archive entry '%s'\n", name);
+            return FAILURE;
+        }
+        fseek(decoder->file, compressedSize, SEEK_CUR);
+    }
+    printf("No ROM found in archive\n");
+    return FAILURE;
+}
+
+static Status decoderInit(RomDecoder * const decoder, const RomFileFormat format)
+{
+    decoder->remaining = -1;
+    switch( format ) {
+#ifdef GAMEGIRL_ZLIB
+        case ROMFILE_GZIP:
+            decoder->read = inflateRead;
+            return (Z_OK == inflateInit2(&decoder->zstream, 15+16))? SUCCESS : FAILURE;
+        case ROMFILE_ZIP: {
+            int method;
+            if( SUCCESS != zipSelectEntry(decoder, &method) ) {
+                return FAILURE;
+            }
+            if( ZIP_METHOD_STORED == method ) {
+                if( 0 > decoder->remaining ) {
+                    return FAILURE;
+                }
+                decoder->read = storedRead;
+                return SUCCESS;
+            } else if( ZIP_METHOD_DEFLATE == method ) {
+                decoder->read = inflateRead;
+                return (Z_OK == inflateInit2(&decoder->zstream, -15))? SUCCESS : FAILURE;
+            }
+            printf("Unsupported zip compression method %d\n", method);
+            return FAILURE;
+        }
+#endif
+#ifdef GAMEGIRL_ZSTD
+        case ROMFILE_ZSTD:
+            decoder->read = zstdRead;
+            decoder->zstd = ZSTD_createDStream();
+            return (NULL != decoder->zstd)? SUCCESS : FAILURE;
+#endif
+        default:
+            printf("Support for this compressed ROM format was not built in\n");
+            return FAILURE;
+    }
+}
+
+static void decoderDeinit(RomDecoder * const decoder)
+{
+#ifdef GAMEGIRL_ZLIB
+    if( inflateRead == decoder->read ) {
+        inflateEnd(&decoder->zstream);
+    }
+#endif
+#ifdef GAMEGIRL_ZSTD
+    if( NULL != decoder->zstd ) {
+        ZSTD_freeDStream(decoder->zstd);
+    }
+#endif
+}
+
+static uint8_t *decodeRom(RomDecoder * const decoder, int * const size)
+{
+    uint8_t header[CART_HEADER_END];
+    const CartridgeHeader *cartHeader = (const CartridgeHeader *)&header[CART_HEADER_OFFSET];
+    uint8_t *contents;
+
+    int length = decoder->read(decoder, header, sizeof(header));
+    if( 0 > length ) {
+        return NULL;
+    } else if( sizeof(header) > length ) {
+        // too small to have a cartridge header (a bootrom for instance), nothing to validate
+        contents = (uint8_t *)MemAlloc(MAX(1, length));
+        memcpy(contents, header, length);
+        *size = length;
+        return contents;
+    }
+
+    // reject bad images before decoding the rest
+    if( cartHeaderChecksum(header) != cartHeader->headerChecksum ) {
+        printf("Compressed ROM has an invalid header checksum\n");
+        return NULL;
+    }
+    uint32_t capacity = cartRomBytes(cartHeader);
+    if( 0 == capacity ) {
+        printf("Compressed ROM has an unknown ROM size (%02X)\n", cartHeader->romSize);
+        return NULL;
+    }
+
+    contents = (uint8_t *)MemAlloc(capacity);
+    memcpy(contents, header, sizeof(header));
+    length = decoder->read(decoder, &contents[sizeof(header)], capacity - sizeof(header));
+    if( (capacity - sizeof(header)) != length ) {
+        if( 0 <= length ) {
+            printf("Compressed ROM is smaller than its header declares\n");
+        }
+        MemFree(contents);
+        return NULL;
+    }
+
+    // anything still left in the stream means the header lied about the size
+    uint8_t extra;
+    if( 0 != decoder->read(decoder, &extra, 1) ) {
+        printf("Compressed ROM is larger than its header declares\n");
+        MemFree(contents);
+        return NULL;
+    }
+
+    *size = capacity;
+    return contents;
+}
+
+uint8_t *loadRomFileData(const char * const filename, int * const size)
+{
+    FILE *file = fopen(filename, "rb");
+    if( NULL == file ) {
+        printf("Unable to open ROM '%s'\n", filename);
+        return NULL;
+    }
+
+    uint8_t magic[4];
+    RomFileFormat format = detectFormat(magic, fread(magic, 1, sizeof(magic), file));
+    if( ROMFILE_RAW == format ) {
+        fclose(file);
+        return LoadFileData(filename, size);
+    }
+    rewind(file);
+
+    RomDecoder *decoder = (RomDecoder *)MemAlloc(sizeof(RomDecoder));
+    decoder->file = file;
+    uint8_t *contents = NULL;
+    if( SUCCESS == decoderInit(decoder, format) ) {
+        contents = decodeRom(decoder, size);
+    }
+    decoderDeinit(decoder);
+    MemFree(decoder);
+    fclose(file);
+    return contents;
+}
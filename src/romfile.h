@@ -0,0 +1,26 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __ROMFILE_H__
+#define __ROMFILE_H__
+
+#include "gb_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool isRomFilename(const char * const name);
+
+// Loads a ROM image, transparently decompressing gzip, zip and (if built with GAMEGIRL_ZSTD) zstd files.
+// Returned data is freed with UnloadFileData()
+uint8_t *loadRomFileData(const char * const filename, int * const size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ROMFILE_H__
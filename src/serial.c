@@ -5,8 +5,9 @@
 // Copyright (c) 2025 Haley Taylor (@truehaley)
 
 #include "gb.h"
+#include "rewind.h"
 
-struct {
+static struct {
     struct {
         uint8_t val;
     } SB;
@@ -43,7 +44,7 @@ void setSerialReg8(uint16_t addr, uint8_t val8)
         regs.SB.val = val8;
     } else if (REG_SC_ADDR == addr) {
         regs.SC.val = val8;
-        if(serialConsole) {
+        if(serialConsole && !rewindReplaying) {
             if( 1 == regs.SC.transfer ) {
                 printf("%c", regs.SB.val);
                 fflush(stdout);
@@ -57,4 +58,5 @@ void serialInit(void)
 {
     memset(&regs, 0, sizeof(regs));
     regs.SC.val = 0x7E;
+    ADD_REWIND_STATE(regs);
 }
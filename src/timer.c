@@ -5,6 +5,7 @@
 // Copyright (c) 2025 Haley Taylor (@truehaley)
 
 #include "gb.h"
+#include "rewind.h"
 
 // https://gbdev.io/pandocs/Timer_Obscure_Behaviour.html
 // https://hacktix.github.io/GBEDG/timers/
@@ -174,4 +175,9 @@ void timerInit(void)
     timerClkMask = TAC_CLK0_MASK;
     overflowHappened = false;
     timaUpdated = false;
+
+    ADD_REWIND_STATE(regs);
+    ADD_REWIND_STATE(timerClkMask);
+    ADD_REWIND_STATE(overflowHappened);
+    ADD_REWIND_STATE(timaUpdated);
 }
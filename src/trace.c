@@ -0,0 +1,232 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#include "gb.h"
+#include "trace.h"
+#include <pthread.h>
+#include <time.h>
+
+// Events go into preallocated single producer / single consumer rings, one for the
+//  emulation thread and one for the GUI thread, and the producers only ever copy an event
+//  in.  Formatting and file IO happen on a background writer thread so tracing costs as
+//  little as possible of the time being measured.  If the writer falls behind, events are
+//  dropped (and counted) rather than blocking.
+
+#define TRACE_RING_SIZE     (1 << 18)
+#define TRACE_RING_MASK     (TRACE_RING_SIZE - 1)
+#define TRACE_PID_EMULATED  (1)
+#define TRACE_PID_HOST      (2)
+
+typedef enum {
+    TRACE_COMPLETE,     // "X"
+    TRACE_INSTANT,      // "i"
+} TracePhase;
+
+typedef struct {
+    uint64_t start;     // main clocks for emulated tracks, ns for host tracks
+    uint64_t duration;
+    const char *name;
+    int32_t arg;        // -1 for none
+    uint8_t track;
+    uint8_t phase;
+} TraceEvent;
+
+typedef struct {
+    bool open;
+    uint64_t start;
+    const char *name;
+    int32_t arg;
+} TraceSlice;
+
+static const char * const trackNames[NUM_TRACE_TRACKS] = {
+    [TRACE_TRACK_PPU]            = "PPU mode",
+    [TRACE_TRACK_INTERRUPTS]     = "Interrupts",
+    [TRACE_TRACK_OAM_DMA]        = "OAM DMA",
+    [TRACE_TRACK_HALT]           = "HALT",
+    [TRACE_TRACK_HOST_EMULATION] = "Emulation thread",
+    [TRACE_TRACK_HOST_FRAME]     = "Frame",
+};
+
+bool traceEnabled = false;
+
+typedef struct {
+    TraceEvent *events;
+    uint64_t head;          // written by the producing thread
+    uint64_t tail;          // written by the writer thread
+    uint64_t dropped;
+} TraceRing;
+
+#define TRACE_RING_EMULATION    (0)
+#define TRACE_RING_GUI          (1)
+
+static struct {
+    TraceRing rings[2];
+    bool stopping;
+    pthread_t writer;
+    FILE *file;
+    uint64_t hostStartNs;
+    TraceSlice slices[NUM_TRACE_TRACKS];
+} trace;
+
+static uint64_t traceHostNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec - trace.hostStartNs;
+}
+
+static uint64_t traceNow(const TraceTrack track)
+{
+    return (TRACE_FIRST_HOST_TRACK <= track)? traceHostNs() : mainClock;
+}
+
+static void tracePush(const TraceEvent * const event)
+{
+    TraceRing * const ring = &trace.rings[(TRACE_TRACK_HOST_FRAME == event->track)? TRACE_RING_GUI : TRACE_RING_EMULATION];
+    const uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if( (ring->head - tail) >= TRACE_RING_SIZE ) {
+        ring->dropped++;
+        return;
+    }
+    ring->events[ring->head & TRACE_RING_MASK] = *event;
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+void traceEnd(const TraceTrack track)
+{
+    TraceSlice * const slice = &trace.slices[track];
+    if( !slice->open ) {
+        return;
+    }
+    const uint64_t now = traceNow(track);
+    const TraceEvent event = { slice->start, now - slice->start, slice->name, slice->arg, track, TRACE_COMPLETE };
+    tracePush(&event);
+    slice->open = false;
+}
+
+void traceBegin(const TraceTrack track, const char * const name, const int arg)
+{
+    traceEnd(track);
+    TraceSlice * const slice = &trace.slices[track];
+    slice->open = true;
+    slice->start = traceNow(track);
+    slice->name = name;
+    slice->arg = arg;
+}
+
+void traceInstant(const TraceTrack track, const char * const name)
+{
+    const TraceEvent event = { traceNow(track), 0, name, -1, track, TRACE_INSTANT };
+    tracePush(&event);
+}
+
+static void traceWriteEvent(const TraceEvent * const event)
+{
+    const bool host = (TRACE_FIRST_HOST_TRACK <= event->track);
+    // microseconds, of Game Boy time for the emulated tracks
+    const double start = (host)? event->start / 1000.0 : event->start * 1e6 / MAIN_CLOCK_HZ;
+    const double duration = (host)? event->duration / 1000.0 : event->duration * 1e6 / MAIN_CLOCK_HZ;
+
+    // the metadata events always come first, so every event follows another
+    fprintf(trace.file, ",\n{\"name\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f",
+        event->name, (host)? TRACE_PID_HOST : TRACE_PID_EMULATED, event->track, start);
+    if( TRACE_COMPLETE == event->phase ) {
+        fprintf(trace.file, ",\"ph\":\"X\",\"dur\":%.3f", duration);
+    } else {
+        fprintf(trace.file, ",\"ph\":\"i\",\"s\":\"t\"");
+    }
+    if( 0 <= event->arg ) {
+        fprintf(trace.file, ",\"args\":{\"LY\":%d}", event->arg);
+    }
+    fprintf(trace.file, "}");
+}
+
+static void traceDrain(TraceRing * const ring)
+{
+    const uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = ring->tail;
+    while( tail != head ) {
+        traceWriteEvent(&ring->events[tail & TRACE_RING_MASK]);
+        tail++;
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+static void *traceWriterThread(void *arg)
+{
+    const struct timespec pause = { 0, 2000000 };   // 2ms
+    bool stopping;
+    do {
+        stopping = __atomic_load_n(&trace.stopping, __ATOMIC_ACQUIRE);
+        for(int ring = 0; ring < NUM_ELEMENTS(trace.rings); ring++) {
+            traceDrain(&trace.rings[ring]);
+        }
+        if( !stopping ) {
+            nanosleep(&pause, NULL);
+        }
+    } while( !stopping );
+    return NULL;
+}
+
+Status traceStart(const char * const filename)
+{
+    memset(&trace, 0, sizeof(trace));
+    trace.file = fopen(filename, "w");
+    if( NULL == trace.file ) {
+        printf("Unable to open trace file '%s'\n", filename);
+        return FAILURE;
+    }
+    for(int ring = 0; ring < NUM_ELEMENTS(trace.rings); ring++) {
+        trace.rings[ring].events = (TraceEvent *)MemAlloc(TRACE_RING_SIZE * sizeof(TraceEvent));
+    }
+
+    // name the processes and tracks
+    fprintf(trace.file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(trace.file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Emulated (Game Boy time)\"}},\n", TRACE_PID_EMULATED);
+    fprintf(trace.file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Host\"}}", TRACE_PID_HOST);
+    for(int track = 0; track < NUM_TRACE_TRACKS; track++) {
+        fprintf(trace.file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            (TRACE_FIRST_HOST_TRACK <= track)? TRACE_PID_HOST : TRACE_PID_EMULATED, track, trackNames[track]);
+    }
+
+    trace.hostStartNs = traceHostNs();
+    if( 0 != pthread_create(&trace.writer, NULL, traceWriterThread, NULL) ) {
+        printf("Unable to start the trace writer\n");
+        fclose(trace.file);
+        for(int ring = 0; ring < NUM_ELEMENTS(trace.rings); ring++) {
+            MemFree(trace.rings[ring].events);
+        }
+        return FAILURE;
+    }
+    traceEnabled = true;
+    printf("Tracing to '%s'\n", filename);
+    return SUCCESS;
+}
+
+void traceStop(void)
+{
+    if( !traceEnabled ) {
+        return;
+    }
+    for(int track = 0; track < NUM_TRACE_TRACKS; track++) {
+        traceEnd(track);
+    }
+    traceEnabled = false;
+
+    __atomic_store_n(&trace.stopping, true, __ATOMIC_RELEASE);
+    pthread_join(trace.writer, NULL);
+
+    fprintf(trace.file, "\n]}\n");
+    fclose(trace.file);
+    uint64_t dropped = 0;
+    for(int ring = 0; ring < NUM_ELEMENTS(trace.rings); ring++) {
+        MemFree(trace.rings[ring].events);
+        dropped += trace.rings[ring].dropped;
+    }
+    if( 0 != dropped ) {
+        printf("Trace writer fell behind, %llu events were dropped\n", (unsigned long long)dropped);
+    }
+}
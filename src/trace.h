@@ -0,0 +1,52 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "gb_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Chrome trace-event output (chrome://tracing, ui.perfetto.dev)
+//
+// Emulated tracks are timestamped from mainClock in microseconds of Game Boy time, host
+//  tracks in microseconds of wall time since tracing started.  Each track has at most one
+//  open slice, beginning a new one closes the previous.  Every track is written from the
+//  emulation thread except TRACE_TRACK_HOST_FRAME, which belongs to the GUI thread.
+typedef enum {
+    TRACE_TRACK_PPU,            // emulated, one slice per mode, per scanline
+    TRACE_TRACK_INTERRUPTS,     // emulated, instant events from setIntFlag
+    TRACE_TRACK_OAM_DMA,        // emulated
+    TRACE_TRACK_HALT,           // emulated
+    TRACE_TRACK_HOST_EMULATION, // host, emulate
+    TRACE_TRACK_HOST_FRAME,     // host, draw / present
+    NUM_TRACE_TRACKS
+} TraceTrack;
+
+#define TRACE_FIRST_HOST_TRACK  (TRACE_TRACK_HOST_EMULATION)
+
+extern bool traceEnabled;
+
+Status traceStart(const char * const filename);
+void traceStop(void);
+
+void traceBegin(const TraceTrack track, const char * const name, const int arg);
+void traceEnd(const TraceTrack track);
+void traceInstant(const TraceTrack track, const char * const name);
+
+// name must be a string literal or otherwise outlive the trace
+#define TRACE_BEGIN(track, name, arg)   do { if( traceEnabled ) { traceBegin(track, name, arg); } } while(0)
+#define TRACE_END(track)                do { if( traceEnabled ) { traceEnd(track); } } while(0)
+#define TRACE_INSTANT(track, name)      do { if( traceEnabled ) { traceInstant(track, name); } } while(0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__TRACE_H__
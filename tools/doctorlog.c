@@ -0,0 +1,130 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+// Converts a binary doctor log (gamegirl --binaryLog) to Gameboy-Doctor's text format
+//
+//  doctorlog LOG [OUTPUT]
+//
+// LOG may be zstd compressed (.zst) when built with zstd.  Text goes to stdout unless
+//  OUTPUT is given, so it can be piped straight into gameboy-doctor.
+
+#include "doctorlog_format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef GAMEGIRL_ZSTD
+#include <zstd.h>
+#endif
+
+#define DOCTORLOG_RECORDS   (64*1024)   // per read
+
+typedef struct {
+    FILE *file;
+#ifdef GAMEGIRL_ZSTD
+    ZSTD_DStream *zstd;
+    ZSTD_inBuffer zstdIn;
+    uint8_t input[128*1024];
+    bool finished;
+#endif
+} LogReader;
+
+// Reads up to length bytes, returns less only at the end of the log, or -1 on error
+static long readLog(LogReader * const reader, uint8_t * const out, const size_t length)
+{
+#ifdef GAMEGIRL_ZSTD
+    if( NULL != reader->zstd ) {
+        ZSTD_outBuffer zstdOut = { out, length, 0 };
+        while( (zstdOut.pos < zstdOut.size) && !reader->finished ) {
+            if( reader->zstdIn.pos == reader->zstdIn.size ) {
+                reader->zstdIn.src = reader->input;
+                reader->zstdIn.size = fread(reader->input, 1, sizeof(reader->input), reader->file);
+                reader->zstdIn.pos = 0;
+                if( 0 == reader->zstdIn.size ) {
+                    break;  // truncated, keep whatever whole records there are
+                }
+            }
+            size_t result = ZSTD_decompressStream(reader->zstd, &zstdOut, &reader->zstdIn);
+            if( ZSTD_isError(result) ) {
+                fprintf(stderr, "Error decompressing log: %s\n", ZSTD_getErrorName(result));
+                return -1;
+            } else if( 0 == result ) {
+                reader->finished = true;
+            }
+        }
+        return zstdOut.pos;
+    }
+#endif
+    return fread(out, 1, length, reader->file);
+}
+
+static bool isZstdFilename(const char * const filename)
+{
+    const size_t length = strlen(filename);
+    return (4 <= length) && (0 == strcmp(".zst", &filename[length-4]));
+}
+
+int main(int argc, char *argv[])
+{
+    if( (2 > argc) || (3 < argc) ) {
+        fprintf(stderr, "usage: %s LOG [OUTPUT]\n", argv[0]);
+        return 2;
+    }
+
+    static LogReader reader;
+    reader.file = fopen(argv[1], "rb");
+    if( NULL == reader.file ) {
+        fprintf(stderr, "Unable to open '%s'\n", argv[1]);
+        return 1;
+    }
+    if( isZstdFilename(argv[1]) ) {
+#ifdef GAMEGIRL_ZSTD
+        reader.zstd = ZSTD_createDStream();
+        ZSTD_initDStream(reader.zstd);
+#else
+        fprintf(stderr, "Compressed logs need a zstd build (premake5 --zstd)\n");
+        return 1;
+#endif
+    }
+    FILE *output = (3 == argc)? fopen(argv[2], "wb") : stdout;
+    if( NULL == output ) {
+        fprintf(stderr, "Unable to write '%s'\n", argv[2]);
+        return 1;
+    }
+
+    DoctorLogHeader header;
+    if( (sizeof(header) != readLog(&reader, (uint8_t *)&header, sizeof(header))) || !doctorLogHeaderValid(&header) ) {
+        fprintf(stderr, "'%s' is not a binary doctor log\n", argv[1]);
+        return 1;
+    }
+
+    static DoctorLogRecord records[DOCTORLOG_RECORDS];
+    static char text[DOCTORLOG_RECORDS * DOCTOR_LOG_LINE_LENGTH];
+    unsigned long long total = 0;
+    long length;
+    while( 0 < (length = readLog(&reader, (uint8_t *)records, sizeof(records))) ) {
+        const long count = length / sizeof(DoctorLogRecord);
+        for(long index = 0; index < count; index++) {
+            doctorLogFormatLine(&records[index], &text[index * DOCTOR_LOG_LINE_LENGTH]);
+        }
+        fwrite(text, DOCTOR_LOG_LINE_LENGTH, count, output);
+        total += count;
+        if( 0 != (length % sizeof(DoctorLogRecord)) ) {
+            fprintf(stderr, "Log ends with a partial record\n");
+            break;
+        }
+    }
+
+    if( stdout != output ) {
+        fclose(output);
+    }
+    fclose(reader.file);
+#ifdef GAMEGIRL_ZSTD
+    if( NULL != reader.zstd ) {
+        ZSTD_freeDStream(reader.zstd);
+    }
+#endif
+    fprintf(stderr, "%llu instructions\n", total);
+    return (0 > length)? 1 : 0;
+}
@@ -0,0 +1,313 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+// Copyright (c) 2025 Haley Taylor (@truehaley)
+
+// Finds the first instruction where two doctor logs diverge
+//
+//  tracediff [-c LINES] LOG_A LOG_B
+//
+// Either log may be Gameboy-Doctor text (--debugLog) or binary (--binaryLog), compressed
+//  logs need converting first.  Both files are memory mapped and, when they're in the same
+//  format, compared as raw bytes sixteen at a time, so the scan runs at memory bandwidth.
+//  Logs in different formats are compared a chunk of parsed records at a time.
+//  Exits 0 if the logs match, 1 if they diverge and 2 on error, like cmp.
+
+#include "doctorlog_format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRACEDIFF_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TRACEDIFF_NEON
+#endif
+
+#define TRACEDIFF_CONTEXT       (5)
+#define TRACEDIFF_CHUNK         (64*1024)   // records parsed at a time for mixed formats
+
+typedef struct {
+    const char *filename;
+    const uint8_t *data;
+    size_t size;
+    bool binary;
+    const uint8_t *records;     // first record or line
+    size_t stride;              // bytes per record
+    uint64_t count;
+} TraceInput;
+
+static bool mapTrace(TraceInput * const trace)
+{
+#ifdef _WIN32
+    // no mmap, just read the whole thing
+    FILE *file = fopen(trace->filename, "rb");
+    if( NULL == file ) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    trace->size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = (uint8_t *)malloc((0 < trace->size)? trace->size : 1);
+    const bool success = (NULL != data) && (trace->size == fread(data, 1, trace->size, file));
+    fclose(file);
+    trace->data = data;
+    return success;
+#else
+    const int fd = open(trace->filename, O_RDONLY);
+    if( 0 > fd ) {
+        return false;
+    }
+    struct stat info;
+    if( 0 != fstat(fd, &info) ) {
+        close(fd);
+        return false;
+    }
+    trace->size = info.st_size;
+    if( 0 == trace->size ) {
+        close(fd);
+        trace->data = (const uint8_t *)"";
+        return true;
+    }
+    void *data = mmap(NULL, trace->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if( MAP_FAILED == data ) {
+        return false;
+    }
+    madvise(data, trace->size, MADV_SEQUENTIAL);
+    trace->data = (const uint8_t *)data;
+    return true;
+#endif
+}
+
+static bool openTrace(TraceInput * const trace, const char * const filename)
+{
+    memset(trace, 0, sizeof(*trace));
+    trace->filename = filename;
+    if( !mapTrace(trace) ) {
+        fprintf(stderr, "Unable to read '%s'\n", filename);
+        return false;
+    }
+
+    const DoctorLogHeader *header = (const DoctorLogHeader *)trace->data;
+    if( (sizeof(*header) <= trace->size) && doctorLogHeaderValid(header) ) {
+        trace->binary = true;
+        trace->records = trace->data + sizeof(*header);
+        trace->stride = sizeof(DoctorLogRecord);
+    } else if( (0 == trace->size) || (0 == memcmp(trace->data, "A:", 2)) ) {
+        trace->records = trace->data;
+        trace->stride = DOCTOR_LOG_LINE_LENGTH;
+    } else {
+        fprintf(stderr, "'%s' is not a doctor log%s\n", filename,
+            (0x28 == trace->data[0])? ", decompress it with doctorlog first" : "");
+        return false;
+    }
+    const size_t length = trace->size - (trace->records - trace->data);
+    trace->count = length / trace->stride;
+    if( 0 != (length % trace->stride) ) {
+        fprintf(stderr, "'%s' ends with a partial %s, ignoring it\n", filename, (trace->binary)? "record" : "line");
+    }
+    return true;
+}
+
+static bool getRecord(const TraceInput * const trace, const uint64_t index, DoctorLogRecord * const record)
+{
+    const uint8_t *data = trace->records + index * trace->stride;
+    if( trace->binary ) {
+        memcpy(record, data, sizeof(*record));
+        return true;
+    }
+    return doctorLogParseLine((const char *)data, record);
+}
+
+// Offset of the first byte that differs, or length if they're the same
+static size_t firstDifference(const uint8_t * const a, const uint8_t * const b, const size_t length)
+{
+    size_t offset = 0;
+#if defined(TRACEDIFF_SSE2)
+    for(; (offset + 16) <= length; offset += 16) {
+        const __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&a[offset]), _mm_loadu_si128((const __m128i *)&b[offset]));
+        if( 0xFFFF != _mm_movemask_epi8(equal) ) {
+            break;
+        }
+    }
+#elif defined(TRACEDIFF_NEON)
+    for(; (offset + 16) <= length; offset += 16) {
+        if( 0xFF != vminvq_u8(vceqq_u8(vld1q_u8(&a[offset]), vld1q_u8(&b[offset]))) ) {
+            break;
+        }
+    }
+#else
+    for(; (offset + 8) <= length; offset += 8) {
+        if( 0 != memcmp(&a[offset], &b[offset], 8) ) {
+            break;
+        }
+    }
+#endif
+    // narrow it down to the byte
+    while( (offset < length) && (a[offset] == b[offset]) ) {
+        offset++;
+    }
+    return offset;
+}
+
+// Index of the next record at or after start that might differ, or end if none do
+static uint64_t scanTraces(const TraceInput * const a, const TraceInput * const b, const uint64_t start, const uint64_t end)
+{
+    if( a->binary == b->binary ) {
+        const size_t offset = firstDifference(a->records + start * a->stride, b->records + start * b->stride, (end - start) * a->stride);
+        return start + offset / a->stride;
+    }
+
+    // one of each, parse the text a chunk at a time into the same layout as the binary log
+    static DoctorLogRecord parsed[TRACEDIFF_CHUNK];
+    const TraceInput *text = (a->binary)? b : a;
+    const TraceInput *binary = (a->binary)? a : b;
+    for(uint64_t chunk = start; chunk < end; chunk += TRACEDIFF_CHUNK) {
+        const uint64_t count = ((end - chunk) < TRACEDIFF_CHUNK)? (end - chunk) : TRACEDIFF_CHUNK;
+        for(uint64_t index = 0; index < count; index++) {
+            if( !getRecord(text, chunk + index, &parsed[index]) ) {
+                return chunk + index;
+            }
+        }
+        const size_t offset = firstDifference((const uint8_t *)parsed, binary->records + chunk * binary->stride, count * sizeof(DoctorLogRecord));
+        if( offset < (count * sizeof(DoctorLogRecord)) ) {
+            return chunk + offset / sizeof(DoctorLogRecord);
+        }
+    }
+    return end;
+}
+
+static bool recordsDiffer(const TraceInput * const a, const TraceInput * const b, const uint64_t index)
+{
+    DoctorLogRecord recordA, recordB;
+    if( !getRecord(a, index, &recordA) || !getRecord(b, index, &recordB) ) {
+        return true;
+    }
+    return 0 != memcmp(&recordA, &recordB, sizeof(recordA));
+}
+
+// Always reformatted, so both logs line up however they were written
+static void formatRecord(const TraceInput * const trace, const uint64_t index, char * const line)
+{
+    DoctorLogRecord record;
+    if( getRecord(trace, index, &record) ) {
+        doctorLogFormatLine(&record, line);
+    } else {
+        // unparseable, show it as it is
+        memcpy(line, trace->records + index * trace->stride, DOCTOR_LOG_LINE_LENGTH);
+    }
+}
+
+static void printRecord(const char * const marker, const TraceInput * const trace, const uint64_t index)
+{
+    char line[DOCTOR_LOG_LINE_LENGTH];
+    formatRecord(trace, index, line);
+    line[DOCTOR_LOG_LINE_LENGTH - 1] = '\0';
+    printf("%s %10llu  %s\n", marker, (unsigned long long)(index + 1), line);
+}
+
+// Carets under every field that differs, plus their names
+static void printDifferences(const TraceInput * const a, const TraceInput * const b, const uint64_t index)
+{
+    static const struct { const char *name; int position; int length; } fields[] = {
+        { "A", 2, 2 },  { "F", 7, 2 },  { "B", 12, 2 }, { "C", 17, 2 },
+        { "D", 22, 2 }, { "E", 27, 2 }, { "H", 32, 2 }, { "L", 37, 2 },
+        { "SP", 43, 4 }, { "PC", 51, 4 },
+        { "PCMEM[0]", 62, 2 }, { "PCMEM[1]", 65, 2 }, { "PCMEM[2]", 68, 2 }, { "PCMEM[3]", 71, 2 },
+    };
+    char lineA[DOCTOR_LOG_LINE_LENGTH], lineB[DOCTOR_LOG_LINE_LENGTH];
+    formatRecord(a, index, lineA);
+    formatRecord(b, index, lineB);
+
+    char carets[DOCTOR_LOG_LINE_LENGTH];
+    char names[256] = "";
+    memset(carets, ' ', sizeof(carets));
+    carets[sizeof(carets) - 1] = '\0';
+    for(int field = 0; field < (int)(sizeof(fields)/sizeof(fields[0])); field++) {
+        if( 0 != memcmp(&lineA[fields[field].position], &lineB[fields[field].position], fields[field].length) ) {
+            memset(&carets[fields[field].position], '^', fields[field].length);
+            strcat(names, " ");
+            strcat(names, fields[field].name);
+        }
+    }
+    printf("  %10s  %s\n", "", carets);
+    printf("differs:%s\n", names);
+}
+
+int main(int argc, char *argv[])
+{
+    int context = TRACEDIFF_CONTEXT;
+    const char *filenames[2] = { NULL, NULL };
+    int numFilenames = 0;
+    for(int arg = 1; arg < argc; arg++) {
+        if( (0 == strcmp("-c", argv[arg])) && ((arg + 1) < argc) ) {
+            context = atoi(argv[++arg]);
+        } else if( 2 > numFilenames ) {
+            filenames[numFilenames++] = argv[arg];
+        } else {
+            numFilenames++;
+        }
+    }
+    if( 2 != numFilenames ) {
+        fprintf(stderr, "usage: %s [-c LINES] LOG_A LOG_B\n", argv[0]);
+        return 2;
+    }
+
+    TraceInput a, b;
+    if( !openTrace(&a, filenames[0]) || !openTrace(&b, filenames[1]) ) {
+        return 2;
+    }
+
+    const uint64_t common = (a.count < b.count)? a.count : b.count;
+    uint64_t index = 0;
+    while( common > (index = scanTraces(&a, &b, index, common)) ) {
+        if( recordsDiffer(&a, &b, index) ) {
+            break;
+        }
+        index++;    // same values, just formatted differently
+    }
+
+    if( index == common ) {
+        if( a.count == b.count ) {
+            printf("%llu instructions, no divergence\n", (unsigned long long)common);
+            return 0;
+        }
+        const TraceInput *longer = (a.count > b.count)? &a : &b;
+        printf("Identical for %llu instructions, then '%s' ends and '%s' continues:\n",
+            (unsigned long long)common, (longer == &a)? b.filename : a.filename, longer->filename);
+        for(uint64_t line = (common > (uint64_t)context)? (common - context) : 0; line < common; line++) {
+            printRecord(" ", longer, line);
+        }
+        for(uint64_t line = common; (line < longer->count) && (line < (common + context)); line++) {
+            printRecord((longer == &a)? "<" : ">", longer, line);
+        }
+        return 1;
+    }
+
+    printf("First divergence at instruction %llu (line %llu)\n", (unsigned long long)index, (unsigned long long)(index + 1));
+    printf("< %s\n> %s\n\n", a.filename, b.filename);
+    for(uint64_t line = (index > (uint64_t)context)? (index - context) : 0; line < index; line++) {
+        printRecord(" ", &a, line);
+    }
+    printRecord("<", &a, index);
+    printRecord(">", &b, index);
+    printDifferences(&a, &b, index);
+    printf("\n");
+    for(uint64_t line = index + 1; (line < a.count) && (line <= (index + context)); line++) {
+        printRecord("<", &a, line);
+    }
+    for(uint64_t line = index + 1; (line < b.count) && (line <= (index + context)); line++) {
+        printRecord(">", &b, line);
+    }
+    return 1;
+}